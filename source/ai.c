@@ -0,0 +1,324 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include "ai.h"
+#include "heuristic.h"
+#include "timing.h"
+
+/* Expectimax over the rules in game.c. Max nodes pick the player's move, chance nodes average over */
+/* every way matrix_update could place its tiles: two 2s on a uniformly random pair of empty cells, */
+/* or a single 2 when there is only one empty cell.                                                 */
+
+/* Value of a position with no moves left. Everything evaluate returns is above this. */
+#define DEAD_VALUE 0.0f
+
+static u64 hash_board(Board board)
+{
+    board ^= board >> 33;
+    board *= 0xff51afd7ed558ccdull;
+    board ^= board >> 33;
+    board *= 0xc4ceb9fe1a85ec53ull;
+    board ^= board >> 33;
+    return board;
+}
+
+/* Static evaluation from the heuristic tables, kept above DEAD_VALUE whatever the weights are */
+static inline f32 live_value(f32 value)
+{
+    return value > DEAD_VALUE ? value : DEAD_VALUE + 1.0f;
+}
+
+static f32 evaluate(Board board)
+{
+    return live_value(heuristic_evaluate(board));
+}
+
+AiConfig ai_default_config()
+{
+    AiConfig config = {
+        .depth = 3,
+        .time_budget = 0,
+        .min_probability = 0.0001f,
+        .table_bits = 20,
+    };
+    return config;
+}
+
+void ai_init(Ai *ai, AiConfig config)
+{
+    ai->config = config;
+    ai->stats = (AiStats) {0};
+    ai->table = (TableEntry *) calloc((size_t) 1 << config.table_bits, sizeof(TableEntry));
+    ai->table_mask = ((u64) 1 << config.table_bits) - 1;
+    ai->out_of_time = false;
+}
+
+void ai_free(Ai *ai)
+{
+    free(ai->table);
+    ai->table = NULL;
+}
+
+static f32 search_max(Ai *ai, Board board, u32 depth, f32 probability);
+
+static f32 search_chance(Ai *ai, Board board, u32 depth, f32 probability)
+{
+    ai->stats.nodes += 1;
+    if(depth == 0 || probability < ai->config.min_probability) return evaluate(board);
+
+    if(ai->config.time_budget > 0 && (ai->stats.nodes & 0xfff) == 0 && timer_now() > ai->deadline)
+    {
+        ai->out_of_time = true;
+    }
+    if(ai->out_of_time) return DEAD_VALUE;
+
+    // Boards are never 0 after a move so a zeroed entry can't match. The evaluation and the search
+    // treat every symmetry of a board alike, so they can all share the entry of the canonical one.
+    // That only pays for itself above the last level, a hit down there saves less than finding the key.
+    Board key = depth > 1 ? board_canonical(board, NULL) : board;
+    TableEntry *entry = &ai->table[hash_board(key) & ai->table_mask];
+    ai->stats.lookups += 1;
+    if(entry->board == key && entry->depth >= depth)
+    {
+        ai->stats.hits += 1;
+        return entry->value;
+    }
+
+    u8 empty[CELL_NUM];
+    u32 empty_count = 0;
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        if(board_get(board, i) == 0) empty[empty_count++] = i;
+    }
+
+    f32 value = 0;
+    if(empty_count == 1)
+    {
+        value = search_max(ai, board_set(board, empty[0], 1), depth, probability);
+    }
+    else
+    {
+        f32 pair_probability = 2.0f / (f32) (empty_count * (empty_count - 1));
+        for(u32 i = 0; i < empty_count; ++i)
+        {
+            Board one = board_set(board, empty[i], 1);
+            for(u32 j = i + 1; j < empty_count; ++j)
+            {
+                Board two = board_set(one, empty[j], 1);
+                value += search_max(ai, two, depth, probability * pair_probability);
+            }
+        }
+        value *= pair_probability;
+    }
+
+    if(!ai->out_of_time)
+    {
+        entry->board = key;
+        entry->value = value;
+        entry->depth = depth;
+    }
+    return value;
+}
+
+static f32 search_max(Ai *ai, Board board, u32 depth, f32 probability)
+{
+    ai->stats.nodes += 1;
+    f32 best = DEAD_VALUE;
+
+    // Every child would just be evaluated, which is most of the nodes in the tree
+    if(depth == 1)
+    {
+        Board successors[4];
+        f32 values[4];
+        u32 legal = heuristic_evaluate_moves(board, successors, values);
+        ai->stats.nodes += __builtin_popcount(legal);
+        for(Dir dir = LEFT; dir <= DOWN; ++dir)
+        {
+            if((legal & (1 << dir)) && live_value(values[dir]) > best) best = live_value(values[dir]);
+        }
+        return best;
+    }
+
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Board next = board_move(board, dir);
+        if(next == board) continue;
+
+        f32 value = search_chance(ai, next, depth - 1, probability);
+        if(value > best) best = value;
+    }
+    return best;
+}
+
+static Dir search_root(Ai *ai, Board board, u32 depth)
+{
+    Dir best = LEFT;
+    f32 best_value = -1.0f;
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Board next = board_move(board, dir);
+        if(next == board) continue;
+
+        f32 value = search_chance(ai, next, depth - 1, 1.0f);
+        if(value > best_value)
+        {
+            best_value = value;
+            best = dir;
+        }
+    }
+    return best;
+}
+
+Dir ai_choose(Ai *ai, Board board)
+{
+    f64 start = timer_now();
+    u32 depth = ai->config.depth ? ai->config.depth : 1;
+    Dir best;
+
+    if(ai->config.time_budget > 0)
+    {
+        ai->deadline = start + ai->config.time_budget / 1000.0;
+        ai->out_of_time = false;
+        best = search_root(ai, board, 1);
+        u32 reached = 1;
+        for(u32 d = 2; d <= depth && timer_now() < ai->deadline; ++d)
+        {
+            Dir dir = search_root(ai, board, d);
+            if(ai->out_of_time) break;
+            best = dir;
+            reached = d;
+        }
+        ai->out_of_time = false;
+        ai->stats.depth_sum += reached;
+    }
+    else
+    {
+        best = search_root(ai, board, depth);
+        ai->stats.depth_sum += depth;
+    }
+
+    ai->stats.moves += 1;
+    ai->stats.time += timer_now() - start;
+    return best;
+}
+
+typedef struct
+{
+    Ai *ais;
+    Board next;
+    u32 depth;
+    f32 value;
+} RootTask;
+
+static void search_root_task(void *arg, u32 worker)
+{
+    RootTask *task = (RootTask *) arg;
+    task->value = search_chance(&task->ais[worker], task->next, task->depth - 1, 1.0f);
+}
+
+/* Runs one depth of the parallel search. Returns false if any of the tasks ran out of time. */
+static b32 search_root_parallel(Ai *ais, Pool *pool, Board board, u32 depth, Dir *best)
+{
+    RootTask tasks[4];
+    Dir dirs[4];
+    u32 count = 0;
+
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Board next = board_move(board, dir);
+        if(next == board) continue;
+
+        tasks[count] = (RootTask) { .ais = ais, .next = next, .depth = depth };
+        dirs[count] = dir;
+        count++;
+    }
+
+    for(u32 i = 0; i < count; ++i) pool_submit(pool, search_root_task, &tasks[i]);
+    pool_wait(pool);
+
+    b32 finished = true;
+    for(u32 i = 0; i < pool->thread_count; ++i)
+    {
+        if(ais[i].out_of_time) finished = false;
+    }
+    if(!finished) return false;
+
+    f32 best_value = -1.0f;
+    for(u32 i = 0; i < count; ++i)
+    {
+        if(tasks[i].value > best_value)
+        {
+            best_value = tasks[i].value;
+            *best = dirs[i];
+        }
+    }
+    return true;
+}
+
+Dir ai_choose_parallel(Ai *ais, Pool *pool, Board board)
+{
+    Ai *ai = &ais[0];
+    f64 start = timer_now();
+    u32 depth = ai->config.depth ? ai->config.depth : 1;
+    Dir best = LEFT;
+    u32 reached = 1;
+
+    if(ai->config.time_budget > 0)
+    {
+        f64 deadline = start + ai->config.time_budget / 1000.0;
+        for(u32 i = 0; i < pool->thread_count; ++i)
+        {
+            ais[i].deadline = deadline;
+            ais[i].out_of_time = false;
+        }
+
+        // Depth 1 only evaluates so it always finishes
+        search_root_parallel(ais, pool, board, 1, &best);
+        for(u32 d = 2; d <= depth && timer_now() < deadline; ++d)
+        {
+            if(!search_root_parallel(ais, pool, board, d, &best)) break;
+            reached = d;
+        }
+    }
+    else
+    {
+        search_root_parallel(ais, pool, board, depth, &best);
+        reached = depth;
+    }
+
+    for(u32 i = 0; i < pool->thread_count; ++i)
+    {
+        ais[i].out_of_time = false;
+    }
+
+    ai->stats.depth_sum += reached;
+    ai->stats.moves += 1;
+    ai->stats.time += timer_now() - start;
+    return best;
+}
+
+Dir ai_policy(Game *game, void *data)
+{
+    return ai_choose((Ai *) data, game->board);
+}
+
+void ai_merge_stats(AiStats *into, AiStats *from)
+{
+    into->nodes += from->nodes;
+    into->lookups += from->lookups;
+    into->hits += from->hits;
+    into->moves += from->moves;
+    into->time += from->time;
+    into->depth_sum += from->depth_sum;
+}
+
+void ai_print_stats(AiStats *stats, FILE *file)
+{
+    if(!stats->moves) return;
+
+    fprintf(file, "ai moves:    %" PRIu64 " (mean depth %.2f)\n",
+            stats->moves, (f64) stats->depth_sum / stats->moves);
+    fprintf(file, "ai nodes:    %" PRIu64 " (%.0f nodes/sec, %.3f ms/move)\n",
+            stats->nodes, stats->nodes / stats->time, stats->time * 1000.0 / stats->moves);
+    fprintf(file, "ai cache:    %.2f%% hit rate over %" PRIu64 " lookups\n",
+            stats->lookups ? 100.0 * stats->hits / stats->lookups : 0.0, stats->lookups);
+}
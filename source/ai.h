@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include "game.h"
+#include "pool.h"
+
+#ifndef AI
+#define AI
+
+typedef struct
+{
+    /* Number of player moves to look ahead */
+    u32 depth;
+    /* Milliseconds per move. When non zero the search deepens one level at a time up to depth and */
+    /* keeps the deepest result that finished inside the budget. 0 means always search to depth.   */
+    f64 time_budget;
+    /* Chance branches reached with a lower probability than this are evaluated instead of searched */
+    f32 min_probability;
+    /* The transposition table has 1 << table_bits entries */
+    u32 table_bits;
+} AiConfig;
+
+typedef struct
+{
+    u64 nodes;
+    u64 lookups;
+    u64 hits;
+    u64 moves;
+    f64 time;
+    u64 depth_sum;
+} AiStats;
+
+typedef struct
+{
+    Board board;
+    f32 value;
+    u32 depth;
+} TableEntry;
+
+typedef struct
+{
+    AiConfig config;
+    AiStats stats;
+    TableEntry *table;
+    u64 table_mask;
+    /* Set when a timed search runs out of time so the unfinished depth can be thrown away */
+    b32 out_of_time;
+    f64 deadline;
+} Ai;
+
+AiConfig ai_default_config();
+/* Positions are scored with heuristic_evaluate, heuristic_init has to have been called before searching */
+void ai_init(Ai *ai, AiConfig config);
+void ai_free(Ai *ai);
+
+/* Best move for a board that isn't game over */
+Dir ai_choose(Ai *ai, Board board);
+
+/* Same as ai_choose with every root move searched as its own task on the pool. ais holds one Ai per */
+/* pool thread, each task searches with the Ai of the worker running it. The per move totals (moves, */
+/* time, depth) go into ais[0].                                                                      */
+Dir ai_choose_parallel(Ai *ais, Pool *pool, Board board);
+
+/* Policy wrapper around ai_choose, data is the Ai */
+Dir ai_policy(Game *game, void *data);
+
+void ai_merge_stats(AiStats *into, AiStats *from);
+void ai_print_stats(AiStats *stats, FILE *file);
+
+#endif
@@ -0,0 +1,132 @@
+#include <string.h>
+#include "animate.h"
+
+// How much a merged tile grows at the top of its pop
+#define MERGE_POP 0.15f
+
+f32 ease_out_cubic(f32 t)
+{
+    f32 u = 1.0f - t;
+    return 1.0f - u * u * u;
+}
+
+f32 ease_out_back(f32 t)
+{
+    const f32 c1 = 1.70158f;
+    const f32 c3 = c1 + 1.0f;
+    f32 u = t - 1.0f;
+    return 1.0f + c3 * u * u * u + c1 * u * u;
+}
+
+void animator_init(Animator *animator, Grid *grid)
+{
+    animator->head = 0;
+    animator->count = 0;
+    animator->elapsed = 0;
+    animator->shown = *grid;
+}
+
+void animator_push(Animator *animator, Grid *before, u8 destinations[GRID_CELLS], Grid *after)
+{
+    if(animator->count == MAX_QUEUED_MOVES)
+    {
+        animator->head = (animator->head + 1) % MAX_QUEUED_MOVES;
+        animator->count -= 1;
+        animator->elapsed = 0;
+    }
+
+    MoveAnimation *move = &animator->queue[(animator->head + animator->count) % MAX_QUEUED_MOVES];
+    move->before = *before;
+    memcpy(move->destinations, destinations, GRID_CELLS);
+    move->after = *after;
+    animator->count += 1;
+    animator->shown = *after;
+}
+
+void animator_advance(Animator *animator, f64 seconds)
+{
+    // Every move waiting behind the current one makes the queue play that much faster
+    animator->elapsed += seconds * animator->count;
+    while(animator->count && animator->elapsed >= SLIDE_TIME + POP_TIME)
+    {
+        animator->elapsed -= SLIDE_TIME + POP_TIME;
+        animator->head = (animator->head + 1) % MAX_QUEUED_MOVES;
+        animator->count -= 1;
+    }
+    if(!animator->count) animator->elapsed = 0;
+}
+
+void animator_finish(Animator *animator)
+{
+    animator->count = 0;
+    animator->elapsed = 0;
+}
+
+b32 animator_busy(Animator *animator)
+{
+    return animator->count > 0;
+}
+
+static void rest_sprites(Grid *grid, Sprite sprites[GRID_CELLS])
+{
+    for(u32 i = 0; i < grid->size * grid->size; ++i)
+    {
+        sprites[i] = (Sprite) { i % grid->size, i / grid->size, 1.0f, grid->cells[i], 1.0f, 0 };
+    }
+}
+
+void animator_sprites(Animator *animator, Sprite sprites[GRID_CELLS])
+{
+    memset(sprites, 0, GRID_CELLS * sizeof(Sprite));
+    if(!animator->count)
+    {
+        rest_sprites(&animator->shown, sprites);
+        return;
+    }
+
+    MoveAnimation *move = &animator->queue[animator->head];
+    u32 n = move->before.size;
+
+    if(animator->elapsed < SLIDE_TIME)
+    {
+        // Old tiles on their way to where they end up. Tiles that merge end up on top of each other.
+        f32 t = ease_out_cubic(animator->elapsed / SLIDE_TIME);
+        for(u32 i = 0; i < n * n; ++i)
+        {
+            u8 value = move->before.cells[i];
+            if(!value) continue;
+
+            u32 to = move->destinations[i];
+            f32 x = i % n, y = i / n;
+            sprites[i] = (Sprite) {
+                .x = x + ((f32) (to % n) - x) * t,
+                .y = y + ((f32) (to / n) - y) * t,
+                .scale = 1.0f,
+                .value = value,
+                .opacity = 1.0f,
+            };
+        }
+        return;
+    }
+
+    // New board, with the cells two tiles landed in and the cells no tile landed in popping
+    u8 sources[GRID_CELLS] = {0};
+    for(u32 i = 0; i < n * n; ++i)
+    {
+        if(move->destinations[i] != NO_TILE) sources[move->destinations[i]] += 1;
+    }
+
+    f32 t = (animator->elapsed - SLIDE_TIME) / POP_TIME;
+    rest_sprites(&move->after, sprites);
+    for(u32 i = 0; i < n * n; ++i)
+    {
+        if(!sprites[i].value) continue;
+        if(sources[i] == 0) sprites[i].scale = ease_out_back(t);
+        else if(sources[i] == 2)
+        {
+            sprites[i].scale = 1.0f + MERGE_POP * 4.0f * t * (1.0f - t);
+            sprites[i].opacity = ease_out_cubic(t);
+            sprites[i].under = sprites[i].value - 1;
+        }
+    }
+}
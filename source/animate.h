@@ -0,0 +1,70 @@
+#include "grid.h"
+
+#ifndef ANIMATE
+#define ANIMATE
+
+/* Turns moves into animations driven by elapsed time. Each move slides its tiles to where they end up */
+/* and then pops the tiles it merged and spawned. Moves made while one is still playing are queued and */
+/* the queue plays faster the longer it gets, so a fast player is never far behind the real board.     */
+/* Nothing in here knows about pixels, sprites are in grid coordinates.                                */
+
+// Seconds each part of a move takes at normal speed
+#define SLIDE_TIME 0.09
+#define POP_TIME   0.12
+
+// More moves than this waiting and the oldest one is skipped
+#define MAX_QUEUED_MOVES 8
+
+/* A tile at some point of an animation. x and y are the column and row of its top left corner, */
+/* fractional while sliding. scale is its size relative to a tile at rest, around its centre.   */
+typedef struct
+{
+    f32 x;
+    f32 y;
+    f32 scale;
+    /* Exponent, 0 if there is no tile */
+    u8 value;
+    /* 0 to 1, how much of the tile shows over what is under it */
+    f32 opacity;
+    /* Exponent of a tile drawn at rest underneath this one, 0 if there is none. Merged tiles fade in */
+    /* over the tiles they were made from.                                                           */
+    u8 under;
+} Sprite;
+
+typedef struct
+{
+    Grid before;
+    /* From grid_move_traced on before */
+    u8 destinations[GRID_CELLS];
+    /* After the move and the spawn */
+    Grid after;
+} MoveAnimation;
+
+typedef struct
+{
+    MoveAnimation queue[MAX_QUEUED_MOVES];
+    u32 head;
+    u32 count;
+    /* What is shown once the queue is empty */
+    Grid shown;
+    /* Seconds into the animation at the front of the queue */
+    f64 elapsed;
+} Animator;
+
+/* 0 to 1 over t in [0, 1], fast at the start and settling into place */
+f32 ease_out_cubic(f32 t);
+/* Like ease_out_cubic but overshoots 1 a little before settling */
+f32 ease_out_back(f32 t);
+
+void animator_init(Animator *animator, Grid *grid);
+void animator_push(Animator *animator, Grid *before, u8 destinations[GRID_CELLS], Grid *after);
+/* Moves the animations on by seconds of wall time */
+void animator_advance(Animator *animator, f64 seconds);
+/* Drops everything queued and shows the last board straight away */
+void animator_finish(Animator *animator);
+b32 animator_busy(Animator *animator);
+
+/* One sprite per cell of the board being shown, value 0 for cells with nothing to draw */
+void animator_sprites(Animator *animator, Sprite sprites[GRID_CELLS]);
+
+#endif
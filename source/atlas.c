@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atlas.h"
+#include "blit.h"
+#include "colors.h"
+#include "draw.h"
+#include "font.h"
+
+static u32 palette[11] = {
+      /* R             G            B */
+    (105 << 16) | (105 << 8) | (105 << 0),         // Grey
+    (255 << 16) | (255 << 8) | (0   << 0),         // Yellow
+    (200 << 16) | (100 << 8) | (0   << 0),         // Orange
+    (255 << 16) | (0   << 8) | (0   << 0),         // Red
+    (130 << 16) | (18  << 8) | (75  << 0),         // Magenta
+    (255 << 16) | (100 << 8) | (255 << 0),         // Purple
+    (0   << 16) | (0   << 8) | (255 << 0),         // Blue
+    (0   << 16) | (255 << 8) | (255 << 0),         // Cyan
+    (55  << 16) | (206 << 8) | (68  << 0),         // Green
+    (20  << 16) | (14  << 8) | (15  << 0),         // Brown
+    (0   << 16) | (0   << 8) | (0   << 0),         // Black
+};
+#define PALETTE_SIZE (sizeof(palette) / sizeof(palette[0]))
+
+u32 tile_color(u8 value)
+{
+    if(value == 0) return palette[0];
+
+    // The first lap of the palette is the original colours up to 2048. The last one is black so the
+    // laps after it start again from the top, a little darker each time.
+    u32 index = (value - 1) % PALETTE_SIZE;
+    u32 lap = (value - 1) / PALETTE_SIZE;
+    Color color = from_pixel(palette[index]);
+    for(u32 i = 0; i < lap; ++i) color = change_saturation(color, 0.7f);
+    return pixel(color);
+}
+
+/* Text on a tile has to be readable against it */
+static u32 text_color(u32 tile)
+{
+    Color color = from_pixel(tile);
+    f32 luminance = 0.299f * color.r + 0.587f * color.g + 0.114f * color.b;
+    return luminance > 0.6f ? (48 << 16) | (48 << 8) | (48 << 0) : (255 << 16) | (255 << 8) | (255 << 0);
+}
+
+/* Value written on the tile. Anything that doesn't fit in 5 digits is given in K, M or G (powers of 1024). */
+static void tile_label(u8 value, char *label, u32 size)
+{
+    u64 number = (u64) 1 << value;
+    const char *suffix = "";
+    if(number >= 100000)
+    {
+        static const char *units[] = { "K", "M", "G" };
+        u32 unit = 0;
+        number >>= 10;
+        while(number >= 10000 && unit < 2)
+        {
+            number >>= 10;
+            unit++;
+        }
+        suffix = units[unit];
+    }
+    snprintf(label, size, "%llu%s", (unsigned long long) number, suffix);
+}
+
+/* Rounded square of size length with corners of the given radius, top left corner at x, y */
+static void rounded_square(Bitmap *image, i32 x, i32 y, i32 width, i32 height, i32 radius, u32 color)
+{
+    Rect bounds = { 0, 0, image->width, image->height };
+
+    fill_rect_pixels(image->pixels, image->stride, rect_intersect((Rect) { x + radius, y, width - 2 * radius, height }, bounds), color);
+    fill_rect_pixels(image->pixels, image->stride, rect_intersect((Rect) { x, y + radius, width, height - 2 * radius }, bounds), color);
+
+    fill_circle(x + radius, y + radius, radius, image, color);
+    fill_circle(x + width - 1 - radius, y + radius, radius, image, color);
+    fill_circle(x + radius, y + height - 1 - radius, radius, image, color);
+    fill_circle(x + width - 1 - radius, y + height - 1 - radius, radius, image, color);
+}
+
+static void draw_tile(TileAtlas *atlas, u8 value)
+{
+    i32 length = atlas->length;
+    u32 *pixels = atlas_tile(atlas, value);
+    Bitmap image = atlas_bitmap(atlas, value);
+
+    u32 color = tile_color(value);
+    i32 radius = length / 10;
+    i32 shade = length / 24 > 1 ? length / 24 : 1;
+
+    // Clear outside the rounded corners
+    fill_rect_pixels(pixels, length, (Rect) { 0, 0, length, length }, 0);
+    rounded_square(&image, 0, 0, length, length, radius, opaque(pixel(change_saturation(from_pixel(color), 0.75f))));
+    rounded_square(&image, 0, 0, length, length - shade, radius, opaque(color));
+
+    char label[16];
+    tile_label(value, label, sizeof(label));
+
+    // Largest whole scale that keeps the text within 80% of the width and 40% of the height
+    u32 chars = strlen(label);
+    u32 scale_x = (length * 4 / 5) / (chars * (GLYPH_WIDTH + GLYPH_SPACING) - GLYPH_SPACING);
+    u32 scale_y = (length * 2 / 5) / GLYPH_HEIGHT;
+    u32 scale = scale_x < scale_y ? scale_x : scale_y;
+    if(scale == 0) scale = 1;
+
+    i32 text_x = (length - (i32) text_width(label, scale)) / 2;
+    i32 text_y = (length - shade - (i32) text_height(scale)) / 2;
+    draw_text(label, text_x, text_y, scale, opaque(text_color(color)), pixels, length, (Rect) { 0, 0, length, length });
+}
+
+void atlas_build(TileAtlas *atlas, u32 length)
+{
+    atlas->length = length;
+    atlas->pixels = (u32 *) malloc((size_t) ATLAS_TILES * length * length * sizeof(u32));
+    for(u32 value = 1; value < ATLAS_TILES; ++value)
+    {
+        draw_tile(atlas, value);
+    }
+}
+
+void atlas_free(TileAtlas *atlas)
+{
+    free(atlas->pixels);
+    atlas->pixels = NULL;
+}
+
+Rect atlas_bounds(TileAtlas *atlas, f32 x, f32 y, f32 length)
+{
+    Bitmap tile = atlas_bitmap(atlas, 1);
+    return blit_bounds(&tile, x, y, length, length, BLIT_BILINEAR);
+}
+
+void atlas_draw(TileAtlas *atlas, u8 value, f32 x, f32 y, f32 length, u32 opacity, Bitmap *target, Rect clip)
+{
+    Bitmap tile = atlas_bitmap(atlas, value);
+    blit(target, clip, &tile, x, y, length, length, BLIT_BILINEAR, opacity);
+}
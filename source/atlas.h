@@ -0,0 +1,50 @@
+#include "blit.h"
+#include "raster.h"
+#include "types.h"
+
+#ifndef ATLAS
+#define ATLAS
+
+/* Every tile the game can show, drawn once at startup at the size tiles are drawn on screen: rounded */
+/* corners, a darker bottom edge and the tile's value. Drawing a tile during a frame is then just a   */
+/* blit out of here, however much detail the tiles have. Tiles are premultiplied with clear corners  */
+/* so whatever they are drawn over shows around them.                                               */
+
+// Exponents 1 to ATLAS_TILES - 1 get a tile, which covers anything a byte sized Grid cell can reach
+// on the biggest board
+#define ATLAS_TILES 32
+
+typedef struct
+{
+    /* Width and height of every tile */
+    u32 length;
+    /* ATLAS_TILES tiles of length * length pixels one after the other, tile 0 unused */
+    u32 *pixels;
+} TileAtlas;
+
+/* Colour of the tile for exponent value. Past the end of the base palette the colours repeat darker. */
+u32 tile_color(u8 value);
+
+void atlas_build(TileAtlas *atlas, u32 length);
+void atlas_free(TileAtlas *atlas);
+
+static inline u32 *atlas_tile(TileAtlas *atlas, u8 value)
+{
+    return atlas->pixels + (size_t) value * atlas->length * atlas->length;
+}
+
+static inline Bitmap atlas_bitmap(TileAtlas *atlas, u8 value)
+{
+    if(value >= ATLAS_TILES) value = ATLAS_TILES - 1;
+    return (Bitmap) { atlas_tile(atlas, value), atlas->length, atlas->length, atlas->length };
+}
+
+/* Pixels atlas_draw can change for a tile at x, y, length */
+Rect atlas_bounds(TileAtlas *atlas, f32 x, f32 y, f32 length);
+
+/* Draws tile value over target with its top left corner at x, y, scaled (bilinear) to length x length if */
+/* that isn't the atlas size and faded to opacity (0 to 255). Only the part inside clip is drawn, clip    */
+/* must be inside target.                                                                                */
+void atlas_draw(TileAtlas *atlas, u8 value, f32 x, f32 y, f32 length, u32 opacity, Bitmap *target, Rect clip);
+
+#endif
@@ -0,0 +1,381 @@
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_X86
+#endif
+
+/* Row moved left in the low 16 bits and the points scored by it over 4 in the high 16, so one gather */
+/* gets both, followed by the same for moving right. Every merge makes at least a 4 and a row holds   */
+/* at most two merges of up to 32768, so the score always fits.                                       */
+static u32 move_table[2 * 65536];
+
+static inline Rng load_rng(BoardBatch *batch, u32 lane)
+{
+    Rng rng;
+    for(int k = 0; k < 4; ++k) rng.s[k] = batch->state[k][lane];
+    return rng;
+}
+
+static inline void store_rng(BoardBatch *batch, u32 lane, Rng *rng)
+{
+    for(int k = 0; k < 4; ++k) batch->state[k][lane] = rng->s[k];
+}
+
+b32 batch_create(BoardBatch *batch, u32 count)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->count = count;
+    batch->boards = (Board *) calloc(count ? count : 1, sizeof(Board));
+    batch->scores = (u32 *) calloc(count ? count : 1, sizeof(u32));
+    batch->moves = (u32 *) calloc(count ? count : 1, sizeof(u32));
+    b32 ok = batch->boards && batch->scores && batch->moves;
+    for(int k = 0; k < 4; ++k)
+    {
+        batch->state[k] = (u64 *) calloc(count ? count : 1, sizeof(u64));
+        ok = ok && batch->state[k];
+    }
+    if(!ok) batch_destroy(batch);
+    return ok;
+}
+
+void batch_destroy(BoardBatch *batch)
+{
+    free(batch->boards);
+    free(batch->scores);
+    free(batch->moves);
+    for(int k = 0; k < 4; ++k) free(batch->state[k]);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void batch_load(BoardBatch *batch, u32 lane, Game *game)
+{
+    batch->boards[lane] = game->board;
+    batch->scores[lane] = game->score;
+    batch->moves[lane] = game->moves;
+    store_rng(batch, lane, &game->rng);
+}
+
+void batch_store(BoardBatch *batch, u32 lane, Game *game)
+{
+    game->board = batch->boards[lane];
+    game->score = batch->scores[lane];
+    game->moves = batch->moves[lane];
+    game->rng = load_rng(batch, lane);
+}
+
+/* Spawns after a move that changed the board, exactly as game_move does */
+static inline void spawn_lane(BoardBatch *batch, u32 lane, Board next)
+{
+    Rng rng = load_rng(batch, lane);
+    matrix_update(&next, &rng);
+    store_rng(batch, lane, &rng);
+    batch->boards[lane] = next;
+}
+
+/* Returns bit 0 set if the board moved and bit 1 if the game is over afterwards */
+static inline u32 step_lane(BoardBatch *batch, u32 lane, Dir dir)
+{
+    Board board = batch->boards[lane];
+    Board next = board_move(board, dir);
+    u32 result = 0;
+    if(next != board)
+    {
+        batch->scores[lane] += board_move_score(board, dir);
+        batch->moves[lane] += 1;
+        spawn_lane(batch, lane, next);
+        result |= 1;
+    }
+    if(game_over(batch->boards[lane])) result |= 2;
+    return result;
+}
+
+static void step_lanes(BoardBatch *batch, u32 first, const u8 *dirs, u64 *changed, u64 *terminal)
+{
+    for(u32 lane = first; lane < batch->count; ++lane)
+    {
+        u32 result = step_lane(batch, lane, (Dir) dirs[lane]);
+        changed[lane / 64] |= (u64) (result & 1) << (lane % 64);
+        terminal[lane / 64] |= (u64) (result >> 1) << (lane % 64);
+    }
+}
+
+void batch_step_scalar(BoardBatch *batch, const u8 *dirs, u64 *changed, u64 *terminal)
+{
+    memset(changed, 0, batch_mask_words(batch->count) * sizeof(u64));
+    memset(terminal, 0, batch_mask_words(batch->count) * sizeof(u64));
+    step_lanes(batch, 0, dirs, changed, terminal);
+}
+
+#ifdef BATCH_X86
+/* Four lanes per vector, one board or generator word per 64 bit element. Everything a board needs is */
+/* done on all of its cells at once with nibble masks: moves are the usual row table lookups done as  */
+/* gathers, and finding the n'th empty cell for a spawn is a prefix sum over one bit per empty cell.  */
+
+#define AVX2_LANES 4
+
+#define NIBBLE_LOW 0x1111111111111111ull
+
+__attribute__((target("avx2")))
+static inline __m256i shl(__m256i x, int bits)
+{
+    return _mm256_sll_epi64(x, _mm_cvtsi32_si128(bits));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i shr(__m256i x, int bits)
+{
+    return _mm256_srl_epi64(x, _mm_cvtsi32_si128(bits));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i constant(u64 value)
+{
+    return _mm256_set1_epi64x((i64) value);
+}
+
+/* Lanes where mask is all ones take b, the others a */
+__attribute__((target("avx2")))
+static inline __m256i pick(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(a, b, mask);
+}
+
+/* board_transpose on every lane */
+__attribute__((target("avx2")))
+static inline __m256i transpose_avx2(__m256i board)
+{
+    __m256i a1 = _mm256_and_si256(board, constant(0xf0f00f0ff0f00f0full));
+    __m256i a2 = _mm256_and_si256(board, constant(0x0000f0f00000f0f0ull));
+    __m256i a3 = _mm256_and_si256(board, constant(0x0f0f00000f0f0000ull));
+    __m256i a = _mm256_or_si256(a1, _mm256_or_si256(shl(a2, 12), shr(a3, 12)));
+    __m256i b1 = _mm256_and_si256(a, constant(0xff00ff0000ff00ffull));
+    __m256i b2 = _mm256_and_si256(a, constant(0x00ff00ff00000000ull));
+    __m256i b3 = _mm256_and_si256(a, constant(0x00000000ff00ff00ull));
+    return _mm256_or_si256(b1, _mm256_or_si256(shr(b2, 24), shl(b3, 24)));
+}
+
+/* Lowest bit of every nibble set where the cell is empty */
+__attribute__((target("avx2")))
+static inline __m256i empty_cells(__m256i board)
+{
+    __m256i any = _mm256_or_si256(_mm256_or_si256(board, shr(board, 1)), _mm256_or_si256(shr(board, 2), shr(board, 3)));
+    return _mm256_andnot_si256(any, constant(NIBBLE_LOW));
+}
+
+/* All ones in lanes where a > b, both under 2^63 */
+__attribute__((target("avx2")))
+static inline __m256i greater(__m256i a, __m256i b)
+{
+    return _mm256_cmpgt_epi64(a, b);
+}
+
+/* rng_next on every lane */
+__attribute__((target("avx2")))
+static inline __m256i next_avx2(__m256i s[4])
+{
+    __m256i five = _mm256_add_epi64(s[1], shl(s[1], 2));
+    __m256i rotated = _mm256_or_si256(shl(five, 7), shr(five, 57));
+    __m256i result = _mm256_add_epi64(rotated, shl(rotated, 3));
+    __m256i t = shl(s[1], 17);
+
+    s[2] = _mm256_xor_si256(s[2], s[0]);
+    s[3] = _mm256_xor_si256(s[3], s[1]);
+    s[1] = _mm256_xor_si256(s[1], s[2]);
+    s[0] = _mm256_xor_si256(s[0], s[3]);
+    s[2] = _mm256_xor_si256(s[2], t);
+    s[3] = _mm256_or_si256(shl(s[3], 45), shr(s[3], 19));
+    return result;
+}
+
+/* The multiply of rng_bounded on a draw from next_avx2, adding the lanes of mask where the draw might */
+/* be one rng_bounded would have thrown away to unsure. Those get redone one lane at a time.          */
+__attribute__((target("avx2")))
+static inline __m256i bounded_avx2(__m256i draw, __m256i bound, __m256i mask, __m256i *unsure)
+{
+    __m256i product = _mm256_mul_epu32(shr(draw, 32), bound);
+    __m256i low = _mm256_and_si256(product, constant(0xffffffffull));
+    *unsure = _mm256_or_si256(*unsure, _mm256_and_si256(mask, greater(bound, low)));
+    return shr(product, 32);
+}
+
+/* One bit per lane out of a lane mask */
+__attribute__((target("avx2")))
+static inline u32 lane_bits(__m256i mask)
+{
+    return (u32) _mm256_movemask_pd(_mm256_castsi256_pd(mask));
+}
+
+/* Cells whose exclusive count of empty cells before them is index, out of the empty ones */
+__attribute__((target("avx2")))
+static inline __m256i nth_empty(__m256i empty, __m256i before, __m256i index)
+{
+    // index is at most 15, so one multiply copies it into every nibble of the low half
+    __m256i spread = _mm256_mul_epu32(index, constant(0x11111111ull));
+    spread = _mm256_or_si256(spread, shl(spread, 32));
+    __m256i differ = _mm256_xor_si256(before, spread);
+    return _mm256_and_si256(empty_cells(differ), empty);
+}
+
+/* game_over without moving anything: the board is full and no two cells next to each other hold the */
+/* same tile. Exponent 15 never merges so pairs of those don't count.                                */
+__attribute__((target("avx2")))
+static inline __m256i over_avx2(__m256i board)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i full = _mm256_cmpeq_epi64(empty_cells(board), zero);
+    // Most boards have room left, which settles it without looking for pairs
+    if(_mm256_testz_si256(full, full)) return zero;
+    __m256i top = _mm256_and_si256(_mm256_and_si256(board, shr(board, 1)), _mm256_and_si256(shr(board, 2), shr(board, 3)));
+    top = _mm256_and_si256(top, constant(NIBBLE_LOW));
+
+    __m256i across = _mm256_and_si256(empty_cells(_mm256_xor_si256(board, shr(board, 4))), constant(0x0111011101110111ull));
+    __m256i down = _mm256_and_si256(empty_cells(_mm256_xor_si256(board, shr(board, 16))), constant(0x0000111111111111ull));
+    __m256i pairs = _mm256_andnot_si256(top, _mm256_or_si256(across, down));
+    return _mm256_and_si256(full, _mm256_cmpeq_epi64(pairs, zero));
+}
+
+/* Moves the 16 bit row at shift of every lane through the half of the table at side, adding its score */
+/* to score                                                                                            */
+__attribute__((target("avx2")))
+static inline __m256i move_row_avx2(__m256i board, int shift, __m256i side, __m256i *score)
+{
+    __m256i row = _mm256_or_si256(_mm256_and_si256(shr(board, shift), constant(0xffff)), side);
+    __m256i entry = _mm256_cvtepu32_epi64(_mm256_i64gather_epi32((const int *) move_table, row, 4));
+    *score = _mm256_add_epi64(*score, shr(entry, 16));
+    return shl(_mm256_and_si256(entry, constant(0xffff)), shift);
+}
+
+/* Low 32 bits of each lane, in order */
+__attribute__((target("avx2")))
+static inline __m128i narrow(__m256i x)
+{
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+__attribute__((target("avx2")))
+static void batch_step_avx2(BoardBatch *batch, const u8 *dirs, u64 *changed, u64 *terminal)
+{
+    memset(changed, 0, batch_mask_words(batch->count) * sizeof(u64));
+    memset(terminal, 0, batch_mask_words(batch->count) * sizeof(u64));
+
+    __m256i zero = _mm256_setzero_si256();
+    __m256i one = constant(1);
+    u32 lane = 0;
+    for(; lane + AVX2_LANES <= batch->count; lane += AVX2_LANES)
+    {
+        __m256i board = _mm256_loadu_si256((const __m256i *) &batch->boards[lane]);
+        u32 packed;
+        memcpy(&packed, &dirs[lane], sizeof(packed));
+        __m256i dir = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128((int) packed));
+        // RIGHT and DOWN have bit 0 set, UP and DOWN bit 1
+        __m256i right = _mm256_cmpeq_epi64(_mm256_and_si256(dir, one), one);
+        __m256i vertical = _mm256_cmpeq_epi64(_mm256_and_si256(dir, constant(2)), constant(2));
+
+        __m256i side = _mm256_and_si256(right, constant(65536));
+
+        __m256i rows = pick(vertical, board, transpose_avx2(board));
+        __m256i score = zero;
+        __m256i moved = _mm256_or_si256(_mm256_or_si256(move_row_avx2(rows, 0, side, &score), move_row_avx2(rows, 16, side, &score)),
+                                        _mm256_or_si256(move_row_avx2(rows, 32, side, &score), move_row_avx2(rows, 48, side, &score)));
+        __m256i next = pick(vertical, moved, transpose_avx2(moved));
+        __m256i moving = _mm256_xor_si256(_mm256_cmpeq_epi64(next, board), constant(~0ull));
+
+        // matrix_update: two draws out of the empty cells, the second skipping over the first. The draws
+        // don't depend on the board, so both are taken up front and the lanes that didn't need them keep
+        // their old state afterwards.
+        __m256i original[4], once[4], twice[4];
+        for(int k = 0; k < 4; ++k) original[k] = _mm256_loadu_si256((const __m256i *) &batch->state[k][lane]);
+        memcpy(once, original, sizeof(once));
+        __m256i first_draw = next_avx2(once);
+        memcpy(twice, once, sizeof(twice));
+        __m256i second_draw = next_avx2(twice);
+
+        __m256i empty = empty_cells(next);
+        __m256i before = shl(empty, 4);
+        before = _mm256_add_epi64(before, shl(before, 4));
+        before = _mm256_add_epi64(before, shl(before, 8));
+        before = _mm256_add_epi64(before, shl(before, 16));
+        before = _mm256_add_epi64(before, shl(before, 32));
+        __m256i count = _mm256_add_epi64(shr(before, 60), shr(empty, 60));
+
+        __m256i unsure = zero;
+        __m256i pair = _mm256_and_si256(moving, greater(count, one));
+        __m256i first = bounded_avx2(first_draw, count, moving, &unsure);
+        __m256i second = bounded_avx2(second_draw, _mm256_sub_epi64(count, one), pair, &unsure);
+        second = _mm256_sub_epi64(second, _mm256_xor_si256(greater(first, second), constant(~0ull)));
+        second = pick(pair, first, second);
+
+        __m256i spawned = _mm256_or_si256(nth_empty(empty, before, first), nth_empty(empty, before, second));
+        next = _mm256_or_si256(next, _mm256_and_si256(spawned, moving));
+
+        _mm256_storeu_si256((__m256i *) &batch->boards[lane], next);
+        for(int k = 0; k < 4; ++k)
+        {
+            __m256i state = pick(moving, original[k], pick(pair, once[k], twice[k]));
+            _mm256_storeu_si256((__m256i *) &batch->state[k][lane], state);
+        }
+
+        __m128i points = narrow(_mm256_and_si256(shl(score, 2), moving));
+        __m128i *scores = (__m128i *) &batch->scores[lane];
+        _mm_storeu_si128(scores, _mm_add_epi32(_mm_loadu_si128(scores), points));
+        __m128i *moves = (__m128i *) &batch->moves[lane];
+        _mm_storeu_si128(moves, _mm_sub_epi32(_mm_loadu_si128(moves), narrow(moving)));
+
+        u32 unsure_bits = lane_bits(unsure);
+        if(unsure_bits)
+        {
+            // Put back the board and generator from before the spawn and redo it the way matrix_update
+            // does, rejections and all
+            Board unspawned[AVX2_LANES];
+            u64 saved[4][AVX2_LANES];
+            _mm256_storeu_si256((__m256i *) unspawned, _mm256_andnot_si256(spawned, next));
+            for(int w = 0; w < 4; ++w) _mm256_storeu_si256((__m256i *) saved[w], original[w]);
+            for(int k = 0; k < AVX2_LANES; ++k)
+            {
+                if(!(unsure_bits & (1 << k))) continue;
+                for(int w = 0; w < 4; ++w) batch->state[w][lane + k] = saved[w][k];
+                spawn_lane(batch, lane + k, unspawned[k]);
+            }
+        }
+
+        __m256i over = over_avx2(_mm256_loadu_si256((const __m256i *) &batch->boards[lane]));
+        changed[lane / 64] |= (u64) lane_bits(moving) << (lane % 64);
+        terminal[lane / 64] |= (u64) lane_bits(over) << (lane % 64);
+    }
+
+    step_lanes(batch, lane, dirs, changed, terminal);
+}
+#endif
+
+static const char *kernel_name = "scalar";
+
+BatchStep batch_step = batch_step_scalar;
+
+void batch_init(void)
+{
+    for(u32 row = 0; row < 65536; ++row)
+    {
+        u32 points = (board_move_score((Board) row, LEFT) >> 2) << 16;
+        move_table[row] = (board_move((Board) row, LEFT) & 0xffff) | points;
+        move_table[65536 + row] = (board_move((Board) row, RIGHT) & 0xffff) | points;
+    }
+
+    kernel_name = "scalar";
+    batch_step = batch_step_scalar;
+#ifdef BATCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        kernel_name = "avx2";
+        batch_step = batch_step_avx2;
+    }
+#endif
+}
+
+const char *batch_kernel_name(void)
+{
+    return kernel_name;
+}
@@ -0,0 +1,60 @@
+#include "game.h"
+#include "types.h"
+
+#ifndef BATCH
+#define BATCH
+
+/* Many 4x4 games advanced together, for playouts that only need the rules. The games are stored a     */
+/* field at a time rather than a game at a time so a step can load the boards and generator states of  */
+/* several lanes straight into vector registers. A lane plays exactly the game a Game would with the   */
+/* same board and spawn generator: same moves, same spawns, same score.                                */
+
+typedef struct
+{
+    u32 count;
+    Board *boards;
+    u32 *scores;
+    u32 *moves;
+    /* Spawn generator of every lane split by word, state[k][lane] is s[k] of that lane's Rng */
+    u64 *state[4];
+} BoardBatch;
+
+/* Number of u64 words a mask for count lanes takes. Lane i is bit i % 64 of word i / 64. */
+static inline u32 batch_mask_words(u32 count)
+{
+    return (count + 63) / 64;
+}
+
+static inline b32 batch_mask_get(const u64 *mask, u32 lane)
+{
+    return (mask[lane / 64] >> (lane % 64)) & 1;
+}
+
+/* Must be called once after board_init and before stepping anything. Builds the table the vector */
+/* kernels move rows with and picks the kernel batch_step uses.                                  */
+void batch_init(void);
+
+/* Every lane starts out as an empty board with a zero generator, load games into them before stepping */
+b32 batch_create(BoardBatch *batch, u32 count);
+void batch_destroy(BoardBatch *batch);
+
+/* Copies game's board, score, move count and spawn generator into lane */
+void batch_load(BoardBatch *batch, u32 lane, Game *game);
+/* Copies lane back into game. Its seed and policy_rng aren't part of the batch and are left alone. */
+void batch_store(BoardBatch *batch, u32 lane, Game *game);
+
+/* Moves every lane in dirs[lane], which must be LEFT to DOWN, with the same rules as game_move: a move  */
+/* that changes the board is scored and spawns from the lane's generator, one that doesn't leaves the   */
+/* lane untouched. Sets bit lane of changed if the board moved and of terminal if the lane's game is    */
+/* over afterwards, whether or not it moved. Both masks are batch_mask_words(count) words long and are */
+/* overwritten. The best kernel for this CPU once batch_init has run, batch_step_scalar before that.   */
+typedef void (*BatchStep)(BoardBatch *batch, const u8 *dirs, u64 *changed, u64 *terminal);
+extern BatchStep batch_step;
+
+/* One lane at a time with board_move, matrix_update and game_over. What the other kernels have to match. */
+void batch_step_scalar(BoardBatch *batch, const u8 *dirs, u64 *changed, u64 *terminal);
+
+/* Name of the kernel batch_step uses */
+const char *batch_kernel_name(void);
+
+#endif
@@ -0,0 +1,649 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ai.h"
+#include "batch.h"
+#include "heuristic.h"
+#include "ntuple.h"
+#include "policy.h"
+#include "pool.h"
+#include "record.h"
+#include "rollout.h"
+#include "timing.h"
+
+/* Headless benchmark: plays a batch of games with one of the policies and reports how fast the */
+/* rules run along with what the games looked like. Nothing in here touches X11.               */
+
+/* Most games handed to the pool per task. Big enough that scheduling is noise next to playing them, */
+/* batches too small to give every thread a few tasks are split finer.                               */
+#define GAMES_PER_TASK 64
+
+static int compare_u32(const void *a, const void *b)
+{
+    u32 x = *(const u32 *) a;
+    u32 y = *(const u32 *) b;
+    return (x > y) - (x < y);
+}
+
+/* Written only by the worker it belongs to and merged once the batch is done */
+typedef struct
+{
+    u64 games;
+    u64 moves;
+    /* Bigger boards can go past the 15 a Board cell holds */
+    u32 max_tiles[32];
+    f64 busy;
+    u8 padding[64];
+} WorkerStats;
+
+typedef struct
+{
+    const PolicyEntry *entry;
+    u64 seed;
+    /* Board size. LENGTH plays Game with the policy, anything else GridGame with the grid policy. */
+    u32 size;
+    /* One per worker when the policy is the AI, NULL otherwise */
+    Ai *ais;
+    /* One per worker when the policy is Monte-Carlo, NULL otherwise */
+    Rollout *rollouts;
+    /* Shared by every worker when the policy is the n-tuple network, NULL otherwise */
+    NTupleNetwork *network;
+    /* Indexed by game so the results don't depend on which thread played what */
+    u32 *scores;
+    WorkerStats *workers;
+    /* Every game gets recorded here when set */
+    RecordWriter *writer;
+} Batch;
+
+typedef struct
+{
+    Batch *batch;
+    u64 first;
+    u64 count;
+} GameChunk;
+
+typedef enum
+{
+    PHASE_POLICY,
+    PHASE_MOVE,
+    PHASE_SPAWN,
+    PHASE_CHECK,
+    PHASE_COUNT,
+} Phase;
+
+static const char *phase_names[PHASE_COUNT] = { "policy", "move", "spawn", "game_over" };
+
+static void play_game(Game *game, u64 seed, Policy policy, void *data, GameRecord *record)
+{
+    game_new(game, seed);
+    if(record) game_record_begin(record, game);
+    while(!game_over(game->board))
+    {
+        Dir dir = policy(game, data);
+        game_move(game, dir);
+        if(record) game_record_move(record, dir);
+    }
+}
+
+/* Same as play_game with every phase of a turn timed separately. The timers cost more than the */
+/* moves themselves so this is kept out of the throughput numbers.                              */
+static void play_game_profiled(Game *game, u64 seed, Policy policy, void *data, f64 phase_time[PHASE_COUNT])
+{
+    f64 t0, t1;
+    game_new(game, seed);
+    for(;;)
+    {
+        t0 = timer_now();
+        b32 over = game_over(game->board);
+        t1 = timer_now();
+        phase_time[PHASE_CHECK] += t1 - t0;
+        if(over) break;
+
+        Dir dir = policy(game, data);
+        t0 = timer_now();
+        phase_time[PHASE_POLICY] += t0 - t1;
+
+        Board next = board_move(game->board, dir);
+        game->score += board_move_score(game->board, dir);
+        game->moves += 1;
+        game->board = next;
+        t1 = timer_now();
+        phase_time[PHASE_MOVE] += t1 - t0;
+
+        matrix_update(&game->board, &game->rng);
+        phase_time[PHASE_SPAWN] += timer_now() - t1;
+    }
+}
+
+static void play_grid_game(GridGame *game, u32 size, u64 seed, GridPolicy policy, void *data)
+{
+    grid_game_new(game, size, seed);
+    while(!grid_over(&game->grid))
+    {
+        grid_game_move(game, policy(game, data));
+    }
+}
+
+/* play_chunk for sizes other than LENGTH */
+static void play_grid_chunk(GameChunk *chunk, WorkerStats *stats, void *data)
+{
+    Batch *batch = chunk->batch;
+    GridGame game;
+    for(u64 i = chunk->first; i < chunk->first + chunk->count; ++i)
+    {
+        play_grid_game(&game, batch->size, seed_sequence(batch->seed, i), batch->entry->grid_policy, data);
+        stats->games += 1;
+        stats->moves += game.moves;
+        stats->max_tiles[grid_max_tile(&game.grid) & 31] += 1;
+        batch->scores[i] = game.score;
+    }
+}
+
+static void play_chunk(void *arg, u32 worker)
+{
+    GameChunk *chunk = (GameChunk *) arg;
+    Batch *batch = chunk->batch;
+    WorkerStats *stats = &batch->workers[worker];
+    void *data = batch->ais ? (void *) &batch->ais[worker] : batch->rollouts ? (void *) &batch->rollouts[worker] :
+                 (void *) batch->network;
+
+    f64 start = timer_now();
+    if(batch->size != LENGTH)
+    {
+        play_grid_chunk(chunk, stats, data);
+        stats->busy += timer_now() - start;
+        return;
+    }
+
+    Game game;
+    GameRecord record = {0};
+    for(u64 i = chunk->first; i < chunk->first + chunk->count; ++i)
+    {
+        play_game(&game, seed_sequence(batch->seed, i), batch->entry->policy, data, batch->writer ? &record : NULL);
+        if(batch->writer) record_write(batch->writer, &record, &game);
+        stats->games += 1;
+        stats->moves += game.moves;
+        stats->max_tiles[board_max_tile(game.board)] += 1;
+        batch->scores[i] = game.score;
+    }
+    game_record_free(&record);
+    stats->busy += timer_now() - start;
+}
+
+/* Plays games [0, games) of the batch on the pool and merges the per thread stats into total. */
+/* Returns the wall time taken.                                                                 */
+static f64 run_batch(Batch *batch, Pool *pool, u64 games, WorkerStats *total)
+{
+    u64 per_task = games / (pool->thread_count * 8);
+    if(per_task > GAMES_PER_TASK) per_task = GAMES_PER_TASK;
+    if(per_task == 0) per_task = 1;
+
+    u64 chunk_count = (games + per_task - 1) / per_task;
+    GameChunk *chunks = (GameChunk *) malloc(chunk_count * sizeof(GameChunk));
+    batch->workers = (WorkerStats *) calloc(pool->thread_count, sizeof(WorkerStats));
+
+    f64 start = timer_now();
+    for(u64 i = 0; i < chunk_count; ++i)
+    {
+        chunks[i].batch = batch;
+        chunks[i].first = i * per_task;
+        chunks[i].count = games - chunks[i].first < per_task ? games - chunks[i].first : per_task;
+        pool_submit(pool, play_chunk, &chunks[i]);
+    }
+    pool_wait(pool);
+    f64 elapsed = timer_now() - start;
+
+    *total = (WorkerStats) {0};
+    for(u32 i = 0; i < pool->thread_count; ++i)
+    {
+        WorkerStats *stats = &batch->workers[i];
+        total->games += stats->games;
+        total->moves += stats->moves;
+        total->busy += stats->busy;
+        for(int j = 0; j < 32; ++j) total->max_tiles[j] += stats->max_tiles[j];
+    }
+
+    free(batch->workers);
+    batch->workers = NULL;
+    free(chunks);
+    return elapsed;
+}
+
+static Ai *create_ais(u32 count, AiConfig config)
+{
+    Ai *ais = (Ai *) calloc(count, sizeof(Ai));
+    for(u32 i = 0; i < count; ++i) ai_init(&ais[i], config);
+    return ais;
+}
+
+static void destroy_ais(Ai *ais, u32 count)
+{
+    for(u32 i = 0; i < count; ++i) ai_free(&ais[i]);
+    free(ais);
+}
+
+/* Games are already spread over the threads so every game plays its playouts on the thread it's on */
+static Rollout *create_rollouts(u32 count, RolloutConfig config)
+{
+    Rollout *rollouts = (Rollout *) calloc(count, sizeof(Rollout));
+    for(u32 i = 0; i < count; ++i) rollout_init(&rollouts[i], config, NULL);
+    return rollouts;
+}
+
+static void destroy_rollouts(Rollout *rollouts, u32 count)
+{
+    for(u32 i = 0; i < count; ++i) rollout_free(&rollouts[i]);
+    free(rollouts);
+}
+
+/* Most games the batched playouts keep in flight at once */
+#define BATCH_LANES 1024
+
+typedef struct
+{
+    f64 time;
+    u64 moves;
+    u64 score;
+} PlayoutRun;
+
+/* Playouts the way rollouts play them: any of the four moves, drawn from the game's policy_rng, until */
+/* the game is over. Moves that change nothing just cost a draw. Game i is seeded like in the batch.  */
+static PlayoutRun play_random_games(u64 games, u64 seed)
+{
+    PlayoutRun run = {0};
+    f64 start = timer_now();
+    Game game;
+    for(u64 i = 0; i < games; ++i)
+    {
+        game_new(&game, seed_sequence(seed, i));
+        while(!game_over(game.board))
+        {
+            game_move(&game, (Dir) (rng_next(&game.policy_rng) >> 62));
+        }
+        run.moves += game.moves;
+        run.score += game.score;
+    }
+    run.time = timer_now() - start;
+    return run;
+}
+
+/* The same games BATCH_LANES at a time through step, a new game going into a lane as soon as the */
+/* one in it is over                                                                                */
+static PlayoutRun play_random_batched(u64 games, u64 seed, BatchStep step)
+{
+    PlayoutRun run = {0};
+    u32 lanes = games < BATCH_LANES ? (u32) games : BATCH_LANES;
+    u32 words = batch_mask_words(lanes);
+    BoardBatch batch;
+    batch_create(&batch, lanes);
+    Rng *policy_rngs = (Rng *) malloc(lanes * sizeof(Rng));
+    u8 *dirs = (u8 *) malloc(lanes);
+    u64 *changed = (u64 *) malloc(words * sizeof(u64));
+    u64 *terminal = (u64 *) malloc(words * sizeof(u64));
+    // Lanes still playing a game, the rest hold a finished one once the batch runs out
+    u64 *live = (u64 *) calloc(words, sizeof(u64));
+
+    f64 start = timer_now();
+    Game game;
+    u64 started = 0, finished = 0;
+    for(u32 lane = 0; lane < lanes; ++lane)
+    {
+        game_new(&game, seed_sequence(seed, started++));
+        batch_load(&batch, lane, &game);
+        policy_rngs[lane] = game.policy_rng;
+        live[lane / 64] |= (u64) 1 << (lane % 64);
+    }
+
+    while(finished < games)
+    {
+        for(u32 lane = 0; lane < lanes; ++lane) dirs[lane] = (u8) (rng_next(&policy_rngs[lane]) >> 62);
+        step(&batch, dirs, changed, terminal);
+
+        for(u32 word = 0; word < words; ++word)
+        {
+            u64 over = terminal[word] & live[word];
+            while(over)
+            {
+                u32 lane = word * 64 + __builtin_ctzll(over);
+                over &= over - 1;
+                run.moves += batch.moves[lane];
+                run.score += batch.scores[lane];
+                finished++;
+                if(started == games)
+                {
+                    live[word] &= ~((u64) 1 << (lane % 64));
+                    continue;
+                }
+                game_new(&game, seed_sequence(seed, started++));
+                batch_load(&batch, lane, &game);
+                policy_rngs[lane] = game.policy_rng;
+            }
+        }
+    }
+    run.time = timer_now() - start;
+
+    free(live);
+    free(terminal);
+    free(changed);
+    free(dirs);
+    free(policy_rngs);
+    batch_destroy(&batch);
+    return run;
+}
+
+/* Random playouts one game at a time with game_move and then through the batch kernels on one thread */
+static void report_batched(u64 games, u64 seed)
+{
+    printf("\nrandom playouts, %" PRIu64 " games on one thread, %u lanes per batch\n", games,
+           games < BATCH_LANES ? (u32) games : BATCH_LANES);
+    printf("loop                moves/sec   speedup   same games\n");
+    PlayoutRun base = play_random_games(games, seed);
+    printf("%-16s %12.0f %9.2f %12s\n", "game_move", base.moves / base.time, 1.0, "-");
+
+    const char *names[2] = { "batch scalar", "batch " };
+    BatchStep steps[2] = { batch_step_scalar, batch_step };
+    char name[32];
+    for(u32 i = 0; i < 2; ++i)
+    {
+        PlayoutRun run = play_random_batched(games, seed, steps[i]);
+        snprintf(name, sizeof(name), "%s%s", names[i], i ? batch_kernel_name() : "");
+        printf("%-16s %12.0f %9.2f %12s\n", name, run.moves / run.time, (run.moves / run.time) / (base.moves / base.time),
+               run.moves == base.moves && run.score == base.score ? "yes" : "NO");
+    }
+}
+
+/* Plays the same games with 1, 2, 4 ... max_threads threads and reports how well it scales */
+static void report_scaling(Batch *batch, u64 games, u32 max_threads, b32 use_ai, AiConfig ai_config,
+                           b32 use_rollout, RolloutConfig rollout_config)
+{
+    printf("\nthreads   games/sec   speedup   efficiency\n");
+    f64 base_rate = 0;
+    u32 threads = 1;
+    for(;;)
+    {
+        Pool *pool = pool_create(threads);
+        batch->ais = use_ai ? create_ais(threads, ai_config) : NULL;
+        batch->rollouts = use_rollout ? create_rollouts(threads, rollout_config) : NULL;
+
+        WorkerStats total;
+        f64 elapsed = run_batch(batch, pool, games, &total);
+        f64 rate = total.games / elapsed;
+        if(threads == 1) base_rate = rate;
+        printf("%7u %11.1f %9.2f %11.1f%%\n", threads, rate, rate / base_rate, 100.0 * rate / base_rate / threads);
+
+        if(use_ai) destroy_ais(batch->ais, threads);
+        if(use_rollout) destroy_rollouts(batch->rollouts, threads);
+        batch->ais = NULL;
+        batch->rollouts = NULL;
+        pool_destroy(pool);
+
+        if(threads == max_threads) break;
+        threads = threads * 2 < max_threads ? threads * 2 : max_threads;
+    }
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-g games] [-p policy] [-P profiled games] [-d depth] [-K playouts] [-T ms per move]\n"
+                    "          [-t threads] [-s seed|time] [-S] [-B] [-o record file] [-n board size] [-w weights file] [-N network]\n", name);
+    fprintf(stderr, "policies:");
+    for(u32 i = 0; i < policy_count; ++i) fprintf(stderr, " %s", policies[i].name);
+    fprintf(stderr, " expectimax montecarlo ntuple\n");
+    fprintf(stderr, "-n plays %ux%u to %ux%u boards, expectimax, montecarlo, ntuple, profiling and records only support %ux%u\n",
+            GRID_MIN, GRID_MIN, GRID_MAX, GRID_MAX, LENGTH, LENGTH);
+    fprintf(stderr, "-K sets how many random playouts montecarlo plays per candidate move, -T bounds both searches\n");
+    fprintf(stderr, "-S plays the batch again on 1, 2, 4 ... threads and reports the scaling efficiency\n");
+    fprintf(stderr, "-B plays the batch as random playouts with game_move and with the batch kernels and compares\n");
+    fprintf(stderr, "-w loads the weights the heuristic and expectimax policies evaluate boards with\n");
+    fprintf(stderr, "-N loads a network trained by tf_train for the ntuple policy\n");
+}
+
+int main(int argc, char **argv)
+{
+    u64 games = 10000;
+    i64 profiled_games = -1;
+    u32 threads = 0;
+    u64 seed = DEFAULT_SEED;
+    b32 scaling = false;
+    b32 batched = false;
+    u32 size = LENGTH;
+    const char *record_path = NULL;
+    const char *weights_path = NULL;
+    const char *network_path = NULL;
+    const PolicyEntry *entry = &policies[0];
+    static const PolicyEntry expectimax = { "expectimax", ai_policy, NULL };
+    static const PolicyEntry montecarlo = { "montecarlo", rollout_policy, NULL };
+    static const PolicyEntry ntuple = { "ntuple", ntuple_policy, NULL };
+    AiConfig ai_config = ai_default_config();
+    RolloutConfig rollout_config = rollout_default_config();
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            games = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if(strcmp(argv[i], expectimax.name) == 0) entry = &expectimax;
+            else if(strcmp(argv[i], montecarlo.name) == 0) entry = &montecarlo;
+            else if(strcmp(argv[i], ntuple.name) == 0) entry = &ntuple;
+            else entry = policy_find(argv[i]);
+            if(!entry)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+        {
+            profiled_games = strtoll(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            ai_config.depth = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+        {
+            ai_config.time_budget = strtod(argv[++i], NULL);
+            rollout_config.time_budget = ai_config.time_budget;
+        }
+        else if(strcmp(argv[i], "-K") == 0 && i + 1 < argc)
+        {
+            rollout_config.playouts = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            threads = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            ++i;
+            seed = strcmp(argv[i], "time") == 0 ? rng_seed_from_time() : strtoull(argv[i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            size = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            weights_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-N") == 0 && i + 1 < argc)
+        {
+            network_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-S") == 0)
+        {
+            scaling = true;
+        }
+        else if(strcmp(argv[i], "-B") == 0)
+        {
+            batched = true;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(games == 0) games = 1;
+    if(profiled_games < 0) profiled_games = games / 10 ? games / 10 : 1;
+    if(threads == 0) threads = cpu_count();
+    if(size < GRID_MIN || size > GRID_MAX || (size != LENGTH && (!entry->grid_policy || record_path)) ||
+       (entry == &ntuple && !network_path))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if(size != LENGTH) profiled_games = 0;
+
+    HeuristicWeights weights = heuristic_default_weights();
+    if(weights_path && !heuristic_load_weights(weights_path, &weights)) return 1;
+    NTupleNetwork network = {0};
+    if(network_path && !ntuple_load(&network, network_path))
+    {
+        fprintf(stderr, "%s: %s isn't a network written by tf_train\n", argv[0], network_path);
+        return 1;
+    }
+
+    f64 init_start = timer_now();
+    board_init();
+    batch_init();
+    heuristic_init(&weights);
+    f64 init_time = timer_now() - init_start;
+
+    Pool *pool = pool_create(threads);
+    b32 use_ai = entry == &expectimax;
+    b32 use_rollout = entry == &montecarlo;
+
+    Batch batch = {0};
+    batch.entry = entry;
+    batch.seed = seed;
+    batch.size = size;
+    batch.scores = (u32 *) malloc(games * sizeof(u32));
+    if(use_ai) batch.ais = create_ais(threads, ai_config);
+    if(use_rollout) batch.rollouts = create_rollouts(threads, rollout_config);
+    if(entry == &ntuple) batch.network = &network;
+    if(record_path)
+    {
+        batch.writer = record_writer_open(record_path);
+        if(!batch.writer)
+        {
+            fprintf(stderr, "%s: can't create %s\n", argv[0], record_path);
+            return 1;
+        }
+    }
+
+    WorkerStats stats;
+    f64 elapsed = run_batch(&batch, pool, games, &stats);
+    b32 record_failed = false;
+    if(batch.writer)
+    {
+        record_failed = !record_writer_close(batch.writer);
+        batch.writer = NULL;
+        if(record_failed) fprintf(stderr, "%s: writing %s failed, it is missing games\n", argv[0], record_path);
+    }
+
+    // Profiled games carry on from where the batch stopped so they're different games with the same seed
+    f64 phase_time[PHASE_COUNT] = {0};
+    u64 profiled_moves = 0;
+    Game game;
+    void *profiled_data = use_ai ? (void *) &batch.ais[0] : use_rollout ? (void *) &batch.rollouts[0] : (void *) batch.network;
+    for(i64 i = 0; i < profiled_games; ++i)
+    {
+        play_game_profiled(&game, seed_sequence(seed, games + i), entry->policy, profiled_data, phase_time);
+        profiled_moves += game.moves;
+    }
+
+    printf("policy:      %s\n", entry->name);
+    printf("board:       %ux%u\n", size, size);
+    printf("seed:        %" PRIu64 " (game i is seeded with seed_sequence(seed, i))\n", seed);
+    printf("threads:     %u (%" PRIu64 " steals, %.1f%% busy)\n", threads, (u64) atomic_load(&pool->steals),
+           100.0 * stats.busy / (elapsed * threads));
+    printf("games:       %" PRIu64 "\n", stats.games);
+    printf("moves:       %" PRIu64 " (%.1f per game)\n", stats.moves, (f64) stats.moves / stats.games);
+    printf("table init:  %.3f ms\n", init_time * 1000.0);
+    printf("time:        %.3f s\n", elapsed);
+    printf("moves/sec:   %.0f\n", stats.moves / elapsed);
+    printf("games/sec:   %.1f\n", stats.games / elapsed);
+    if(use_ai)
+    {
+        AiStats ai_stats = {0};
+        for(u32 i = 0; i < threads; ++i) ai_merge_stats(&ai_stats, &batch.ais[i].stats);
+        ai_print_stats(&ai_stats, stdout);
+        printf("ai nodes/sec (all threads): %.0f\n", ai_stats.nodes / elapsed);
+    }
+    if(use_rollout)
+    {
+        RolloutStats rollout_stats = {0};
+        for(u32 i = 0; i < threads; ++i) rollout_merge_stats(&rollout_stats, &batch.rollouts[i].stats);
+        rollout_print_stats(&rollout_stats, stdout);
+        printf("mc playouts/sec (all threads): %.0f\n", rollout_stats.playouts / elapsed);
+    }
+
+    u64 worst = 0;
+    for(u64 i = 1; i < games; ++i)
+    {
+        if(batch.scores[i] < batch.scores[worst]) worst = i;
+    }
+
+    qsort(batch.scores, games, sizeof(u32), compare_u32);
+    f64 score_sum = 0;
+    for(u64 i = 0; i < games; ++i) score_sum += batch.scores[i];
+    printf("\nscore:       mean %.1f  min %u  p10 %u  p50 %u  p90 %u  p99 %u  max %u\n",
+           score_sum / games, batch.scores[0],
+           batch.scores[games / 10], batch.scores[games / 2],
+           batch.scores[games * 9 / 10], batch.scores[games * 99 / 100],
+           batch.scores[games - 1]);
+    printf("worst game:  %" PRIu64 " (seed %" PRIu64 ")\n", worst, seed_sequence(seed, worst));
+
+    printf("\nmax tile     games      share   reached\n");
+    u64 reached = games;
+    for(int i = 1; i < 32; ++i)
+    {
+        if(stats.max_tiles[i])
+        {
+            printf("%-8u %9u  %8.3f%%  %7.3f%%\n", 1u << i, stats.max_tiles[i],
+                   100.0 * stats.max_tiles[i] / games, 100.0 * reached / games);
+        }
+        reached -= stats.max_tiles[i];
+    }
+
+    if(profiled_games > 0 && profiled_moves > 0)
+    {
+        f64 total = 0;
+        for(int i = 0; i < PHASE_COUNT; ++i) total += phase_time[i];
+        printf("\nphases (%" PRIi64 " profiled games, %" PRIu64 " moves, timer overhead included)\n",
+               profiled_games, profiled_moves);
+        for(int i = 0; i < PHASE_COUNT; ++i)
+        {
+            printf("%-10s %10.1f ns/move  %5.1f%%\n", phase_names[i],
+                   phase_time[i] * 1000000000.0 / profiled_moves, 100.0 * phase_time[i] / total);
+        }
+    }
+
+    if(use_ai) destroy_ais(batch.ais, threads);
+    if(use_rollout) destroy_rollouts(batch.rollouts, threads);
+    pool_destroy(pool);
+
+    if(scaling)
+    {
+        report_scaling(&batch, games, threads, use_ai, ai_config, use_rollout, rollout_config);
+    }
+
+    if(batched)
+    {
+        report_batched(games, seed);
+    }
+
+    free(batch.scores);
+    if(network_path) ntuple_free(&network);
+    return record_failed ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "batch.o" ] && rm batch.o
+[ -f "board.o" ] && rm board.o
+[ -f "game.o" ] && rm game.o
+[ -f "grid.o" ] && rm grid.o
+[ -f "ai.o" ] && rm ai.o
+[ -f "heuristic.o" ] && rm heuristic.o
+[ -f "io.o" ] && rm io.o
+[ -f "ntuple.o" ] && rm ntuple.o
+[ -f "policy.o" ] && rm policy.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "record.o" ] && rm record.o
+[ -f "rollout.o" ] && rm rollout.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "bench.o" ] && rm bench.o
+[ -f "tf_bench" ] && rm tf_bench
+
+gcc -Wall -O3 -c ../../source/batch.c
+gcc -Wall -O3 -c ../../source/board.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/grid.c
+gcc -Wall -O3 -c ../../source/ai.c
+gcc -Wall -O3 -c ../../source/heuristic.c
+gcc -Wall -O3 -c ../../source/io.c
+gcc -Wall -O3 -c ../../source/ntuple.c
+gcc -Wall -O3 -c ../../source/policy.c
+gcc -Wall -O3 -c ../../source/pool.c
+gcc -Wall -O3 -c ../../source/record.c
+gcc -Wall -O3 -c ../../source/rollout.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/bench.c
+gcc -O3 -o tf_bench batch.o board.o game.o grid.o ai.o heuristic.o io.o ntuple.o policy.o pool.o record.o rollout.o rng.o bench.o -lpthread
+popd
@@ -0,0 +1,383 @@
+#include <string.h>
+#include "blit.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLIT_X86
+#endif
+
+// Scaled blits are sampled into a buffer this many pixels at a time and then blended in one go
+#define BLIT_CHUNK 256
+
+static inline u32 blend_pixel(u32 dst, u32 src, u32 opacity)
+{
+    if(opacity != 255) src = scale_pixel(src, opacity);
+    return over_pixel(dst, src);
+}
+
+static void blend_span_scalar(u32 *dst, const u32 *src, u32 count, u32 opacity)
+{
+    for(u32 i = 0; i < count; ++i)
+    {
+        dst[i] = blend_pixel(dst[i], src[i], opacity);
+    }
+}
+
+/* a to b by t / 256, two channels per multiply */
+static inline u32 lerp_pixel(u32 a, u32 b, u32 t)
+{
+    u32 rb = (((a & 0x00ff00ff) * (256 - t) + (b & 0x00ff00ff) * t) >> 8) & 0x00ff00ff;
+    u32 ag = (((a >> 8) & 0x00ff00ff) * (256 - t) + ((b >> 8) & 0x00ff00ff) * t) & 0xff00ff00;
+    return rb | ag;
+}
+
+/* Bilinear samples of a bitmap shifted by fx / 256 and fy / 256 of a pixel but not scaled: sample k   */
+/* mixes top[k], top[k + 1], bottom[k] and bottom[k + 1], all of which must be inside the source.      */
+typedef void (*ShiftedSample)(const u32 *top, const u32 *bottom, u32 fx, u32 fy, u32 *out, u32 count);
+
+static void shifted_sample_scalar(const u32 *top, const u32 *bottom, u32 fx, u32 fy, u32 *out, u32 count)
+{
+    for(u32 k = 0; k < count; ++k)
+    {
+        u32 upper = lerp_pixel(top[k], top[k + 1], fx);
+        u32 lower = lerp_pixel(bottom[k], bottom[k + 1], fx);
+        out[k] = lerp_pixel(upper, lower, fy);
+    }
+}
+
+#ifdef BLIT_X86
+/* The vector kernels work on 16 bit lanes, one per channel, and round the same way scale_pixel does so */
+/* every kernel gives exactly the same pixels. Groups of pixels that are all opaque or all clear skip   */
+/* the multiplies, which is most of a tile.                                                            */
+
+/* x / 255 rounded, for x up to 255 * 255 */
+__attribute__((target("sse2")))
+static inline __m128i div255_sse2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/* Each pixel's alpha copied into all four of its lanes */
+__attribute__((target("sse2")))
+static inline __m128i alpha_sse2(__m128i x)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("sse2")))
+static void blend_span_sse2(u32 *dst, const u32 *src, u32 count, u32 opacity)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i alpha_mask = _mm_set1_epi32((i32) ALPHA_MASK);
+    const __m128i fade = _mm_set1_epi16((i16) opacity);
+
+    for(; count >= 4; count -= 4, dst += 4, src += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *) src);
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        if(opacity != 255)
+        {
+            s_lo = div255_sse2(_mm_mullo_epi16(s_lo, fade));
+            s_hi = div255_sse2(_mm_mullo_epi16(s_hi, fade));
+            s = _mm_packus_epi16(s_lo, s_hi);
+        }
+
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff) continue;
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), alpha_mask)) == 0xffff)
+        {
+            _mm_storeu_si128((__m128i *) dst, s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i *) dst);
+        __m128i d_lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, alpha_sse2(s_lo)));
+        __m128i d_hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, alpha_sse2(s_hi)));
+        d = _mm_packus_epi16(div255_sse2(d_lo), div255_sse2(d_hi));
+        _mm_storeu_si128((__m128i *) dst, _mm_add_epi8(s, d));
+    }
+
+    blend_span_scalar(dst, src, count, opacity);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i div255_avx2(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i alpha_avx2(__m256i x)
+{
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+/* Same as the SSE2 kernel 8 pixels at a time. Unpacking and packing both stay inside 128 bit halves so */
+/* the pixels come back out in the order they went in.                                                */
+__attribute__((target("avx2")))
+static void blend_span_avx2(u32 *dst, const u32 *src, u32 count, u32 opacity)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i alpha_mask = _mm256_set1_epi32((i32) ALPHA_MASK);
+    const __m256i fade = _mm256_set1_epi16((i16) opacity);
+
+    for(; count >= 8; count -= 8, dst += 8, src += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *) src);
+        __m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+        __m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+        if(opacity != 255)
+        {
+            s_lo = div255_avx2(_mm256_mullo_epi16(s_lo, fade));
+            s_hi = div255_avx2(_mm256_mullo_epi16(s_hi, fade));
+            s = _mm256_packus_epi16(s_lo, s_hi);
+        }
+
+        if(_mm256_testz_si256(s, s)) continue;
+        if((u32) _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), alpha_mask)) == 0xffffffffu)
+        {
+            _mm256_storeu_si256((__m256i *) dst, s);
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256((const __m256i *) dst);
+        __m256i d_lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(full, alpha_avx2(s_lo)));
+        __m256i d_hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(full, alpha_avx2(s_hi)));
+        d = _mm256_packus_epi16(div255_avx2(d_lo), div255_avx2(d_hi));
+        _mm256_storeu_si256((__m256i *) dst, _mm256_add_epi8(s, d));
+    }
+
+    blend_span_sse2(dst, src, count, opacity);
+}
+
+/* (a * (256 - t) + b * t) >> 8 never goes past 16 bits, so 16 bit lanes give exactly what lerp_pixel does */
+__attribute__((target("avx2")))
+static inline __m256i lerp_avx2(__m256i a, __m256i b, __m256i weight_a, __m256i weight_b)
+{
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(a, weight_a), _mm256_mullo_epi16(b, weight_b)), 8);
+}
+
+__attribute__((target("avx2")))
+static void shifted_sample_avx2(const u32 *top, const u32 *bottom, u32 fx, u32 fy, u32 *out, u32 count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i left = _mm256_set1_epi16((i16) (256 - fx));
+    const __m256i right = _mm256_set1_epi16((i16) fx);
+    const __m256i up = _mm256_set1_epi16((i16) (256 - fy));
+    const __m256i down = _mm256_set1_epi16((i16) fy);
+
+    for(; count >= 8; count -= 8, top += 8, bottom += 8, out += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *) top);
+        __m256i b = _mm256_loadu_si256((const __m256i *) (top + 1));
+        __m256i c = _mm256_loadu_si256((const __m256i *) bottom);
+        __m256i d = _mm256_loadu_si256((const __m256i *) (bottom + 1));
+
+        __m256i upper_lo = lerp_avx2(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero), left, right);
+        __m256i upper_hi = lerp_avx2(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero), left, right);
+        __m256i lower_lo = lerp_avx2(_mm256_unpacklo_epi8(c, zero), _mm256_unpacklo_epi8(d, zero), left, right);
+        __m256i lower_hi = lerp_avx2(_mm256_unpackhi_epi8(c, zero), _mm256_unpackhi_epi8(d, zero), left, right);
+        __m256i lo = lerp_avx2(upper_lo, lower_lo, up, down);
+        __m256i hi = lerp_avx2(upper_hi, lower_hi, up, down);
+        _mm256_storeu_si256((__m256i *) out, _mm256_packus_epi16(lo, hi));
+    }
+
+    shifted_sample_scalar(top, bottom, fx, fy, out, count);
+}
+#endif
+
+static const char *kernel_name = "scalar";
+static ShiftedSample shifted_sample = shifted_sample_scalar;
+
+/* Picks the sampling kernel along with the blend one */
+static SpanBlend select_blend_span(void)
+{
+#ifdef BLIT_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        kernel_name = "avx2";
+        shifted_sample = shifted_sample_avx2;
+        return blend_span_avx2;
+    }
+    if(__builtin_cpu_supports("sse2"))
+    {
+        kernel_name = "sse2";
+        return blend_span_sse2;
+    }
+#endif
+    kernel_name = "scalar";
+    return blend_span_scalar;
+}
+
+/* Same trick as fill_span, the first call picks the kernel */
+static void blend_span_resolve(u32 *dst, const u32 *src, u32 count, u32 opacity)
+{
+    blend_span = select_blend_span();
+    blend_span(dst, src, count, opacity);
+}
+
+SpanBlend blend_span = blend_span_resolve;
+
+const char *blit_kernel_name(void)
+{
+    if(blend_span == blend_span_resolve) blend_span = select_blend_span();
+    return kernel_name;
+}
+
+void blend_rect_pixels(u32 *pixels, u32 stride, Rect area, u32 color)
+{
+    if(rect_empty(area)) return;
+
+    u32 colors[BLIT_CHUNK];
+    u32 chunk = area.width < BLIT_CHUNK ? area.width : BLIT_CHUNK;
+    for(u32 i = 0; i < chunk; ++i) colors[i] = color;
+
+    u32 *row = pixels + area.y * stride + area.x;
+    for(i32 y = 0; y < area.height; ++y, row += stride)
+    {
+        for(i32 x = 0; x < area.width; x += BLIT_CHUNK)
+        {
+            u32 count = area.width - x < BLIT_CHUNK ? area.width - x : BLIT_CHUNK;
+            blend_span(row + x, colors, count, 255);
+        }
+    }
+}
+
+static i32 floor_i32(f64 value)
+{
+    i32 i = (i32) value;
+    return i - (value < i);
+}
+
+static i32 ceil_i32(f64 value)
+{
+    i32 i = (i32) value;
+    return i + (value > i);
+}
+
+Rect blit_bounds(Bitmap *src, f32 x, f32 y, f32 width, f32 height, BlitFilter filter)
+{
+    f64 pad_x = 0, pad_y = 0;
+    if(filter == BLIT_BILINEAR)
+    {
+        pad_x = 0.5 * width / src->width;
+        pad_y = 0.5 * height / src->height;
+    }
+
+    i32 left = floor_i32(x - pad_x);
+    i32 top = floor_i32(y - pad_y);
+    return (Rect) { left, top, ceil_i32(x + width + pad_x) - left, ceil_i32(y + height + pad_y) - top };
+}
+
+/* Coordinates into the source are 16.16 fixed point, stepping step per destination pixel */
+
+static inline u32 texel(const u32 *row, i32 i, i32 width)
+{
+    return row && i >= 0 && i < width ? row[i] : 0;
+}
+
+static void sample_nearest(Bitmap *src, i32 v, i32 u, i32 step, u32 *out, u32 count)
+{
+    i32 j = v >> 16;
+    const u32 *row = j >= 0 && j < src->height ? src->pixels + j * src->stride : NULL;
+    for(u32 k = 0; k < count; ++k, u += step)
+    {
+        out[k] = texel(row, u >> 16, src->width);
+    }
+}
+
+/* u and v are already half a source pixel back, so the integer part is the texel up and to the left of */
+/* the sample and the top 8 bits of the fraction are how far towards the next one it is.                */
+static inline u32 bilinear_texel(const u32 *top, const u32 *bottom, i32 i, u32 fx, u32 fy, i32 width)
+{
+    u32 upper = lerp_pixel(texel(top, i, width), texel(top, i + 1, width), fx);
+    u32 lower = lerp_pixel(texel(bottom, i, width), texel(bottom, i + 1, width), fx);
+    return lerp_pixel(upper, lower, fy);
+}
+
+static void sample_bilinear(Bitmap *src, i32 v, i32 u, i32 step, u32 *out, u32 count)
+{
+    i32 j = v >> 16;
+    u32 fy = (v >> 8) & 0xff;
+    const u32 *top = j >= 0 && j < src->height ? src->pixels + j * src->stride : NULL;
+    const u32 *bottom = j + 1 >= 0 && j + 1 < src->height ? src->pixels + (j + 1) * src->stride : NULL;
+
+    if(step == 1 << 16 && top && bottom)
+    {
+        // Not scaled, only moved by a fraction of a pixel (a sliding tile). Every sample mixes its four
+        // texels by the same amounts and only the ones at the left and right edges can fall outside.
+        i32 i = u >> 16;
+        u32 fx = (u >> 8) & 0xff;
+        i32 inner_first = i < 0 ? -i : 0;
+        i32 inner_end = src->width - 1 - i;
+        if(inner_first > (i32) count) inner_first = count;
+        if(inner_end > (i32) count) inner_end = count;
+        if(inner_end < inner_first) inner_end = inner_first;
+
+        for(i32 k = 0; k < inner_first; ++k) out[k] = bilinear_texel(top, bottom, i + k, fx, fy, src->width);
+        shifted_sample(top + i + inner_first, bottom + i + inner_first, fx, fy, out + inner_first, inner_end - inner_first);
+        for(i32 k = inner_end; k < (i32) count; ++k) out[k] = bilinear_texel(top, bottom, i + k, fx, fy, src->width);
+        return;
+    }
+
+    for(u32 k = 0; k < count; ++k, u += step)
+    {
+        out[k] = bilinear_texel(top, bottom, u >> 16, (u >> 8) & 0xff, fy, src->width);
+    }
+}
+
+static i32 to_fixed(f64 value)
+{
+    return floor_i32(value * 65536.0);
+}
+
+void blit(Bitmap *dst, Rect clip, Bitmap *src, f32 x, f32 y, f32 width, f32 height, BlitFilter filter, u32 opacity)
+{
+    if(width <= 0 || height <= 0 || opacity == 0 || src->width <= 0 || src->height <= 0) return;
+    if(blend_span == blend_span_resolve) blend_span = select_blend_span();
+
+    Rect area = rect_intersect(blit_bounds(src, x, y, width, height, filter), clip);
+    if(rect_empty(area)) return;
+
+    i32 int_x = (i32) x, int_y = (i32) y;
+    if(width == src->width && height == src->height && int_x == x && int_y == y)
+    {
+        // Nothing to sample, both filters land exactly on the source pixels
+        area = rect_intersect(area, (Rect) { int_x, int_y, src->width, src->height });
+        for(i32 row = area.y; row < area.y + area.height; ++row)
+        {
+            blend_span(dst->pixels + row * dst->stride + area.x,
+                       src->pixels + (row - int_y) * src->stride + (area.x - int_x), area.width, opacity);
+        }
+        return;
+    }
+
+    f64 scale_x = (f64) src->width / width;
+    f64 scale_y = (f64) src->height / height;
+    // Destination pixels are sampled at their centres
+    f64 back = filter == BLIT_BILINEAR ? 0.5 : 0.0;
+    i32 u0 = to_fixed((area.x + 0.5 - x) * scale_x - back);
+    i32 v0 = to_fixed((area.y + 0.5 - y) * scale_y - back);
+    i32 step_x = to_fixed(scale_x);
+    i32 step_y = to_fixed(scale_y);
+
+    u32 samples[BLIT_CHUNK];
+    for(i32 row = 0; row < area.height; ++row)
+    {
+        i32 v = v0 + row * step_y;
+        u32 *dest = dst->pixels + (area.y + row) * dst->stride + area.x;
+        for(i32 column = 0; column < area.width; column += BLIT_CHUNK)
+        {
+            u32 count = area.width - column < BLIT_CHUNK ? area.width - column : BLIT_CHUNK;
+            i32 u = u0 + column * step_x;
+            if(filter == BLIT_BILINEAR) sample_bilinear(src, v, u, step_x, samples, count);
+            else sample_nearest(src, v, u, step_x, samples, count);
+            blend_span(dest + column, samples, count, opacity);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include "raster.h"
+#include "types.h"
+
+#ifndef BLIT
+#define BLIT
+
+/* Compositing for everything that isn't a solid colour. Pixels that can be see-through are premultiplied */
+/* ARGB: alpha in the top byte and the colour channels already multiplied by it, so 0 is fully clear and  */
+/* drawing over something is dst * (255 - alpha) / 255 + src on every channel. The X server ignores the   */
+/* top byte of a 24 bit visual so the window buffer can hold these as they are.                          */
+/* All of it is 8 bit fixed point, there are no floats past working out where a blit lands.               */
+
+#define ALPHA_SHIFT 24
+#define ALPHA_MASK  0xff000000u
+
+typedef enum
+{
+    BLIT_NEAREST,
+    BLIT_BILINEAR,
+} BlitFilter;
+
+/* An RGB colour with nothing showing through it */
+static inline u32 opaque(u32 color)
+{
+    return color | ALPHA_MASK;
+}
+
+/* Every channel of a premultiplied pixel times alpha / 255, rounded. Two channels per multiply. */
+static inline u32 scale_pixel(u32 pixel, u32 alpha)
+{
+    u32 rb = (pixel & 0x00ff00ff) * alpha + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    u32 ag = ((pixel >> 8) & 0x00ff00ff) * alpha + 0x00800080;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+    return rb | ag;
+}
+
+/* RGB colour seen through at alpha (0 to 255) as a premultiplied pixel */
+static inline u32 premultiply(u32 color, u32 alpha)
+{
+    return scale_pixel(opaque(color), alpha);
+}
+
+/* src drawn over dst */
+static inline u32 over_pixel(u32 dst, u32 src)
+{
+    return src + scale_pixel(dst, 255 - (src >> ALPHA_SHIFT));
+}
+
+/* Draws count pixels of src over dst, with src faded to opacity (0 to 255) first. Points at the best */
+/* kernel for this CPU after the first call.                                                         */
+typedef void (*SpanBlend)(u32 *dst, const u32 *src, u32 count, u32 opacity);
+extern SpanBlend blend_span;
+
+/* Name of the kernel blend_span uses */
+const char *blit_kernel_name(void);
+
+/* Draws a premultiplied colour over area, which must already be clipped to the buffer */
+void blend_rect_pixels(u32 *pixels, u32 stride, Rect area, u32 color);
+
+/* Pixels a blit of src to x, y, width, height can change. Bilinear edges bleed up to half a source pixel */
+/* past the rectangle.                                                                                   */
+Rect blit_bounds(Bitmap *src, f32 x, f32 y, f32 width, f32 height, BlitFilter filter);
+
+/* Draws the whole of src over dst stretched to width x height with its top left corner at x, y, faded to */
+/* opacity. Positions and sizes can be fractional. Outside src counts as clear so the edges of a scaled   */
+/* or shifted bitmap blend into what is under it. Only pixels inside clip are touched, clip must be      */
+/* inside dst. Whole pixel positions at the source size are straight blend_span calls.                   */
+void blit(Bitmap *dst, Rect clip, Bitmap *src, f32 x, f32 y, f32 width, f32 height, BlitFilter filter, u32 opacity);
+
+#endif
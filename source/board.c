@@ -0,0 +1,242 @@
+#include "board.h"
+
+/* Result of moving a single 16 bit row towards its lowest nibble (LEFT) and towards its highest nibble (RIGHT). */
+/* Indexed by the row itself so a move of the whole board is four lookups. */
+static u16 row_left_table[65536];
+static u16 row_right_table[65536];
+/* Points scored by moving a row. Merges pair up the same tiles whichever way the row moves so this */
+/* doesn't depend on the direction. */
+static u32 row_score_table[65536];
+
+static u16 reverse_row(u16 row)
+{
+    return (row >> 12) | ((row >> 4) & 0x00f0) | ((row << 4) & 0x0f00) | (row << 12);
+}
+
+/* Same rules as the old shift_line/combine_line/shift_line sequence: slide everything over, merge equal */
+/* neighbours starting from the leading edge, then slide again. Exponent 15 is the largest value a nibble */
+/* can hold, so two of those are never merged. */
+static u16 move_row_left(u16 row, u32 *score)
+{
+    u8 line[LENGTH];
+    u8 out[LENGTH] = {0};
+    u32 count = 0;
+
+    for(int i = 0; i < LENGTH; ++i)
+    {
+        line[i] = (row >> (i * 4)) & 0xf;
+    }
+
+    for(int i = 0; i < LENGTH; ++i)
+    {
+        if(line[i]) line[count++] = line[i];
+    }
+
+    u32 idx = 0;
+    for(u32 i = 0; i < count; ++i)
+    {
+        if(i + 1 < count && line[i] == line[i + 1] && line[i] != 0xf)
+        {
+            out[idx++] = line[i] + 1;
+            *score += 1 << (line[i] + 1);
+            i++;
+        }
+        else
+        {
+            out[idx++] = line[i];
+        }
+    }
+
+    u16 result = 0;
+    for(int i = 0; i < LENGTH; ++i)
+    {
+        result |= out[i] << (i * 4);
+    }
+    return result;
+}
+
+void board_init(void)
+{
+    for(u32 row = 0; row < 65536; ++row)
+    {
+        row_score_table[row] = 0;
+        row_left_table[row] = move_row_left(row, &row_score_table[row]);
+        row_right_table[reverse_row(row)] = reverse_row(row_left_table[row]);
+    }
+}
+
+Board board_transpose(Board board)
+{
+    Board a1 = board & 0xf0f00f0ff0f00f0full;
+    Board a2 = board & 0x0000f0f00000f0f0ull;
+    Board a3 = board & 0x0f0f00000f0f0000ull;
+    Board a  = a1 | (a2 << 12) | (a3 >> 12);
+    Board b1 = a & 0xff00ff0000ff00ffull;
+    Board b2 = a & 0x00ff00ff00000000ull;
+    Board b3 = a & 0x00000000ff00ff00ull;
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+/* Reverses the cells of every row */
+static inline Board board_mirror(Board board)
+{
+    return ((board & 0x000f000f000f000full) << 12) | ((board & 0x00f000f000f000f0ull) << 4) |
+           ((board >> 4) & 0x00f000f000f000f0ull) | ((board >> 12) & 0x000f000f000f000full);
+}
+
+/* Reverses the order of the rows */
+static inline Board board_flip(Board board)
+{
+    return (board << 48) | ((board << 16) & 0x0000ffff00000000ull) |
+           ((board >> 16) & 0x00000000ffff0000ull) | (board >> 48);
+}
+
+Board board_symmetry(Board board, u32 symmetry)
+{
+    if(symmetry & 4) board = board_transpose(board);
+    if(symmetry & 1) board = board_mirror(board);
+    if(symmetry & 2) board = board_flip(board);
+    return board;
+}
+
+u32 symmetry_inverse(u32 symmetry)
+{
+    // Mirroring after transposing is undone by transposing after mirroring, which is the same as
+    // flipping after transposing. Everything else undoes itself.
+    static const u8 inverses[SYMMETRY_COUNT] = { 0, 1, 2, 3, 4, 6, 5, 7 };
+    return inverses[symmetry & 7];
+}
+
+Dir dir_symmetry(Dir dir, u32 symmetry)
+{
+    u32 d = dir;
+    // Transposing swaps LEFT with UP and RIGHT with DOWN
+    if(symmetry & 4) d ^= 2;
+    if((symmetry & 1) && (d == LEFT || d == RIGHT)) d ^= 1;
+    if((symmetry & 2) && (d == UP || d == DOWN)) d ^= 1;
+    return (Dir) d;
+}
+
+Board board_canonical(Board board, u32 *symmetry)
+{
+    // Every symmetry from at most 2 steps away from board or its transpose, no branches until the end
+    Board transposed = board_transpose(board);
+    Board boards[SYMMETRY_COUNT];
+    boards[0] = board;
+    boards[1] = board_mirror(board);
+    boards[2] = board_flip(board);
+    boards[3] = board_flip(boards[1]);
+    boards[4] = transposed;
+    boards[5] = board_mirror(transposed);
+    boards[6] = board_flip(transposed);
+    boards[7] = board_flip(boards[5]);
+
+    Board best = boards[0];
+    u32 best_symmetry = 0;
+    for(u32 s = 1; s < SYMMETRY_COUNT; ++s)
+    {
+        b32 smaller = boards[s] < best;
+        best = smaller ? boards[s] : best;
+        best_symmetry = smaller ? s : best_symmetry;
+    }
+    if(symmetry) *symmetry = best_symmetry;
+    return best;
+}
+
+u32 board_empty_count(Board board)
+{
+    // Fold every nibble down to its lowest bit, which ends up set if the cell is occupied.
+    board |= board >> 2;
+    board |= board >> 1;
+    board &= 0x1111111111111111ull;
+    return CELL_NUM - __builtin_popcountll(board);
+}
+
+u8 board_max_tile(Board board)
+{
+    u8 max = 0;
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        u8 val = board & 0xf;
+        if(val > max) max = val;
+        board >>= 4;
+    }
+    return max;
+}
+
+static inline Board move_rows(Board board, u16 *table)
+{
+    return  (Board) table[(board >>  0) & 0xffff] <<  0 |
+            (Board) table[(board >> 16) & 0xffff] << 16 |
+            (Board) table[(board >> 32) & 0xffff] << 32 |
+            (Board) table[(board >> 48) & 0xffff] << 48;
+}
+
+Board board_move(Board board, Dir dir)
+{
+    switch(dir)
+    {
+        case LEFT:  return move_rows(board, row_left_table);
+        case RIGHT: return move_rows(board, row_right_table);
+        case UP:    return board_transpose(move_rows(board_transpose(board), row_left_table));
+        case DOWN:  return board_transpose(move_rows(board_transpose(board), row_right_table));
+    }
+    return board;
+}
+
+u32 board_move_score(Board board, Dir dir)
+{
+    if(dir == UP || dir == DOWN) board = board_transpose(board);
+    return  row_score_table[(board >>  0) & 0xffff] +
+            row_score_table[(board >> 16) & 0xffff] +
+            row_score_table[(board >> 32) & 0xffff] +
+            row_score_table[(board >> 48) & 0xffff];
+}
+
+Board board_move_traced(Board board, Dir dir, u8 destinations[CELL_NUM])
+{
+    i32 start, step, stride;
+    switch(dir)
+    {
+        case LEFT:  start = 0;                         step = 1;       stride = LENGTH; break;
+        case RIGHT: start = LENGTH - 1;                step = -1;      stride = LENGTH; break;
+        case UP:    start = 0;                         step = LENGTH;  stride = 1;      break;
+        case DOWN:  start = (LENGTH - 1) * LENGTH;     step = -LENGTH; stride = 1;      break;
+        default: return board;
+    }
+
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        destinations[i] = NO_TILE;
+    }
+
+    for(int line = 0; line < LENGTH; ++line)
+    {
+        i32 first = start + line * stride;
+        i32 target = first;
+        // Value of the tile that last landed on target and hasn't been merged yet, 0 if there is none.
+        u8 pending = 0;
+
+        for(int i = 0; i < LENGTH; ++i)
+        {
+            i32 idx = first + i * step;
+            u8 val = board_get(board, idx);
+            if(!val) continue;
+
+            if(pending && pending == val && val != 0xf)
+            {
+                destinations[idx] = target;
+                pending = 0;
+                target += step;
+            }
+            else
+            {
+                if(pending) target += step;
+                destinations[idx] = target;
+                pending = val;
+            }
+        }
+    }
+
+    return board_move(board, dir);
+}
@@ -0,0 +1,76 @@
+#include "types.h"
+
+#ifndef BOARD
+#define BOARD
+
+// Number of cells in the grid.
+#define CELL_NUM 16
+
+// Width/height of the grid i.e. LENGTH * LENGTH == CELL_NUM
+#define LENGTH 4
+
+/* The whole 4x4 grid packed into one word. Each cell holds the exponent of its tile in 4 bits (0 = empty), */
+/* cell i = x + y * LENGTH lives in bits [4i, 4i + 4). So row y is the 16 bit value at bit 16y and the      */
+/* leftmost cell of a row is its lowest nibble.                                                             */
+typedef u64 Board;
+
+typedef enum
+{
+    LEFT,
+    RIGHT,
+    UP,
+    DOWN,
+} Dir;
+
+/* Written into the destinations array of board_move_traced for cells that were empty before the move */
+#define NO_TILE 0xff
+
+/* Must be called once before any of the move functions. Builds the row lookup tables. */
+void board_init(void);
+
+/* Hot path. Returns the board after moving every tile in dir, without spawning anything. The move did   */
+/* nothing if the returned board equals the one passed in.                                               */
+Board board_move(Board board, Dir dir);
+
+/* Same result as board_move but also writes, for every cell of the old board, the index of the cell that */
+/* tile ends up in (merged tiles end up in the cell of the tile they merged into). Only meant for things  */
+/* that need to animate the move; it is a lot slower than board_move.                                     */
+Board board_move_traced(Board board, Dir dir, u8 destinations[CELL_NUM]);
+
+/* Points scored by moving in dir, i.e. the sum of the values of all the tiles created by merges. */
+u32 board_move_score(Board board, Dir dir);
+
+Board board_transpose(Board board);
+
+/* The 8 rotations and reflections of the board. Symmetry s transposes the board if s & 4, then mirrors */
+/* it left to right if s & 1 and top to bottom if s & 2. Moves carry over: moving board in dir and then */
+/* applying s gives the same board as applying s and then moving in dir_symmetry(dir, s). Positions     */
+/* that are symmetries of each other are worth the same, so anything keyed by board can be keyed by     */
+/* board_canonical instead and hold up to 8 times fewer entries.                                        */
+#define SYMMETRY_COUNT 8
+
+Board board_symmetry(Board board, u32 symmetry);
+/* Undoes symmetry: board_symmetry(board_symmetry(board, s), symmetry_inverse(s)) == board */
+u32 symmetry_inverse(u32 symmetry);
+Dir dir_symmetry(Dir dir, u32 symmetry);
+
+/* Smallest of the 8 symmetries of board. symmetry, if not NULL, gets the one that makes it, so a move  */
+/* picked on the canonical board is played on board as dir_symmetry(dir, symmetry_inverse(symmetry)).   */
+Board board_canonical(Board board, u32 *symmetry);
+
+u32 board_empty_count(Board board);
+/* Exponent of the largest tile on the board */
+u8 board_max_tile(Board board);
+
+static inline u8 board_get(Board board, u32 index)
+{
+    return (board >> (index * 4)) & 0xf;
+}
+
+static inline Board board_set(Board board, u32 index, u8 value)
+{
+    u32 shift = index * 4;
+    return (board & ~((Board) 0xf << shift)) | ((Board) (value & 0xf) << shift);
+}
+
+#endif
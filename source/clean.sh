@@ -1,15 +1,77 @@
 #!/bin/sh
 
 pushd ../target/release
+[ -f "batch.o" ] && rm batch.o
+[ -f "board.o" ] && rm board.o
 [ -f "colors.o" ] && rm colors.o
 [ -f "draw.o" ] && rm draw.o
+[ -f "font.o" ] && rm font.o
+[ -f "game.o" ] && rm game.o
+[ -f "grid.o" ] && rm grid.o
+[ -f "heuristic.o" ] && rm heuristic.o
+[ -f "journal.o" ] && rm journal.o
+[ -f "ntuple.o" ] && rm ntuple.o
+[ -f "io.o" ] && rm io.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "present.o" ] && rm present.o
+[ -f "raster.o" ] && rm raster.o
+[ -f "record.o" ] && rm record.o
+[ -f "rollout.o" ] && rm rollout.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "scene.o" ] && rm scene.o
+[ -f "timing.o" ] && rm timing.o
 [ -f "twenty_fortyeight.o" ] && rm twenty_fortyeight.o
+[ -f "ai.o" ] && rm ai.o
+[ -f "animate.o" ] && rm animate.o
+[ -f "atlas.o" ] && rm atlas.o
+[ -f "blit.o" ] && rm blit.o
+[ -f "policy.o" ] && rm policy.o
+[ -f "bench.o" ] && rm bench.o
+[ -f "replay.o" ] && rm replay.o
+[ -f "tablebase.o" ] && rm tablebase.o
+[ -f "solve.o" ] && rm solve.o
+[ -f "export.o" ] && rm export.o
+[ -f "latency.o" ] && rm latency.o
+[ -f "session.o" ] && rm session.o
+[ -f "server.o" ] && rm server.o
+[ -f "load.o" ] && rm load.o
+[ -f "render_bench.o" ] && rm render_bench.o
+[ -f "train.o" ] && rm train.o
 [ -f "tf" ] && rm tf
+[ -f "tf_bench" ] && rm tf_bench
+[ -f "tf_replay" ] && rm tf_replay
+[ -f "tf_solve" ] && rm tf_solve
+[ -f "tf_export" ] && rm tf_export
+[ -f "tf_server" ] && rm tf_server
+[ -f "tf_load" ] && rm tf_load
+[ -f "tf_render_bench" ] && rm tf_render_bench
+[ -f "tf_train" ] && rm tf_train
 popd
 
 pushd ../target/debug
+[ -f "ai.o" ] && rm ai.o
+[ -f "animate.o" ] && rm animate.o
+[ -f "atlas.o" ] && rm atlas.o
+[ -f "batch.o" ] && rm batch.o
+[ -f "blit.o" ] && rm blit.o
+[ -f "board.o" ] && rm board.o
 [ -f "colors.o" ] && rm colors.o
 [ -f "draw.o" ] && rm draw.o
+[ -f "font.o" ] && rm font.o
+[ -f "game.o" ] && rm game.o
+[ -f "grid.o" ] && rm grid.o
+[ -f "heuristic.o" ] && rm heuristic.o
+[ -f "journal.o" ] && rm journal.o
+[ -f "ntuple.o" ] && rm ntuple.o
+[ -f "io.o" ] && rm io.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "present.o" ] && rm present.o
+[ -f "raster.o" ] && rm raster.o
+[ -f "record.o" ] && rm record.o
+[ -f "rollout.o" ] && rm rollout.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "scene.o" ] && rm scene.o
+[ -f "timing.o" ] && rm timing.o
 [ -f "twenty_fortyeight.o" ] && rm twenty_fortyeight.o
 [ -f "tf" ] && rm tf
 popd
@@ -4,7 +4,7 @@
 #define RIGHT   (1 << 1)
 #define TOP     (1 << 2)
 #define BOTTOM  (1 << 3)
-void rect(i32 x, i32 y, u32 width, u32 height, u32 color_pixel, XImage *img)
+void rect(i32 x, i32 y, u32 width, u32 height, u32 color_pixel, Bitmap *img)
 {
     // Safety precautions
     // A bit being set in sides indicates that the side should be drawn as it is inside the visible area
@@ -34,12 +34,12 @@ void rect(i32 x, i32 y, u32 width, u32 height, u32 color_pixel, XImage *img)
         sides &= ~BOTTOM;
     }
 
-    u32 *data = (u32 *) img->data;
+    u32 *data = img->pixels;
 
 
-    u32 idx1 = y * img->width + x;
-    u32 idx2 = idx1 + img->width * (height - 1);
-    u32 idx3 = y * img->width + x;
+    u32 idx1 = y * img->stride + x;
+    u32 idx2 = idx1 + img->stride * (height - 1);
+    u32 idx3 = y * img->stride + x;
     u32 idx4 = idx3 + (width - 1);
 
     // All sides visible
@@ -49,19 +49,16 @@ void rect(i32 x, i32 y, u32 width, u32 height, u32 color_pixel, XImage *img)
         // all rectangles if it just drew squares it could be one loop.
         
         // Draw horizontal lines
-        for(u32 i = 0; i < width; ++i)
-        {
-            data[idx1++] = color_pixel;
-            data[idx2++] = color_pixel;
-        }
+        fill_span(data + idx1, width, color_pixel);
+        fill_span(data + idx2, width, color_pixel);
 
         // Draw vertical lines
         for(u32 j = y; j < y + height; ++j)
         {
             data[idx3] = color_pixel;
             data[idx4] = color_pixel;
-            idx3 += img->width;
-            idx4 += img->width;
+            idx3 += img->stride;
+            idx4 += img->stride;
         }
     }
     else 
@@ -72,7 +69,7 @@ void rect(i32 x, i32 y, u32 width, u32 height, u32 color_pixel, XImage *img)
             for(u32 j = y; j < y + height; ++j)
             {
                 data[idx3] = color_pixel;
-                idx3 += img->width;
+                idx3 += img->stride;
             }
         }
 
@@ -82,76 +79,55 @@ void rect(i32 x, i32 y, u32 width, u32 height, u32 color_pixel, XImage *img)
             for(u32 j = y; j < y + height; ++j)
             {
                 data[idx4] = color_pixel;
-                idx4 += img->width;
+                idx4 += img->stride;
             }
         }
 
         // Draw top side
         if((sides & TOP))
         {
-            for(u32 i = 0; i < width; ++i)
-            {
-                data[idx1++] = color_pixel;
-            }
+            fill_span(data + idx1, width, color_pixel);
         }
 
         // Draw bottom side
         if((sides & BOTTOM))
         {
-            for(u32 i = 0; i < width; ++i)
-            {
-                data[idx2++] = color_pixel;
-            }
+            fill_span(data + idx2, width, color_pixel);
         }
     }
 }
 
-void fill_circle(f32 x, f32 y, f32 radius, XImage *buffer, u32 color)
+void fill_circle(f32 x, f32 y, f32 radius, Bitmap *buffer, u32 color)
 {
     i32 centre_x = (i32) (x + 0.5);
     i32 centre_y = (i32) (y + 0.5);
     i32 int_radius = (i32) (radius + 0.5);
     i32 square_radius = (i32) (radius * radius + 0.5);
-    u32 *data = (u32 *) buffer->data;
+    u32 *data = buffer->pixels;
 
-    for(i32 i = -int_radius; i <= 0; ++i)
+    // Every row of the circle is a single span. Rows further from the centre are never wider so the
+    // half width only ever shrinks.
+    i32 half_width = int_radius;
+    for(i32 j = 0; j <= int_radius; ++j)
     {
-        for(i32 j = -int_radius; j <= 0; ++j)
-        {
-            if(j * j + i * i <= square_radius)
-            {
-                i32 x1, x2, y1, y2;
-                x1 = centre_x + i;
-                x2 = centre_x - i;
-                y1 = centre_y + j;
-                y2 = centre_y - j;
-
-                if(x1 >= 0 && x1 < buffer->width)
-                {
-                    if(y1 >= 0 && y1 < buffer->height)
-                    {
-                        data[x1 + y1 * buffer->width] = color;
-                    }
+        while(half_width >= 0 && half_width * half_width + j * j > square_radius) half_width--;
+        if(half_width < 0) break;
 
-                    if(y2 >= 0 && y2 < buffer->height)
-                    {
-                        data[x1 + y2 * buffer->width] = color;
-                    }
-                }
+        i32 left = centre_x - half_width;
+        i32 right = centre_x + half_width;
+        if(left < 0) left = 0;
+        if(right >= buffer->width) right = buffer->width - 1;
+        if(left > right) continue;
 
-                if(x2 >= 0 && x2 < buffer->width)
-                {
-                    if(y1 >= 0 && y1 < buffer->height)
-                    {
-                        data[x2 + y1 * buffer->width] = color;
-                    }
-
-                    if(y2 >= 0 && y2 < buffer->height)
-                    {
-                        data[x2 + y2 * buffer->width] = color;
-                    }
-                }
-            }
+        i32 y1 = centre_y - j;
+        i32 y2 = centre_y + j;
+        if(y1 >= 0 && y1 < buffer->height)
+        {
+            fill_span(data + left + y1 * buffer->stride, right - left + 1, color);
+        }
+        if(j != 0 && y2 >= 0 && y2 < buffer->height)
+        {
+            fill_span(data + left + y2 * buffer->stride, right - left + 1, color);
         }
     }
 }
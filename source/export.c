@@ -0,0 +1,340 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+#include "record.h"
+#include "scene.h"
+#include "timing.h"
+
+/* Turns recorded games into video frames without a display. Every move is played through the same */
+/* animations and scene the window client shows, stepped a fixed time per frame instead of by the   */
+/* clock, and the frames are streamed out as fast as they can be drawn: binary PPMs one after the    */
+/* other, or raw 24 bit RGB. Either one pipes straight into ffmpeg:                                  */
+/*                                                                                                   */
+/*   tf_export games.tfr -g 3 | ffmpeg -f image2pipe -c:v ppm -r 60 -i - game.mp4                    */
+/*   tf_export games.tfr -f rgb | ffmpeg -f rawvideo -pix_fmt rgb24 -s 800x800 -r 60 -i - all.mp4    */
+/*                                                                                                   */
+/* Frames are drawn incrementally like in the window, only what changed since the last frame gets    */
+/* drawn and converted to RGB, the rest of the frame carries over.                                   */
+
+typedef enum
+{
+    FORMAT_PPM,
+    FORMAT_RGB,
+} FrameFormat;
+
+typedef struct
+{
+    u32 size;
+    FrameFormat format;
+    /* Seconds of animation per frame, already sped up */
+    f64 step;
+    /* Frames the last board is shown for once the game over panel is up */
+    u32 hold_frames;
+} ExportConfig;
+
+/* One thread's drawing state. The frame it last wrote stays in target and rgb. */
+typedef struct
+{
+    Scene scene;
+    Bitmap target;
+    u8 *rgb;
+    FILE *file;
+    u64 frames;
+    u64 bytes;
+    b32 failed;
+} Exporter;
+
+typedef struct
+{
+    RecordFile *file;
+    u64 game;
+    ExportConfig *config;
+    Exporter *exporters;
+    const char *pattern;
+    b32 bad;
+} ExportTask;
+
+static void exporter_init(Exporter *exporter, u32 size)
+{
+    memset(exporter, 0, sizeof(*exporter));
+    scene_init(&exporter->scene, size, size, LENGTH);
+    u32 *pixels = (u32 *) calloc((size_t) size * size, sizeof(u32));
+    exporter->target = (Bitmap) { pixels, size, size, size };
+    exporter->rgb = (u8 *) calloc((size_t) size * size, 3);
+}
+
+static void exporter_free(Exporter *exporter)
+{
+    scene_free(&exporter->scene);
+    free(exporter->target.pixels);
+    free(exporter->rgb);
+}
+
+/* Draws the scene as it stands and writes it out as the next frame */
+static void emit_frame(Exporter *exporter, ExportConfig *config)
+{
+    Scene *scene = &exporter->scene;
+    scene_render(scene, &exporter->target);
+    for(u32 i = 0; i < scene->dirty.count; ++i)
+    {
+        pack_rgb_rect(exporter->rgb, exporter->target.pixels, exporter->target.stride, scene->dirty.rects[i]);
+    }
+    scene->dirty.count = 0;
+    if(exporter->failed) return;
+
+    size_t size = (size_t) config->size * config->size * 3;
+    if(config->format == FORMAT_PPM)
+    {
+        int written = fprintf(exporter->file, "P6\n%u %u\n255\n", config->size, config->size);
+        if(written > 0) exporter->bytes += written;
+    }
+    if(fwrite(exporter->rgb, 1, size, exporter->file) != size) exporter->failed = true;
+    exporter->bytes += size;
+    exporter->frames += 1;
+}
+
+/* Runs the animator to the end of what it has queued, a frame every config->step seconds */
+static void emit_animation(Exporter *exporter, ExportConfig *config, Animator *animator)
+{
+    Sprite sprites[GRID_CELLS];
+    while(animator_busy(animator))
+    {
+        animator_advance(animator, config->step);
+        animator_sprites(animator, sprites);
+        scene_set_sprites(&exporter->scene, sprites);
+        emit_frame(exporter, config);
+    }
+}
+
+/* Writes every frame of one game. Returns false if the recording doesn't play back. */
+static b32 export_game(Exporter *exporter, ExportConfig *config, RecordedGame *recorded)
+{
+    Scene *scene = &exporter->scene;
+    GridGame game;
+    grid_game_new(&game, LENGTH, recorded->header.seed);
+    if(grid_to_board(&game.grid) != recorded->header.initial) return false;
+
+    // A new game starts on a clean frame, whatever the last one left behind
+    Animator animator;
+    Sprite sprites[GRID_CELLS];
+    animator_init(&animator, &game.grid);
+    scene_hide_game_over(scene);
+    scene_mark_all_dirty(scene);
+    animator_sprites(&animator, sprites);
+    scene_set_sprites(scene, sprites);
+    emit_frame(exporter, config);
+
+    for(u32 i = 0; i < recorded->header.move_count; ++i)
+    {
+        Dir dir = recorded_move(recorded, i);
+        u8 destinations[GRID_CELLS];
+        Grid before = game.grid;
+        Grid next = before;
+        u32 score = 0;
+        if(!grid_move_traced(&next, dir, &score, destinations)) return false;
+
+        grid_game_move(&game, dir);
+        animator_push(&animator, &before, destinations, &game.grid);
+        emit_animation(exporter, config, &animator);
+    }
+
+    // Fades in the game over panel the way the window does, then holds on it
+    scene_show_game_over(scene, game.score);
+    f64 fade = 0;
+    for(u32 i = 0; i < config->hold_frames || fade < 1.0; ++i)
+    {
+        fade += config->step / GAME_OVER_FADE;
+        scene_set_game_over_opacity(scene, fade < 1.0 ? (u32) (fade * 255.0) : 255);
+        emit_frame(exporter, config);
+        if(fade >= 1.0) fade = 1.0;
+    }
+
+    return grid_to_board(&game.grid) == recorded->header.final && game.score == recorded->header.score;
+}
+
+/* With a file name pattern every game goes to its own file, from whichever thread picks it up */
+static void export_task(void *arg, u32 worker)
+{
+    ExportTask *task = (ExportTask *) arg;
+    Exporter *exporter = &task->exporters[worker];
+
+    RecordedGame recorded;
+    if(!record_game(task->file, task->game, &recorded))
+    {
+        fprintf(stderr, "game %" PRIu64 ": truncated\n", task->game);
+        task->bad = true;
+        return;
+    }
+
+    // The pattern is never a format string, main made sure its only % is the one %u
+    char path[4096];
+    const char *number = strstr(task->pattern, "%u");
+    snprintf(path, sizeof(path), "%.*s%" PRIu64 "%s", (int) (number - task->pattern), task->pattern, task->game, number + 2);
+    exporter->file = fopen(path, "wb");
+    if(!exporter->file)
+    {
+        fprintf(stderr, "can't create %s\n", path);
+        return;
+    }
+    exporter->failed = false;
+    if(!export_game(exporter, task->config, &recorded))
+    {
+        fprintf(stderr, "game %" PRIu64 ": doesn't play back, %s is cut short\n", task->game, path);
+        task->bad = true;
+    }
+    if(fclose(exporter->file) != 0 || exporter->failed) fprintf(stderr, "error writing %s\n", path);
+    exporter->file = NULL;
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s file [-g game] [-o output] [-f ppm|rgb] [-r fps] [-x speed] [-W size] [-j threads]\n", name);
+    fprintf(stderr, "  -g game     only export this game, otherwise every game one after the other\n");
+    fprintf(stderr, "  -o output   file to write the frames to, - for stdout (the default). A name with a %%u in\n");
+    fprintf(stderr, "              it gets one file per game, numbered by game, rendered on -j threads\n");
+    fprintf(stderr, "  -f format   ppm (default) for PPM frames back to back, rgb for raw 24 bit frames\n");
+    fprintf(stderr, "  -r fps      frames per second of animation (default 60)\n");
+    fprintf(stderr, "  -x speed    plays the animations this many times faster (default 1)\n");
+    fprintf(stderr, "  -W size     width and height of the frames in pixels (default 800)\n");
+    fprintf(stderr, "  -j threads  threads for one file per game, 0 for one per CPU (default)\n");
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    i64 single = -1;
+    const char *output = "-";
+    f64 fps = 60.0;
+    f64 speed = 1.0;
+    u32 threads = 0;
+    ExportConfig config = { .size = 800, .format = FORMAT_PPM };
+    for(int i = 2; i < argc; ++i)
+    {
+        if(i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(strcmp(argv[i], "-g") == 0) single = strtoll(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "-o") == 0) output = argv[++i];
+        else if(strcmp(argv[i], "-f") == 0) config.format = strcmp(argv[++i], "rgb") == 0 ? FORMAT_RGB : FORMAT_PPM;
+        else if(strcmp(argv[i], "-r") == 0) fps = strtod(argv[++i], NULL);
+        else if(strcmp(argv[i], "-x") == 0) speed = strtod(argv[++i], NULL);
+        else if(strcmp(argv[i], "-W") == 0) config.size = strtoul(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "-j") == 0) threads = strtoul(argv[++i], NULL, 10);
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(fps <= 0 || speed <= 0 || config.size < 4 * LENGTH)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    config.step = speed / fps;
+    config.hold_frames = (u32) fps;
+
+    RecordFile file;
+    if(!record_open(&file, argv[1]))
+    {
+        fprintf(stderr, "%s: can't read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    u64 first = 0;
+    u64 count = file.game_count;
+    if(single >= 0)
+    {
+        if((u64) single >= file.game_count)
+        {
+            fprintf(stderr, "%s: no game %" PRIi64 "\n", argv[0], single);
+            return 1;
+        }
+        first = single;
+        count = 1;
+    }
+
+    // A % anywhere makes it a pattern, which has to be exactly one %u
+    const char *number = strstr(output, "%u");
+    b32 per_game = strchr(output, '%') != NULL;
+    if(per_game && (!number || strchr(number + 2, '%') || strchr(output, '%') != number))
+    {
+        fprintf(stderr, "%s: %s should have exactly one %%u and no other %%\n", argv[0], output);
+        return 1;
+    }
+
+    board_init();
+    Pool *pool = per_game ? pool_create(threads) : NULL;
+    u32 exporter_count = pool ? pool->thread_count : 1;
+    Exporter *exporters = (Exporter *) malloc(exporter_count * sizeof(Exporter));
+    for(u32 i = 0; i < exporter_count; ++i) exporter_init(&exporters[i], config.size);
+
+    u64 bad = 0;
+    f64 start = timer_now();
+    if(pool)
+    {
+        ExportTask *tasks = (ExportTask *) malloc(count * sizeof(ExportTask));
+        for(u64 i = 0; i < count; ++i)
+        {
+            tasks[i] = (ExportTask) { &file, first + i, &config, exporters, output, false };
+            pool_submit(pool, export_task, &tasks[i]);
+        }
+        pool_wait(pool);
+        for(u64 i = 0; i < count; ++i) bad += tasks[i].bad;
+        free(tasks);
+    }
+    else
+    {
+        Exporter *exporter = &exporters[0];
+        exporter->file = strcmp(output, "-") == 0 ? stdout : fopen(output, "wb");
+        if(!exporter->file)
+        {
+            fprintf(stderr, "%s: can't create %s\n", argv[0], output);
+            return 1;
+        }
+
+        for(u64 i = first; i < first + count && !exporter->failed; ++i)
+        {
+            RecordedGame recorded;
+            if(!record_game(&file, i, &recorded) || !export_game(exporter, &config, &recorded))
+            {
+                fprintf(stderr, "game %" PRIu64 ": doesn't play back, its frames are cut short\n", i);
+                bad++;
+            }
+        }
+        if(fflush(exporter->file) != 0) exporter->failed = true;
+        if(exporter->failed) fprintf(stderr, "%s: error writing %s\n", argv[0], output);
+        if(exporter->file != stdout) fclose(exporter->file);
+    }
+    f64 elapsed = timer_now() - start;
+
+    u64 frames = 0;
+    u64 bytes = 0;
+    for(u32 i = 0; i < exporter_count; ++i)
+    {
+        frames += exporters[i].frames;
+        bytes += exporters[i].bytes;
+        exporter_free(&exporters[i]);
+    }
+    free(exporters);
+    if(pool) pool_destroy(pool);
+
+    // The frames may be going to stdout, so the numbers go to stderr
+    fprintf(stderr, "games:    %" PRIu64 "\n", count);
+    fprintf(stderr, "frames:   %" PRIu64 " (%ux%u, %.1f s of video at %.0f fps)\n",
+            frames, config.size, config.size, frames / fps, fps);
+    fprintf(stderr, "written:  %.1f MB\n", bytes / (1024.0 * 1024.0));
+    fprintf(stderr, "exported in %.3f s (%.0f frames/sec, %.1fx real time)\n",
+            elapsed, frames / elapsed, frames / fps / elapsed);
+
+    record_close(&file);
+    return bad ? 2 : 0;
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "animate.o" ] && rm animate.o
+[ -f "atlas.o" ] && rm atlas.o
+[ -f "blit.o" ] && rm blit.o
+[ -f "board.o" ] && rm board.o
+[ -f "colors.o" ] && rm colors.o
+[ -f "draw.o" ] && rm draw.o
+[ -f "font.o" ] && rm font.o
+[ -f "game.o" ] && rm game.o
+[ -f "grid.o" ] && rm grid.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "raster.o" ] && rm raster.o
+[ -f "record.o" ] && rm record.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "scene.o" ] && rm scene.o
+[ -f "export.o" ] && rm export.o
+[ -f "tf_export" ] && rm tf_export
+
+gcc -Wall -O3 -c ../../source/animate.c
+gcc -Wall -O3 -c ../../source/atlas.c
+gcc -Wall -O3 -c ../../source/blit.c
+gcc -Wall -O3 -c ../../source/board.c
+gcc -Wall -O3 -c ../../source/colors.c
+gcc -Wall -O3 -c ../../source/draw.c
+gcc -Wall -O3 -c ../../source/font.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/grid.c
+gcc -Wall -O3 -c ../../source/pool.c
+gcc -Wall -O3 -c ../../source/raster.c
+gcc -Wall -O3 -c ../../source/record.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/scene.c
+gcc -Wall -O3 -c ../../source/export.c
+gcc -O3 -o tf_export animate.o atlas.o blit.o board.o colors.o draw.o font.o game.o grid.o pool.o raster.o record.o rng.o scene.o export.o -lpthread -lm
+popd
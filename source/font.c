@@ -0,0 +1,76 @@
+#include <string.h>
+#include "font.h"
+
+/* One byte per row, top row first. Bit 4 is the leftmost column. */
+typedef struct
+{
+    char c;
+    u8 rows[GLYPH_HEIGHT];
+} Glyph;
+
+static const Glyph glyphs[] = {
+    { '0', { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e } },
+    { '1', { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e } },
+    { '2', { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f } },
+    { '3', { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e } },
+    { '4', { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 } },
+    { '5', { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e } },
+    { '6', { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e } },
+    { '7', { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e } },
+    { '9', { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'M', { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'G', { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f } },
+    { 'A', { 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 } },
+    { 'C', { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e } },
+    { 'E', { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f } },
+    { 'O', { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e } },
+    { 'R', { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 } },
+};
+
+static const Glyph *find_glyph(char c)
+{
+    for(u32 i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); ++i)
+    {
+        if(glyphs[i].c == c) return &glyphs[i];
+    }
+    return NULL;
+}
+
+u32 text_width(const char *text, u32 scale)
+{
+    u32 length = strlen(text);
+    if(!length) return 0;
+    return (length * (GLYPH_WIDTH + GLYPH_SPACING) - GLYPH_SPACING) * scale;
+}
+
+void draw_text(const char *text, i32 x, i32 y, u32 scale, u32 color, u32 *pixels, u32 stride, Rect clip)
+{
+    for(; *text; ++text, x += (GLYPH_WIDTH + GLYPH_SPACING) * scale)
+    {
+        const Glyph *glyph = find_glyph(*text);
+        if(!glyph) continue;
+
+        for(i32 row = 0; row < GLYPH_HEIGHT; ++row)
+        {
+            // Runs of lit pixels in a row become one span per pixel row of the output
+            for(i32 column = 0; column < GLYPH_WIDTH;)
+            {
+                if(!(glyph->rows[row] & (0x10 >> column)))
+                {
+                    column++;
+                    continue;
+                }
+
+                i32 start = column;
+                while(column < GLYPH_WIDTH && (glyph->rows[row] & (0x10 >> column))) column++;
+
+                Rect run = { x + start * scale, y + row * scale, (column - start) * scale, scale };
+                fill_rect_pixels(pixels, stride, rect_intersect(run, clip), color);
+            }
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#include "raster.h"
+#include "types.h"
+
+#ifndef FONT
+#define FONT
+
+/* Built-in 5x7 bitmap font. Only has what the game writes: digits, the K, M and G suffixes of tile */
+/* values and the letters of GAME OVER and SCORE. Anything else is drawn as a space.                 */
+
+#define GLYPH_WIDTH  5
+#define GLYPH_HEIGHT 7
+// Gap between glyphs, in font pixels
+#define GLYPH_SPACING 1
+
+/* Size of text drawn with every font pixel blown up to scale x scale pixels */
+u32 text_width(const char *text, u32 scale);
+static inline u32 text_height(u32 scale)
+{
+    return GLYPH_HEIGHT * scale;
+}
+
+/* Top left corner of the text at x, y. Nothing is drawn outside clip, which must be inside the buffer. */
+void draw_text(const char *text, i32 x, i32 y, u32 scale, u32 color, u32 *pixels, u32 stride, Rect clip);
+
+#endif
@@ -0,0 +1,60 @@
+#include "game.h"
+
+void matrix_update(Board *board, Rng *rng)
+{
+    u32 empty_count = board_empty_count(*board);
+
+    // Two different cells out of the empty ones, or the only one there is. Drawing the second from the
+    // cells that are left and skipping over the first makes every pair equally likely without retrying.
+    u32 one = rng_bounded(rng, empty_count);
+    u32 two = one;
+    if(empty_count > 1)
+    {
+        two = rng_bounded(rng, empty_count - 1);
+        if(two >= one) two++;
+    }
+
+    u32 empty_idx = 0;
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        if(board_get(*board, i) == 0)
+        {
+            if(empty_idx == one || empty_idx == two)
+            {
+                *board = board_set(*board, i, 1);
+            }
+            empty_idx++;
+        }
+    }
+}
+
+b32 game_over(Board board)
+{
+    if(board_empty_count(board) > 0) return false;
+
+    // A full board can only move if some move merges something, and any merge changes the board.
+    return board_move(board, LEFT) == board && board_move(board, UP) == board;
+}
+
+void game_new(Game *game, u64 seed)
+{
+    game->board = 0;
+    game->score = 0;
+    game->moves = 0;
+    game->seed = seed;
+    rng_seed(&game->policy_rng, seed);
+    game->rng = rng_split(&game->policy_rng);
+    matrix_update(&game->board, &game->rng);
+}
+
+b32 game_move(Game *game, Dir dir)
+{
+    Board next = board_move(game->board, dir);
+    if(next == game->board) return false;
+
+    game->score += board_move_score(game->board, dir);
+    game->moves += 1;
+    game->board = next;
+    matrix_update(&game->board, &game->rng);
+    return true;
+}
@@ -0,0 +1,35 @@
+#include "board.h"
+#include "rng.h"
+
+#ifndef GAME
+#define GAME
+
+/* Everything needed to play a game without a window. */
+typedef struct
+{
+    Board board;
+    u32 score;
+    u32 moves;
+    /* The game is fully determined by this seed and the moves played, which is what lets bad games be replayed */
+    u64 seed;
+    /* Generator the game spawns tiles from */
+    Rng rng;
+    /* For policies that play randomly. Split off from rng so the spawns only depend on the seed, */
+    /* which is what lets a recorded game be replayed from its seed and moves alone.            */
+    Rng policy_rng;
+} Game;
+
+/* Seed benchmarks use when none is given, so runs are comparable */
+#define DEFAULT_SEED 723498734
+
+/* Spawns the new tiles after a move. Only valid for boards with at least one empty cell. */
+void matrix_update(Board *board, Rng *rng);
+b32 game_over(Board board);
+
+/* Sets up a fresh game with its starting tiles. board_init must have been called. */
+void game_new(Game *game, u64 seed);
+
+/* Moves, scores and spawns. Returns false and leaves the game untouched if the move does nothing. */
+b32 game_move(Game *game, Dir dir);
+
+#endif
@@ -0,0 +1,318 @@
+#include <string.h>
+#include "grid.h"
+
+void grid_clear(Grid *grid, u32 size)
+{
+    grid->size = size;
+    memset(grid->cells, 0, sizeof(grid->cells));
+}
+
+Grid grid_from_board(Board board)
+{
+    Grid grid;
+    grid_clear(&grid, LENGTH);
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        grid.cells[i] = board_get(board, i);
+    }
+    return grid;
+}
+
+Board grid_to_board(Grid *grid)
+{
+    Board board = 0;
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        board |= (Board) (grid->cells[i] & 0xf) << (i * 4);
+    }
+    return board;
+}
+
+/* Moves every line of an n x n grid in dir, same rules as move_row_left. Always inlined into the     */
+/* per-size kernels below so n is a constant in each of them and passing NULL destinations drops the */
+/* tracing code. Unlike Board a cell holds a whole byte so there is no cap on merging.              */
+static inline __attribute__((always_inline))
+b32 move_lines(u8 *cells, u32 n, Dir dir, u32 *score, u8 *destinations)
+{
+    i32 start, step, stride;
+    switch(dir)
+    {
+        case LEFT:  start = 0;                   step = 1;         stride = n; break;
+        case RIGHT: start = n - 1;               step = -1;        stride = n; break;
+        case UP:    start = 0;                   step = n;         stride = 1; break;
+        case DOWN:  start = (n - 1) * n;         step = -(i32) n;  stride = 1; break;
+        default: return false;
+    }
+
+    if(destinations) memset(destinations, NO_TILE, n * n);
+
+    b32 moved = false;
+    for(u32 line = 0; line < n; ++line)
+    {
+        i32 first = start + line * stride;
+        u8 out[GRID_MAX];
+        u32 count = 0;
+        // Value of the last tile written to out if it can still be merged into, 0 otherwise
+        u8 pending = 0;
+
+        for(u32 i = 0; i < n; ++i)
+        {
+            i32 idx = first + i * step;
+            u8 val = cells[idx];
+            if(!val) continue;
+
+            if(pending == val)
+            {
+                out[count - 1] = val + 1;
+                *score += 1u << (val + 1);
+                pending = 0;
+            }
+            else
+            {
+                out[count++] = val;
+                pending = val;
+            }
+            if(destinations) destinations[idx] = first + (count - 1) * step;
+        }
+
+        for(u32 i = 0; i < n; ++i)
+        {
+            i32 idx = first + i * step;
+            u8 val = i < count ? out[i] : 0;
+            moved |= cells[idx] != val;
+            cells[idx] = val;
+        }
+    }
+    return moved;
+}
+
+/* True if move_lines would change anything. Cheaper than moving a copy since it stops at the first */
+/* tile that can slide into a gap or merge with its neighbour.                                      */
+static inline __attribute__((always_inline))
+b32 can_move_lines(u8 *cells, u32 n, Dir dir)
+{
+    i32 start, step, stride;
+    switch(dir)
+    {
+        case LEFT:  start = 0;                   step = 1;         stride = n; break;
+        case RIGHT: start = n - 1;               step = -1;        stride = n; break;
+        case UP:    start = 0;                   step = n;         stride = 1; break;
+        case DOWN:  start = (n - 1) * n;         step = -(i32) n;  stride = 1; break;
+        default: return false;
+    }
+
+    for(u32 line = 0; line < n; ++line)
+    {
+        i32 first = start + line * stride;
+        b32 gap = false;
+        u8 previous = 0;
+        for(u32 i = 0; i < n; ++i)
+        {
+            u8 val = cells[first + i * step];
+            if(!val)
+            {
+                gap = true;
+                continue;
+            }
+            if(gap || val == previous) return true;
+            previous = val;
+        }
+    }
+    return false;
+}
+
+typedef b32 (*GridMove)(u8 *cells, Dir dir, u32 *score);
+typedef b32 (*GridMoveTraced)(u8 *cells, Dir dir, u32 *score, u8 *destinations);
+typedef b32 (*GridCanMove)(u8 *cells, Dir dir);
+
+#define GRID_KERNELS(N)                                                                     \
+    static b32 grid_move_##N(u8 *cells, Dir dir, u32 *score)                                \
+    {                                                                                       \
+        return move_lines(cells, N, dir, score, NULL);                                      \
+    }                                                                                       \
+    static b32 grid_move_traced_##N(u8 *cells, Dir dir, u32 *score, u8 *destinations)       \
+    {                                                                                       \
+        return move_lines(cells, N, dir, score, destinations);                              \
+    }                                                                                       \
+    static b32 grid_can_move_##N(u8 *cells, Dir dir)                                        \
+    {                                                                                       \
+        return can_move_lines(cells, N, dir);                                               \
+    }
+
+GRID_KERNELS(3)
+GRID_KERNELS(5)
+GRID_KERNELS(6)
+GRID_KERNELS(7)
+GRID_KERNELS(8)
+
+static Board pack_board(u8 *cells)
+{
+    Board board = 0;
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        board |= (Board) cells[i] << (i * 4);
+    }
+    return board;
+}
+
+static void unpack_board(Board board, u8 *cells)
+{
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        cells[i] = board & 0xf;
+        board >>= 4;
+    }
+}
+
+static b32 grid_move_4(u8 *cells, Dir dir, u32 *score)
+{
+    Board board = pack_board(cells);
+    Board next = board_move(board, dir);
+    if(next == board) return false;
+
+    *score += board_move_score(board, dir);
+    unpack_board(next, cells);
+    return true;
+}
+
+static b32 grid_move_traced_4(u8 *cells, Dir dir, u32 *score, u8 *destinations)
+{
+    Board board = pack_board(cells);
+    Board next = board_move_traced(board, dir, destinations);
+    if(next == board) return false;
+
+    *score += board_move_score(board, dir);
+    unpack_board(next, cells);
+    return true;
+}
+
+static b32 grid_can_move_4(u8 *cells, Dir dir)
+{
+    Board board = pack_board(cells);
+    return board_move(board, dir) != board;
+}
+
+static const GridMove move_kernels[GRID_MAX + 1] = {
+    [3] = grid_move_3, [4] = grid_move_4, [5] = grid_move_5,
+    [6] = grid_move_6, [7] = grid_move_7, [8] = grid_move_8,
+};
+
+static const GridMoveTraced traced_kernels[GRID_MAX + 1] = {
+    [3] = grid_move_traced_3, [4] = grid_move_traced_4, [5] = grid_move_traced_5,
+    [6] = grid_move_traced_6, [7] = grid_move_traced_7, [8] = grid_move_traced_8,
+};
+
+static const GridCanMove can_move_kernels[GRID_MAX + 1] = {
+    [3] = grid_can_move_3, [4] = grid_can_move_4, [5] = grid_can_move_5,
+    [6] = grid_can_move_6, [7] = grid_can_move_7, [8] = grid_can_move_8,
+};
+
+b32 grid_move(Grid *grid, Dir dir, u32 *score)
+{
+    return move_kernels[grid->size](grid->cells, dir, score);
+}
+
+b32 grid_move_traced(Grid *grid, Dir dir, u32 *score, u8 destinations[GRID_CELLS])
+{
+    return traced_kernels[grid->size](grid->cells, dir, score, destinations);
+}
+
+b32 grid_can_move(Grid *grid, Dir dir)
+{
+    return can_move_kernels[grid->size](grid->cells, dir);
+}
+
+u32 grid_empty_count(Grid *grid)
+{
+    u32 count = 0;
+    for(u32 i = 0; i < grid->size * grid->size; ++i)
+    {
+        count += grid->cells[i] == 0;
+    }
+    return count;
+}
+
+u8 grid_max_tile(Grid *grid)
+{
+    u8 max = 0;
+    for(u32 i = 0; i < grid->size * grid->size; ++i)
+    {
+        if(grid->cells[i] > max) max = grid->cells[i];
+    }
+    return max;
+}
+
+void grid_spawn(Grid *grid, Rng *rng)
+{
+    u32 empty_count = grid_empty_count(grid);
+
+    u32 one = rng_bounded(rng, empty_count);
+    u32 two = one;
+    if(empty_count > 1)
+    {
+        two = rng_bounded(rng, empty_count - 1);
+        if(two >= one) two++;
+    }
+
+    u32 empty_idx = 0;
+    for(u32 i = 0; i < grid->size * grid->size; ++i)
+    {
+        if(grid->cells[i] == 0)
+        {
+            if(empty_idx == one || empty_idx == two) grid->cells[i] = 1;
+            empty_idx++;
+        }
+    }
+}
+
+b32 grid_over(Grid *grid)
+{
+    if(grid->size == LENGTH) return game_over(grid_to_board(grid));
+    if(grid_empty_count(grid) > 0) return false;
+
+    // A full grid can only move if two neighbours are equal
+    u32 n = grid->size;
+    for(u32 y = 0; y < n; ++y)
+    {
+        for(u32 x = 0; x < n; ++x)
+        {
+            u8 val = grid->cells[x + y * n];
+            if(x + 1 < n && grid->cells[x + 1 + y * n] == val) return false;
+            if(y + 1 < n && grid->cells[x + (y + 1) * n] == val) return false;
+        }
+    }
+    return true;
+}
+
+void grid_game_new(GridGame *game, u32 size, u64 seed)
+{
+    grid_clear(&game->grid, size);
+    game->score = 0;
+    game->moves = 0;
+    game->seed = seed;
+    rng_seed(&game->policy_rng, seed);
+    game->rng = rng_split(&game->policy_rng);
+    grid_spawn(&game->grid, &game->rng);
+}
+
+b32 grid_game_move(GridGame *game, Dir dir)
+{
+    if(!grid_move(&game->grid, dir, &game->score)) return false;
+
+    game->moves += 1;
+    grid_spawn(&game->grid, &game->rng);
+    return true;
+}
+
+Game grid_game_as_game(GridGame *game)
+{
+    Game result = {
+        .board = grid_to_board(&game->grid),
+        .score = game->score,
+        .moves = game->moves,
+        .seed = game->seed,
+        .rng = game->rng,
+        .policy_rng = game->policy_rng,
+    };
+    return result;
+}
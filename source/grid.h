@@ -0,0 +1,60 @@
+#include "game.h"
+
+#ifndef GRID
+#define GRID
+
+// Smallest and largest board sizes the game can be played on
+#define GRID_MIN 3
+#define GRID_MAX 8
+#define GRID_CELLS (GRID_MAX * GRID_MAX)
+
+/* A board of any size from GRID_MIN to GRID_MAX. One byte per cell holding the exponent of its tile,  */
+/* cell i = x + y * size just like Board. Every size gets its own move kernel with the size known at  */
+/* compile time, and 4x4 grids are moved with the Board lookup tables so they play exactly like Game. */
+typedef struct
+{
+    u32 size;
+    u8 cells[GRID_CELLS];
+} Grid;
+
+/* Game for any board size. Same rules and seeding as Game, so a 4x4 GridGame spawns the same tiles as */
+/* a Game with the same seed and moves.                                                                */
+typedef struct
+{
+    Grid grid;
+    u32 score;
+    u32 moves;
+    u64 seed;
+    Rng rng;
+    Rng policy_rng;
+} GridGame;
+
+/* Empty grid, size must be in [GRID_MIN, GRID_MAX] */
+void grid_clear(Grid *grid, u32 size);
+Grid grid_from_board(Board board);
+/* Only for 4x4 grids */
+Board grid_to_board(Grid *grid);
+
+/* Moves grid in place and adds the points scored to *score. Returns false if nothing moved. */
+b32 grid_move(Grid *grid, Dir dir, u32 *score);
+/* Same as grid_move but also writes where every tile of the old grid ends up, NO_TILE for empty cells. */
+/* See board_move_traced.                                                                               */
+b32 grid_move_traced(Grid *grid, Dir dir, u32 *score, u8 destinations[GRID_CELLS]);
+/* True if dir would change the grid */
+b32 grid_can_move(Grid *grid, Dir dir);
+
+u32 grid_empty_count(Grid *grid);
+/* Exponent of the largest tile */
+u8 grid_max_tile(Grid *grid);
+/* Same as matrix_update. Only valid for grids with at least one empty cell. */
+void grid_spawn(Grid *grid, Rng *rng);
+b32 grid_over(Grid *grid);
+
+/* board_init must have been called, 4x4 grids use its tables */
+void grid_game_new(GridGame *game, u32 size, u64 seed);
+/* Returns false and leaves the game untouched if the move does nothing */
+b32 grid_game_move(GridGame *game, Dir dir);
+/* Only for 4x4 games. The same game as a Game, for the AI and records which only know Board. */
+Game grid_game_as_game(GridGame *game);
+
+#endif
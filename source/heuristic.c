@@ -0,0 +1,178 @@
+#include <stddef.h>
+#include <string.h>
+#include "heuristic.h"
+
+/* Value of every 16 bit line, rows and columns alike. Terms that belong to cells rather than lines are */
+/* split in half since every cell is in one row and one column.                                       */
+static f32 line_table[65536];
+static f32 base_value;
+
+HeuristicWeights heuristic_default_weights()
+{
+    HeuristicWeights weights = {
+        .base = 1000.0f,
+        .empty = 40.0f,
+        .merge = 8.0f,
+        .monotonicity = 1.5f,
+        .monotonicity_power = 2,
+        .smoothness = 0.0f,
+    };
+    return weights;
+}
+
+typedef struct
+{
+    const char *name;
+    size_t offset;
+} WeightName;
+
+static const WeightName weight_names[] = {
+    { "base",         offsetof(HeuristicWeights, base)         },
+    { "empty",        offsetof(HeuristicWeights, empty)        },
+    { "merge",        offsetof(HeuristicWeights, merge)        },
+    { "monotonicity", offsetof(HeuristicWeights, monotonicity) },
+    { "smoothness",   offsetof(HeuristicWeights, smoothness)   },
+};
+#define WEIGHT_NAME_COUNT (sizeof(weight_names) / sizeof(weight_names[0]))
+
+// Exponents go up to 15, anything past this overflows the f32 the power ends up in
+#define MAX_POWER 8
+
+static b32 set_weight(HeuristicWeights *weights, const char *name, f64 value)
+{
+    if(strcmp(name, "monotonicity_power") == 0)
+    {
+        if(value < 0 || value > MAX_POWER || value != (u32) value) return false;
+        weights->monotonicity_power = (u32) value;
+        return true;
+    }
+
+    for(u32 i = 0; i < WEIGHT_NAME_COUNT; ++i)
+    {
+        if(strcmp(name, weight_names[i].name) == 0)
+        {
+            *(f32 *) ((u8 *) weights + weight_names[i].offset) = (f32) value;
+            return true;
+        }
+    }
+    return false;
+}
+
+b32 heuristic_load_weights(const char *path, HeuristicWeights *weights)
+{
+    FILE *file = fopen(path, "r");
+    if(!file)
+    {
+        fprintf(stderr, "%s: can't open weights\n", path);
+        return false;
+    }
+
+    char line[256];
+    u32 number = 0;
+    b32 ok = true;
+    while(fgets(line, sizeof(line), file))
+    {
+        number++;
+        char *comment = strchr(line, '#');
+        if(comment) *comment = 0;
+        for(char *c = line; *c; ++c)
+        {
+            if(*c == '=') *c = ' ';
+        }
+
+        char name[64];
+        f64 value;
+        char extra;
+        int fields = sscanf(line, "%63s %lf %c", name, &value, &extra);
+        if(fields <= 0) continue;
+        if(fields != 2 || !set_weight(weights, name, value))
+        {
+            fprintf(stderr, "%s:%u: expected a weight name and a value\n", path, number);
+            ok = false;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+void heuristic_print_weights(HeuristicWeights *weights, FILE *file)
+{
+    for(u32 i = 0; i < WEIGHT_NAME_COUNT; ++i)
+    {
+        fprintf(file, "%s = %g\n", weight_names[i].name,
+                *(const f32 *) ((const u8 *) weights + weight_names[i].offset));
+    }
+    fprintf(file, "monotonicity_power = %u\n", weights->monotonicity_power);
+}
+
+static f32 evaluate_line(u16 line, HeuristicWeights *weights, f32 powers[16])
+{
+    u8 cells[LENGTH];
+    for(int i = 0; i < LENGTH; ++i)
+    {
+        cells[i] = (line >> (i * 4)) & 0xf;
+    }
+
+    f32 value = 0;
+    f32 increasing = 0, decreasing = 0;
+    for(int i = 0; i < LENGTH; ++i)
+    {
+        if(!cells[i]) value += weights->empty * 0.5f;
+    }
+    for(int i = 0; i < LENGTH - 1; ++i)
+    {
+        u8 a = cells[i], b = cells[i + 1];
+        if(a && a == b) value += weights->merge * a;
+        if(a && b) value -= weights->smoothness * (a > b ? a - b : b - a);
+        if(a > b) decreasing += powers[a] - powers[b];
+        else increasing += powers[b] - powers[a];
+    }
+    value -= weights->monotonicity * (increasing < decreasing ? increasing : decreasing);
+    return value;
+}
+
+void heuristic_init(HeuristicWeights *weights)
+{
+    f32 powers[16];
+    for(u32 exponent = 0; exponent < 16; ++exponent)
+    {
+        powers[exponent] = 1.0f;
+        for(u32 i = 0; i < weights->monotonicity_power; ++i) powers[exponent] *= exponent;
+    }
+
+    base_value = weights->base;
+    for(u32 line = 0; line < 65536; ++line)
+    {
+        line_table[line] = evaluate_line(line, weights, powers);
+    }
+}
+
+static inline f32 evaluate_rows(Board board)
+{
+    return line_table[(board >>  0) & 0xffff] +
+           line_table[(board >> 16) & 0xffff] +
+           line_table[(board >> 32) & 0xffff] +
+           line_table[(board >> 48) & 0xffff];
+}
+
+f32 heuristic_evaluate(Board board)
+{
+    return base_value + evaluate_rows(board) + evaluate_rows(board_transpose(board));
+}
+
+u32 heuristic_evaluate_moves(Board board, Board successors[4], f32 values[4])
+{
+    u32 legal = 0;
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Board next = board_move(board, dir);
+        successors[dir] = next;
+        values[dir] = 0;
+        if(next == board) continue;
+
+        values[dir] = heuristic_evaluate(next);
+        legal |= 1 << dir;
+    }
+    return legal;
+}
@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include "board.h"
+#include "types.h"
+
+#ifndef HEURISTIC
+#define HEURISTIC
+
+/* Static evaluation of 4x4 boards. Every term only looks at one row or column at a time, so the value */
+/* of every possible 16 bit line is worked out once by heuristic_init and a board is scored with eight */
+/* lookups: its four rows and the four rows of its transpose.                                          */
+
+typedef struct
+{
+    /* Added to every board so positions that can still move stay above the value of a dead one */
+    f32 base;
+    /* Per empty cell */
+    f32 empty;
+    /* Per pair of equal tiles next to each other, times their exponent */
+    f32 merge;
+    /* Subtracted per line, times the smaller of how much it rises and how much it falls along its length. */
+    /* Each tile counts as its exponent to the power of monotonicity_power.                               */
+    f32 monotonicity;
+    u32 monotonicity_power;
+    /* Subtracted per pair of tiles next to each other, times the difference of their exponents */
+    f32 smoothness;
+} HeuristicWeights;
+
+HeuristicWeights heuristic_default_weights();
+
+/* Reads a weights file into weights. Each line is a name from HeuristicWeights and a value, optionally */
+/* separated by '=', and '#' starts a comment. Names that aren't in the file keep the value they had.  */
+/* Problems are reported on stderr with their line number and make it return false.                    */
+b32 heuristic_load_weights(const char *path, HeuristicWeights *weights);
+/* Writes weights in the format heuristic_load_weights reads */
+void heuristic_print_weights(HeuristicWeights *weights, FILE *file);
+
+/* Must be called before evaluating anything and again whenever the weights change. Not thread safe, */
+/* the evaluation functions only read the tables so any number of threads can use them after it.     */
+void heuristic_init(HeuristicWeights *weights);
+
+f32 heuristic_evaluate(Board board);
+
+/* Moves board in every direction and evaluates the results. successors[dir] is the board after moving */
+/* in dir and values[dir] its value, or 0 if the move changes nothing. Returns a mask with bit dir set  */
+/* for every move that changes the board.                                                              */
+u32 heuristic_evaluate_moves(Board board, Board successors[4], f32 values[4]);
+
+#endif
@@ -0,0 +1,17 @@
+#include <errno.h>
+#include <unistd.h>
+#include "io.h"
+
+b32 write_all(int fd, const void *data, u64 size)
+{
+    const u8 *bytes = (const u8 *) data;
+    while(size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if(written < 0 && errno == EINTR) continue;
+        if(written <= 0) return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
@@ -0,0 +1,9 @@
+#include "types.h"
+
+#ifndef IO
+#define IO
+
+/* Writes all of data to fd however many writes it takes. Returns false if any of them fails. */
+b32 write_all(int fd, const void *data, u64 size);
+
+#endif
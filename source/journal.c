@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+#include "journal.h"
+
+void journal_begin(Journal *journal, GridGame *game)
+{
+    memset(journal, 0, sizeof(*journal));
+    journal->checkpoint_capacity = 16;
+    journal->checkpoints = (GridGame *) malloc(journal->checkpoint_capacity * sizeof(GridGame));
+    journal->checkpoints[0] = *game;
+    journal->checkpoint_count = 1;
+}
+
+void journal_free(Journal *journal)
+{
+    free(journal->moves);
+    free(journal->checkpoints);
+    memset(journal, 0, sizeof(*journal));
+}
+
+static void append_move(Journal *journal, Dir dir)
+{
+    u32 index = journal->move_count++;
+    if((index >> 2) + 1 > journal->capacity)
+    {
+        journal->capacity = journal->capacity ? journal->capacity * 2 : 256;
+        journal->moves = (u8 *) realloc(journal->moves, journal->capacity);
+    }
+
+    // Clears whatever an undone move left in the byte as well
+    u32 shift = (index & 3) * 2;
+    u8 *byte = &journal->moves[index >> 2];
+    *byte = (*byte & ((1u << shift) - 1)) | (u8) dir << shift;
+}
+
+static void append_checkpoint(Journal *journal, GridGame *game)
+{
+    if(journal->checkpoint_count == journal->checkpoint_capacity)
+    {
+        journal->checkpoint_capacity *= 2;
+        journal->checkpoints = (GridGame *) realloc(journal->checkpoints, journal->checkpoint_capacity * sizeof(GridGame));
+    }
+    journal->checkpoints[journal->checkpoint_count++] = *game;
+}
+
+b32 journal_move(Journal *journal, GridGame *game, Dir dir)
+{
+    if(!grid_game_move(game, dir)) return false;
+
+    // A new move makes everything that was undone unreachable
+    journal->move_count = journal->position;
+    journal->checkpoint_count = journal->position / JOURNAL_CHECKPOINT_INTERVAL + 1;
+
+    append_move(journal, dir);
+    journal->position = journal->move_count;
+    if(journal->position % JOURNAL_CHECKPOINT_INTERVAL == 0) append_checkpoint(journal, game);
+    return true;
+}
+
+void journal_seek(Journal *journal, u32 position, GridGame *game)
+{
+    if(position > journal->move_count) position = journal->move_count;
+
+    u32 checkpoint = position / JOURNAL_CHECKPOINT_INTERVAL;
+    u32 from = checkpoint * JOURNAL_CHECKPOINT_INTERVAL;
+    if(journal->position <= position && journal->position >= from)
+    {
+        // Already past the checkpoint, carry on from here
+        from = journal->position;
+    }
+    else
+    {
+        *game = journal->checkpoints[checkpoint];
+    }
+
+    for(u32 i = from; i < position; ++i)
+    {
+        grid_game_move(game, journal_move_at(journal, i));
+    }
+    journal->position = position;
+}
+
+u32 journal_undo(Journal *journal, GridGame *game, u32 count)
+{
+    if(count > journal->position) count = journal->position;
+    journal_seek(journal, journal->position - count, game);
+    return count;
+}
+
+u32 journal_redo(Journal *journal, GridGame *game, u32 count)
+{
+    if(count > journal->move_count - journal->position) count = journal->move_count - journal->position;
+    journal_seek(journal, journal->position + count, game);
+    return count;
+}
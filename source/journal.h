@@ -0,0 +1,52 @@
+#include "grid.h"
+
+#ifndef JOURNAL
+#define JOURNAL
+
+/* Undo and redo history of one game. A game is fully determined by where it started and the moves   */
+/* played since, spawns included since they come from the game's generator, so the journal keeps the */
+/* moves at 2 bits each plus a copy of the whole game, generator and all, every                      */
+/* JOURNAL_CHECKPOINT_INTERVAL moves. Going to any move restores the checkpoint before it (or carries */
+/* on from the current move when that is closer) and replays at most that many moves, and a game of  */
+/* 100k moves costs around 85 KB.                                                                    */
+
+#define JOURNAL_CHECKPOINT_INTERVAL 256
+
+typedef struct
+{
+    /* Packed 4 to a byte, first move in the lowest bits, the same as records */
+    u8 *moves;
+    u32 move_count;
+    u32 capacity;
+    /* checkpoints[i] is the game after i * JOURNAL_CHECKPOINT_INTERVAL moves */
+    GridGame *checkpoints;
+    u32 checkpoint_count;
+    u32 checkpoint_capacity;
+    /* Number of moves the game is at. Moves past it have been undone and can be redone until a */
+    /* different move is played.                                                                */
+    u32 position;
+} Journal;
+
+/* Starts an empty journal at game */
+void journal_begin(Journal *journal, GridGame *game);
+void journal_free(Journal *journal);
+
+static inline Dir journal_move_at(Journal *journal, u32 index)
+{
+    return (Dir) ((journal->moves[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+/* Plays dir on game, which must be at the journal's position. If it changes the board it is       */
+/* journaled and replaces anything that had been undone. Returns false and leaves both untouched if */
+/* the move does nothing.                                                                          */
+b32 journal_move(Journal *journal, GridGame *game, Dir dir);
+
+/* Puts game in the state it was in after position moves, clamped to the moves in the journal. game */
+/* must be at the journal's position.                                                               */
+void journal_seek(Journal *journal, u32 position, GridGame *game);
+
+/* Steps back or forward up to count moves. Returns how many it went. */
+u32 journal_undo(Journal *journal, GridGame *game, u32 count);
+u32 journal_redo(Journal *journal, GridGame *game, u32 count);
+
+#endif
@@ -0,0 +1,86 @@
+#include <string.h>
+#include <time.h>
+#include "latency.h"
+
+u64 latency_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+void latency_clear(LatencyHistogram *histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+/* Values below LATENCY_SUB_BUCKETS get a bucket each. Above that the top LATENCY_SUB_BITS + 1 bits */
+/* pick the bucket: how far the leading bit is up and the bits just under it.                     */
+static u32 bucket_of(u64 value)
+{
+    if(value < LATENCY_SUB_BUCKETS) return (u32) value;
+    u32 shift = 63 - __builtin_clzll(value) - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (u32) (value >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+/* Largest value that lands in bucket */
+static u64 bucket_top(u32 bucket)
+{
+    if(bucket < LATENCY_SUB_BUCKETS) return bucket;
+    u32 shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    u64 top = bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+void latency_record(LatencyHistogram *histogram, u64 nanoseconds)
+{
+    histogram->counts[bucket_of(nanoseconds)]++;
+    histogram->total++;
+    histogram->sum += nanoseconds;
+    if(nanoseconds > histogram->max) histogram->max = nanoseconds;
+}
+
+void latency_record_many(LatencyHistogram *histogram, u64 nanoseconds, u64 count)
+{
+    histogram->counts[bucket_of(nanoseconds)] += count;
+    histogram->total += count;
+    histogram->sum += nanoseconds * count;
+    if(count && nanoseconds > histogram->max) histogram->max = nanoseconds;
+}
+
+void latency_merge(LatencyHistogram *into, LatencyHistogram *from)
+{
+    for(u32 i = 0; i < LATENCY_BUCKETS; ++i) into->counts[i] += from->counts[i];
+    into->total += from->total;
+    into->sum += from->sum;
+    if(from->max > into->max) into->max = from->max;
+}
+
+u64 latency_percentile(LatencyHistogram *histogram, f64 fraction)
+{
+    if(!histogram->total) return 0;
+
+    u64 rank = (u64) (fraction * histogram->total + 0.5);
+    if(rank == 0) rank = 1;
+    u64 seen = 0;
+    for(u32 i = 0; i < LATENCY_BUCKETS; ++i)
+    {
+        seen += histogram->counts[i];
+        if(seen >= rank)
+        {
+            // The bucket's top can be past anything actually recorded
+            u64 top = bucket_top(i);
+            return top < histogram->max ? top : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void latency_print(LatencyHistogram *histogram, const char *name, FILE *file)
+{
+    f64 mean = histogram->total ? (f64) histogram->sum / histogram->total : 0;
+    fprintf(file, "%s us mean %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f\n", name, mean / 1000.0,
+            latency_percentile(histogram, 0.5) / 1000.0, latency_percentile(histogram, 0.9) / 1000.0,
+            latency_percentile(histogram, 0.99) / 1000.0, latency_percentile(histogram, 0.999) / 1000.0,
+            histogram->max / 1000.0);
+}
@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include "types.h"
+
+#ifndef LATENCY
+#define LATENCY
+
+/* Histogram of latencies for percentiles over millions of samples without keeping them. Buckets are */
+/* powers of two split into LATENCY_SUB_BUCKETS linear steps, so any value is off by at most 1/16th   */
+/* of itself, from nanoseconds up to hours. Recording is a couple of shifts and an increment.        */
+
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef struct
+{
+    u64 counts[LATENCY_BUCKETS];
+    u64 total;
+    u64 max;
+    u64 sum;
+} LatencyHistogram;
+
+/* Nanoseconds on the monotonic clock */
+u64 latency_now(void);
+
+void latency_clear(LatencyHistogram *histogram);
+void latency_record(LatencyHistogram *histogram, u64 nanoseconds);
+/* count samples that all took the same time, e.g. every request answered by one write */
+void latency_record_many(LatencyHistogram *histogram, u64 nanoseconds, u64 count);
+void latency_merge(LatencyHistogram *into, LatencyHistogram *from);
+
+/* Smallest value at least fraction of the samples are no bigger than, rounded up to its bucket */
+u64 latency_percentile(LatencyHistogram *histogram, f64 fraction);
+
+/* One line: mean, p50, p90, p99, p99.9 and max in microseconds */
+void latency_print(LatencyHistogram *histogram, const char *name, FILE *file);
+
+#endif
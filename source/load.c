@@ -0,0 +1,236 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "latency.h"
+#include "protocol.h"
+#include "game.h"
+#include "rng.h"
+
+/* Load generator for tf_server. Opens many connections from one thread and has each of them play */
+/* random games as fast as the server answers, keeping a fixed number of requests in flight on    */
+/* every connection. Every response's round trip time goes into a histogram.                     */
+
+// Most requests in flight on one connection
+#define MAX_DEPTH 64
+
+typedef struct
+{
+    int fd;
+    Rng rng;
+    u64 seed;
+    u32 game;
+    /* Send times of the requests in flight, oldest at head */
+    u64 sent_at[MAX_DEPTH];
+    u32 head;
+    u32 in_flight;
+    /* The game is over and the OP_NEW replacing it has been sent, so the moves still coming back */
+    /* from the old game don't start another one                                                 */
+    b32 restarting;
+    b32 needs_new;
+    u8 partial[sizeof(Response)];
+    u32 partial_length;
+} Connection;
+
+typedef struct
+{
+    u64 responses;
+    u64 games;
+    u64 moves_refused;
+    u64 errors;
+    LatencyHistogram round_trip;
+} LoadStats;
+
+static b32 send_requests(Connection *connection, u32 depth)
+{
+    Request requests[MAX_DEPTH];
+    u32 count = 0;
+    u64 now = latency_now();
+    while(connection->in_flight < depth)
+    {
+        Request *request = &requests[count++];
+        memset(request, 0, sizeof(*request));
+        request->tag = connection->game;
+        if(connection->needs_new)
+        {
+            request->op = OP_NEW;
+            request->seed = seed_sequence(connection->seed, connection->game++);
+            connection->needs_new = false;
+        }
+        else
+        {
+            request->op = OP_MOVE;
+            request->dir = (u8) (rng_next(&connection->rng) >> 62);
+        }
+        connection->sent_at[(connection->head + connection->in_flight++) % MAX_DEPTH] = now;
+    }
+    if(!count) return true;
+
+    // A few hundred bytes never fill a socket buffer that is being read from
+    ssize_t sent = write(connection->fd, requests, count * sizeof(Request));
+    return sent == (ssize_t) (count * sizeof(Request));
+}
+
+static b32 receive(Connection *connection, LoadStats *stats, b32 record)
+{
+    u8 buffer[MAX_DEPTH * sizeof(Response)];
+    memcpy(buffer, connection->partial, connection->partial_length);
+    ssize_t bytes = read(connection->fd, buffer + connection->partial_length, sizeof(buffer) - connection->partial_length);
+    if(bytes <= 0) return bytes < 0 && (errno == EAGAIN || errno == EINTR);
+    u64 now = latency_now();
+
+    u32 total = connection->partial_length + (u32) bytes;
+    u32 count = total / sizeof(Response);
+    for(u32 i = 0; i < count; ++i)
+    {
+        Response response;
+        memcpy(&response, buffer + i * sizeof(Response), sizeof(Response));
+        u64 sent_at = connection->sent_at[connection->head];
+        connection->head = (connection->head + 1) % MAX_DEPTH;
+        connection->in_flight--;
+
+        if(response.op == OP_NEW) connection->restarting = false;
+        else if(response.over && !connection->restarting)
+        {
+            connection->restarting = true;
+            connection->needs_new = true;
+            if(record) stats->games++;
+        }
+
+        if(!record) continue;
+        stats->responses++;
+        latency_record(&stats->round_trip, now - sent_at);
+        if(response.status == STATUS_NO_MOVE) stats->moves_refused++;
+        else if(response.status != STATUS_OK) stats->errors++;
+    }
+    connection->partial_length = total - count * sizeof(Response);
+    memcpy(connection->partial, buffer + count * sizeof(Response), connection->partial_length);
+    return true;
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-S socket path] [-c connections] [-p pipeline depth] [-d seconds] [-w warmup seconds] [-s seed]\n", name);
+    fprintf(stderr, "  -c connections  sessions played at once (default 1000)\n");
+    fprintf(stderr, "  -p depth        requests each one keeps in flight, up to %u (default 1)\n", MAX_DEPTH);
+    fprintf(stderr, "  -d seconds      how long to measure for (default 5)\n");
+    fprintf(stderr, "  -w seconds      played before measuring starts (default 1)\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = SERVER_DEFAULT_PATH;
+    u32 connection_count = 1000;
+    u32 depth = 1;
+    f64 duration = 5;
+    f64 warmup = 1;
+    u64 seed = DEFAULT_SEED;
+    for(int i = 1; i < argc; i += 2)
+    {
+        if(i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(strcmp(argv[i], "-S") == 0) path = argv[i + 1];
+        else if(strcmp(argv[i], "-c") == 0) connection_count = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-p") == 0) depth = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-d") == 0) duration = strtod(argv[i + 1], NULL);
+        else if(strcmp(argv[i], "-w") == 0) warmup = strtod(argv[i + 1], NULL);
+        else if(strcmp(argv[i], "-s") == 0) seed = strtoull(argv[i + 1], NULL, 10);
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(connection_count == 0 || depth == 0 || depth > MAX_DEPTH)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long\n", argv[0]);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    Connection *connections = (Connection *) calloc(connection_count, sizeof(Connection));
+    for(u32 i = 0; i < connection_count; ++i)
+    {
+        Connection *connection = &connections[i];
+        // Connecting blocks while the server's backlog is full, which it empties as fast as it can
+        connection->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(connection->fd < 0 || connect(connection->fd, (struct sockaddr *) &address, sizeof(address)) < 0)
+        {
+            fprintf(stderr, "%s: connection %u to %s failed: %s\n", argv[0], i, path, strerror(errno));
+            return 1;
+        }
+
+        connection->seed = seed_sequence(seed, i);
+        rng_seed(&connection->rng, seed_sequence(connection->seed, ~0ull));
+        connection->needs_new = true;
+        struct epoll_event event = { .events = EPOLLIN, .data.u32 = i };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection->fd, &event);
+    }
+
+    for(u32 i = 0; i < connection_count; ++i)
+    {
+        if(!send_requests(&connections[i], depth))
+        {
+            fprintf(stderr, "%s: send failed: %s\n", argv[0], strerror(errno));
+            return 1;
+        }
+    }
+
+    LoadStats stats = {0};
+    struct epoll_event events[256];
+    u64 start = latency_now();
+    u64 measure_from = start + (u64) (warmup * 1e9);
+    u64 end = measure_from + (u64) (duration * 1e9);
+    b32 measuring = false;
+    for(;;)
+    {
+        u64 now = latency_now();
+        if(now >= end) break;
+        if(!measuring && now >= measure_from)
+        {
+            measuring = true;
+            measure_from = now;
+        }
+
+        int count = epoll_wait(epoll_fd, events, 256, 100);
+        if(count < 0 && errno != EINTR) break;
+        for(int i = 0; i < count; ++i)
+        {
+            Connection *connection = &connections[events[i].data.u32];
+            if(!receive(connection, &stats, measuring) || !send_requests(connection, depth))
+            {
+                fprintf(stderr, "%s: server went away\n", argv[0]);
+                return 1;
+            }
+        }
+    }
+    f64 elapsed = (latency_now() - measure_from) / 1e9;
+
+    printf("connections: %u, %u in flight on each\n", connection_count, depth);
+    printf("requests:    %" PRIu64 " in %.2f s (%.0f/sec)\n", stats.responses, elapsed, stats.responses / elapsed);
+    printf("games:       %" PRIu64 " finished\n", stats.games);
+    printf("refused:     %" PRIu64 " moves that didn't change the board\n", stats.moves_refused);
+    printf("errors:      %" PRIu64 "\n", stats.errors);
+    latency_print(&stats.round_trip, "round trip", stdout);
+
+    for(u32 i = 0; i < connection_count; ++i) close(connections[i].fd);
+    free(connections);
+    close(epoll_fd);
+    return stats.errors ? 2 : 0;
+}
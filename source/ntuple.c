@@ -0,0 +1,262 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io.h"
+#include "ntuple.h"
+
+static const char file_magic[4] = { 'T', 'F', 'N', 'T' };
+
+typedef struct
+{
+    u32 tuple_count;
+    u8 lengths[NTUPLE_MAX_TUPLES];
+    u8 cells[NTUPLE_MAX_TUPLES][NTUPLE_MAX_LENGTH];
+} Layout;
+
+static const Layout layouts[] = {
+    [NTUPLE_LAYOUT_SMALL] = {
+        .tuple_count = 4,
+        .lengths = { 4, 4, 4, 4 },
+        .cells = {
+            { 0, 1, 2, 3 },
+            { 4, 5, 6, 7 },
+            { 0, 1, 4, 5 },
+            { 5, 6, 9, 10 },
+        },
+    },
+    [NTUPLE_LAYOUT_LARGE] = {
+        .tuple_count = 4,
+        .lengths = { 6, 6, 6, 6 },
+        .cells = {
+            { 0, 1, 2, 3, 4, 5 },
+            { 4, 5, 6, 7, 8, 9 },
+            { 0, 1, 2, 4, 5, 6 },
+            { 4, 5, 6, 8, 9, 10 },
+        },
+    },
+};
+
+/* Where cell ends up in symmetry s: s & 4 transposes, s & 1 mirrors left to right, s & 2 top to bottom */
+static u8 transform_cell(u8 cell, u32 s)
+{
+    u32 x = cell % LENGTH;
+    u32 y = cell / LENGTH;
+    if(s & 4)
+    {
+        u32 t = x;
+        x = y;
+        y = t;
+    }
+    if(s & 1) x = LENGTH - 1 - x;
+    if(s & 2) y = LENGTH - 1 - y;
+    return (u8) (x + y * LENGTH);
+}
+
+static u64 table_length(u32 tuple_length)
+{
+    return (u64) 1 << (4 * tuple_length);
+}
+
+/* Everything but the weights themselves, from the tuples' cells */
+static void set_tuples(NTupleNetwork *network, u32 tuple_count, const u8 *lengths, const u8 (*cells)[NTUPLE_MAX_LENGTH])
+{
+    network->tuple_count = tuple_count;
+    network->weight_count = 0;
+    for(u32 t = 0; t < tuple_count; ++t)
+    {
+        network->lengths[t] = lengths[t];
+        memcpy(network->cells[t], cells[t], NTUPLE_MAX_LENGTH);
+        for(u32 s = 0; s < NTUPLE_SYMMETRIES; ++s)
+        {
+            for(u32 k = 0; k < lengths[t]; ++k) network->placements[t][s][k] = transform_cell(cells[t][k], s);
+        }
+        network->weight_count += table_length(lengths[t]);
+    }
+}
+
+/* Points tables into weights */
+static void set_tables(NTupleNetwork *network, f32 *weights)
+{
+    for(u32 t = 0; t < network->tuple_count; ++t)
+    {
+        network->tables[t] = weights;
+        weights += table_length(network->lengths[t]);
+    }
+}
+
+void ntuple_create(NTupleNetwork *network, NTupleLayout layout)
+{
+    memset(network, 0, sizeof(*network));
+    const Layout *l = &layouts[layout];
+    set_tuples(network, l->tuple_count, l->lengths, l->cells);
+
+    network->size = network->weight_count * sizeof(f32);
+    network->data = (u8 *) calloc(network->weight_count, sizeof(f32));
+    set_tables(network, (f32 *) network->data);
+}
+
+b32 ntuple_load(NTupleNetwork *network, const char *path)
+{
+    memset(network, 0, sizeof(*network));
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (u64) st.st_size < NTUPLE_TABLE_OFFSET)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Private so training can carry on in the mapping without touching the file until it saves
+    void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return false;
+
+    NTupleHeader header;
+    memcpy(&header, data, sizeof(header));
+    b32 valid = memcmp(header.magic, file_magic, 4) == 0 && header.version == NTUPLE_VERSION &&
+                header.tuple_count > 0 && header.tuple_count <= NTUPLE_MAX_TUPLES;
+    for(u32 t = 0; valid && t < header.tuple_count; ++t)
+    {
+        valid = header.lengths[t] > 0 && header.lengths[t] <= NTUPLE_MAX_LENGTH;
+        for(u32 k = 0; valid && k < header.lengths[t]; ++k) valid = header.cells[t][k] < CELL_NUM;
+    }
+    if(valid)
+    {
+        set_tuples(network, header.tuple_count, header.lengths, header.cells);
+        valid = NTUPLE_TABLE_OFFSET + network->weight_count * sizeof(f32) == (u64) st.st_size;
+    }
+    if(!valid)
+    {
+        munmap(data, st.st_size);
+        memset(network, 0, sizeof(*network));
+        return false;
+    }
+
+    network->data = (u8 *) data;
+    network->size = st.st_size;
+    network->mapped = true;
+    network->games = header.games;
+    network->moves = header.moves;
+    network->seed = header.seed;
+    set_tables(network, (f32 *) (network->data + NTUPLE_TABLE_OFFSET));
+    // Lookups land all over the tables
+    madvise(data, st.st_size, MADV_RANDOM);
+    return true;
+}
+
+b32 ntuple_save(NTupleNetwork *network, const char *path)
+{
+    char temporary[4096];
+    if(snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int) sizeof(temporary)) return false;
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+
+    u8 page[NTUPLE_TABLE_OFFSET] = {0};
+    NTupleHeader header = {0};
+    memcpy(header.magic, file_magic, 4);
+    header.version = NTUPLE_VERSION;
+    header.tuple_count = network->tuple_count;
+    memcpy(header.lengths, network->lengths, sizeof(header.lengths));
+    memcpy(header.cells, network->cells, sizeof(header.cells));
+    header.games = network->games;
+    header.moves = network->moves;
+    header.seed = network->seed;
+    memcpy(page, &header, sizeof(header));
+
+    // The tables are one block whichever way the network was made. Threads still training while this
+    // runs just make the file a mix of weights from before and after their updates.
+    b32 ok = write_all(fd, page, sizeof(page)) &&
+             write_all(fd, network->tables[0], network->weight_count * sizeof(f32));
+    ok = fsync(fd) == 0 && ok;
+    ok = close(fd) == 0 && ok;
+    if(ok) ok = rename(temporary, path) == 0;
+    if(!ok) unlink(temporary);
+    return ok;
+}
+
+void ntuple_free(NTupleNetwork *network)
+{
+    if(network->mapped) munmap(network->data, network->size);
+    else free(network->data);
+    memset(network, 0, sizeof(*network));
+}
+
+/* Index into tuple t's table of the cells it covers in symmetry s */
+static inline u32 feature(NTupleNetwork *network, Board board, u32 t, u32 s)
+{
+    const u8 *cells = network->placements[t][s];
+    u32 index = 0;
+    for(u32 k = 0; k < network->lengths[t]; ++k) index |= (u32) board_get(board, cells[k]) << (4 * k);
+    return index;
+}
+
+// Weights are read and written relaxed so training threads can share them without locks. On x86 these
+// are plain loads and stores, two threads adding to the same weight at once can lose one of the adds.
+static inline f32 load_weight(f32 *weight)
+{
+    f32 value;
+    __atomic_load(weight, &value, __ATOMIC_RELAXED);
+    return value;
+}
+
+static inline void store_weight(f32 *weight, f32 value)
+{
+    __atomic_store(weight, &value, __ATOMIC_RELAXED);
+}
+
+f32 ntuple_evaluate(NTupleNetwork *network, Board board)
+{
+    f32 value = 0;
+    for(u32 t = 0; t < network->tuple_count; ++t)
+    {
+        f32 *table = network->tables[t];
+        for(u32 s = 0; s < NTUPLE_SYMMETRIES; ++s) value += load_weight(&table[feature(network, board, t, s)]);
+    }
+    return value;
+}
+
+void ntuple_update(NTupleNetwork *network, Board board, f32 delta)
+{
+    for(u32 t = 0; t < network->tuple_count; ++t)
+    {
+        f32 *table = network->tables[t];
+        for(u32 s = 0; s < NTUPLE_SYMMETRIES; ++s)
+        {
+            f32 *weight = &table[feature(network, board, t, s)];
+            store_weight(weight, load_weight(weight) + delta);
+        }
+    }
+}
+
+Dir ntuple_choose(NTupleNetwork *network, Board board, f32 *value)
+{
+    Dir best = LEFT;
+    f32 best_value = 0;
+    b32 found = false;
+    for(u32 d = 0; d < 4; ++d)
+    {
+        Board after = board_move(board, (Dir) d);
+        if(after == board) continue;
+
+        f32 v = (f32) board_move_score(board, (Dir) d) + ntuple_evaluate(network, after);
+        if(!found || v > best_value)
+        {
+            found = true;
+            best = (Dir) d;
+            best_value = v;
+        }
+    }
+    if(value) *value = best_value;
+    return best;
+}
+
+Dir ntuple_policy(Game *game, void *data)
+{
+    return ntuple_choose((NTupleNetwork *) data, game->board, NULL);
+}
@@ -0,0 +1,97 @@
+#include "game.h"
+#include "types.h"
+
+#ifndef NTUPLE
+#define NTUPLE
+
+/* Board evaluation learned by tf_train. A tuple is a few cells of the board, and the exponents in them */
+/* index a table of weights: 4 bits per cell, so a tuple of n cells has 16^n weights. Every tuple is    */
+/* looked at in all 8 rotations and reflections of the board and the value of a board is the sum of    */
+/* every weight that gets picked, so what is learned about a pattern in one corner holds in all four.   */
+/*                                                                                                      */
+/* File layout, everything in the machine's byte order:                                                */
+/*                                                                                                      */
+/*   header   NTupleHeader, padded to NTUPLE_TABLE_OFFSET                                               */
+/*   tables   f32 weights of every tuple back to back, tuple 0 first                                    */
+/*                                                                                                      */
+/* The tables start on a page boundary so a file can be mapped and played with straight away.           */
+
+#define NTUPLE_VERSION 1
+#define NTUPLE_MAX_TUPLES 8
+#define NTUPLE_MAX_LENGTH 6
+#define NTUPLE_SYMMETRIES 8
+#define NTUPLE_TABLE_OFFSET 4096
+
+typedef enum
+{
+    /* Two rows and two 2x2 squares, 4 cells each. 1 MB of weights, learns fast but tops out early. */
+    NTUPLE_LAYOUT_SMALL,
+    /* Four 6 cell tuples: two 3x2 rectangles and two bent lines, one of each on the edge and one a */
+    /* row in. 256 MB of weights.                                                                   */
+    NTUPLE_LAYOUT_LARGE,
+} NTupleLayout;
+
+typedef struct
+{
+    char magic[4];
+    u32 version;
+    u32 tuple_count;
+    u32 padding;
+    u8 lengths[NTUPLE_MAX_TUPLES];
+    /* Cells of every tuple as laid out on the board, x + y * LENGTH */
+    u8 cells[NTUPLE_MAX_TUPLES][NTUPLE_MAX_LENGTH];
+    /* Training so far, so a run can carry on where the last one stopped */
+    u64 games;
+    u64 moves;
+    u64 seed;
+} NTupleHeader;
+
+typedef struct
+{
+    u32 tuple_count;
+    u8 lengths[NTUPLE_MAX_TUPLES];
+    u8 cells[NTUPLE_MAX_TUPLES][NTUPLE_MAX_LENGTH];
+    /* The cells of every tuple in each of the 8 symmetries of the board */
+    u8 placements[NTUPLE_MAX_TUPLES][NTUPLE_SYMMETRIES][NTUPLE_MAX_LENGTH];
+    f32 *tables[NTUPLE_MAX_TUPLES];
+    u64 weight_count;
+
+    /* Either the network was loaded and this is the file mapped copy on write, or it was created */
+    /* and this is the weights on the heap                                                        */
+    u8 *data;
+    u64 size;
+    b32 mapped;
+
+    u64 games;
+    u64 moves;
+    u64 seed;
+} NTupleNetwork;
+
+/* A network of layout with every weight 0 */
+void ntuple_create(NTupleNetwork *network, NTupleLayout layout);
+/* Maps a file written by ntuple_save. The weights can be changed, the file stays as it is. */
+b32 ntuple_load(NTupleNetwork *network, const char *path);
+/* Writes a new file next to path and renames it over path, so path always holds a whole network */
+b32 ntuple_save(NTupleNetwork *network, const char *path);
+void ntuple_free(NTupleNetwork *network);
+
+/* Weights picked per board, tuples times symmetries */
+static inline u32 ntuple_feature_count(NTupleNetwork *network)
+{
+    return network->tuple_count * NTUPLE_SYMMETRIES;
+}
+
+f32 ntuple_evaluate(NTupleNetwork *network, Board board);
+
+/* Adds delta to every weight board picks. Any number of threads can update and evaluate at the same */
+/* time without locking: updates that collide on a weight can lose one of them, which training       */
+/* shrugs off, but nothing is ever torn.                                                           */
+void ntuple_update(NTupleNetwork *network, Board board, f32 delta);
+
+/* Move whose score plus the value of the board it leaves (before the spawn) is highest, and that   */
+/* value. board must not be game over. board_init must have been called.                           */
+Dir ntuple_choose(NTupleNetwork *network, Board board, f32 *value);
+/* Policy wrapper around ntuple_choose, data is the network */
+Dir ntuple_policy(Game *game, void *data);
+
+#endif
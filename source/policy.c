@@ -0,0 +1,132 @@
+#include <string.h>
+#include "heuristic.h"
+#include "policy.h"
+
+const PolicyEntry policies[] = {
+    { "random",    policy_random,      grid_policy_random      },
+    { "order",     policy_fixed_order, grid_policy_fixed_order },
+    { "greedy",    policy_greedy,      grid_policy_greedy      },
+    { "heuristic", policy_heuristic,   NULL                    },
+};
+const u32 policy_count = sizeof(policies) / sizeof(policies[0]);
+
+Dir policy_random(Game *game, void *data)
+{
+    Board board = game->board;
+    Dir legal[4];
+    u32 count = 0;
+
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        if(board_move(board, dir) != board) legal[count++] = dir;
+    }
+    return legal[rng_bounded(&game->policy_rng, count)];
+}
+
+Dir policy_fixed_order(Game *game, void *data)
+{
+    Board board = game->board;
+    static const Dir order[4] = { LEFT, UP, RIGHT, DOWN };
+
+    for(int i = 0; i < 4; ++i)
+    {
+        if(board_move(board, order[i]) != board) return order[i];
+    }
+    return LEFT;
+}
+
+Dir policy_greedy(Game *game, void *data)
+{
+    Board board = game->board;
+    Dir best = LEFT;
+    i64 best_value = -1;
+
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Board next = board_move(board, dir);
+        if(next == board) continue;
+
+        i64 value = (i64) board_move_score(board, dir) * CELL_NUM + board_empty_count(next);
+        if(value > best_value)
+        {
+            best_value = value;
+            best = dir;
+        }
+    }
+    return best;
+}
+
+Dir policy_heuristic(Game *game, void *data)
+{
+    Board successors[4];
+    f32 values[4];
+    u32 legal = heuristic_evaluate_moves(game->board, successors, values);
+
+    Dir best = LEFT;
+    f32 best_value = 0;
+    b32 found = false;
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        if(!(legal & (1 << dir))) continue;
+        if(!found || values[dir] > best_value)
+        {
+            best_value = values[dir];
+            best = dir;
+            found = true;
+        }
+    }
+    return best;
+}
+
+Dir grid_policy_random(GridGame *game, void *data)
+{
+    Dir legal[4];
+    u32 count = 0;
+
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        if(grid_can_move(&game->grid, dir)) legal[count++] = dir;
+    }
+    return legal[rng_bounded(&game->policy_rng, count)];
+}
+
+Dir grid_policy_fixed_order(GridGame *game, void *data)
+{
+    static const Dir order[4] = { LEFT, UP, RIGHT, DOWN };
+
+    for(int i = 0; i < 4; ++i)
+    {
+        if(grid_can_move(&game->grid, order[i])) return order[i];
+    }
+    return LEFT;
+}
+
+Dir grid_policy_greedy(GridGame *game, void *data)
+{
+    Dir best = LEFT;
+    i64 best_value = -1;
+
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Grid next = game->grid;
+        u32 score = 0;
+        if(!grid_move(&next, dir, &score)) continue;
+
+        i64 value = (i64) score * GRID_CELLS + grid_empty_count(&next);
+        if(value > best_value)
+        {
+            best_value = value;
+            best = dir;
+        }
+    }
+    return best;
+}
+
+const PolicyEntry *policy_find(const char *name)
+{
+    for(u32 i = 0; i < policy_count; ++i)
+    {
+        if(strcmp(policies[i].name, name) == 0) return &policies[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,40 @@
+#include "game.h"
+#include "grid.h"
+
+#ifndef POLICY
+#define POLICY
+
+/* Picks the next move for a game that isn't over. The returned move must change the board. Policies */
+/* that need randomness draw from the game's policy_rng. data is whatever state the policy needs, it */
+/* can be NULL for the simple ones.                                                                 */
+typedef Dir (*Policy)(Game *game, void *data);
+/* The same for boards of any size */
+typedef Dir (*GridPolicy)(GridGame *game, void *data);
+
+typedef struct
+{
+    const char *name;
+    Policy policy;
+    /* NULL for policies that only play 4x4 boards */
+    GridPolicy grid_policy;
+} PolicyEntry;
+
+/* Uniformly random move out of the ones that change the board */
+Dir policy_random(Game *game, void *data);
+/* First move that changes the board out of LEFT, UP, RIGHT, DOWN */
+Dir policy_fixed_order(Game *game, void *data);
+/* Move with the highest immediate score, ties broken by the number of empty cells it leaves */
+Dir policy_greedy(Game *game, void *data);
+/* Move whose result heuristic_evaluate likes best, needs heuristic_init */
+Dir policy_heuristic(Game *game, void *data);
+
+Dir grid_policy_random(GridGame *game, void *data);
+Dir grid_policy_fixed_order(GridGame *game, void *data);
+Dir grid_policy_greedy(GridGame *game, void *data);
+
+/* Returns NULL if there is no policy called name */
+const PolicyEntry *policy_find(const char *name);
+extern const PolicyEntry policies[];
+extern const u32 policy_count;
+
+#endif
@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+
+/* Index of the worker the current thread is, -1 on threads that don't belong to a pool */
+static __thread i32 current_worker = -1;
+static __thread Pool *current_pool = NULL;
+
+typedef struct
+{
+    Pool *pool;
+    u32 index;
+} WorkerStart;
+
+u32 cpu_count()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32) count : 1;
+}
+
+static void deque_push(TaskDeque *deque, Task task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if(deque->tail == deque->capacity)
+    {
+        if(deque->head > 0)
+        {
+            // Slide everything back down to the start before growing
+            u32 count = deque->tail - deque->head;
+            for(u32 i = 0; i < count; ++i) deque->tasks[i] = deque->tasks[deque->head + i];
+            deque->head = 0;
+            deque->tail = count;
+        }
+        if(deque->tail == deque->capacity)
+        {
+            deque->capacity = deque->capacity ? deque->capacity * 2 : 64;
+            deque->tasks = (Task *) realloc(deque->tasks, deque->capacity * sizeof(Task));
+        }
+    }
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static b32 deque_pop(TaskDeque *deque, Task *task)
+{
+    b32 found = false;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->tail > deque->head)
+    {
+        *task = deque->tasks[--deque->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static b32 deque_steal(TaskDeque *deque, Task *task)
+{
+    b32 found = false;
+    // Waited on even when busy: the lock is only held for a few instructions, and a worker that skipped
+    // a busy deque could find nothing anywhere while queued says there is work and spin without sleeping
+    pthread_mutex_lock(&deque->lock);
+
+    if(deque->tail > deque->head)
+    {
+        *task = deque->tasks[deque->head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static b32 find_task(Pool *pool, u32 worker, Task *task)
+{
+    if(deque_pop(&pool->deques[worker], task)) return true;
+
+    for(u32 i = 1; i < pool->thread_count; ++i)
+    {
+        u32 victim = (worker + i) % pool->thread_count;
+        if(deque_steal(&pool->deques[victim], task))
+        {
+            atomic_fetch_add(&pool->steals, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *worker_main(void *arg)
+{
+    WorkerStart *start = (WorkerStart *) arg;
+    Pool *pool = start->pool;
+    u32 worker = start->index;
+    free(start);
+
+    current_worker = worker;
+    current_pool = pool;
+
+    for(;;)
+    {
+        Task task;
+        if(find_task(pool, worker, &task))
+        {
+            atomic_fetch_sub(&pool->queued, 1);
+            task.func(task.arg, worker);
+
+            if(atomic_fetch_sub(&pool->pending, 1) == 1)
+            {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->all_done);
+                pthread_mutex_unlock(&pool->lock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while(!pool->shutting_down && atomic_load(&pool->queued) == 0)
+        {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        b32 done = pool->shutting_down && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if(done) break;
+    }
+    return NULL;
+}
+
+Pool *pool_create(u32 thread_count)
+{
+    Pool *pool = (Pool *) calloc(1, sizeof(Pool));
+    pool->thread_count = thread_count ? thread_count : cpu_count();
+    pool->threads = (pthread_t *) calloc(pool->thread_count, sizeof(pthread_t));
+    pool->deques = (TaskDeque *) calloc(pool->thread_count, sizeof(TaskDeque));
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->steals, 0);
+    atomic_init(&pool->next_deque, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+
+    for(u32 i = 0; i < pool->thread_count; ++i)
+    {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    for(u32 i = 0; i < pool->thread_count; ++i)
+    {
+        WorkerStart *start = (WorkerStart *) malloc(sizeof(WorkerStart));
+        start->pool = pool;
+        start->index = i;
+        pthread_create(&pool->threads[i], NULL, worker_main, start);
+    }
+    return pool;
+}
+
+void pool_destroy(Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = true;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(u32 i = 0; i < pool->thread_count; ++i)
+    {
+        pthread_join(pool->threads[i], NULL);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_cond_destroy(&pool->all_done);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+void pool_submit(Pool *pool, TaskFunc func, void *arg)
+{
+    Task task = { func, arg };
+    u32 deque;
+    if(current_pool == pool)
+    {
+        deque = current_worker;
+    }
+    else
+    {
+        // Any number of outside threads can be submitting at once
+        deque = atomic_fetch_add(&pool->next_deque, 1) % pool->thread_count;
+    }
+
+    atomic_fetch_add(&pool->pending, 1);
+    deque_push(&pool->deques[deque], task);
+    atomic_fetch_add(&pool->queued, 1);
+
+    // Taking the lock before signalling means a worker can't check queued and then miss the wakeup
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_wait(Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while(atomic_load(&pool->pending) != 0)
+    {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,62 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include "types.h"
+
+#ifndef POOL
+#define POOL
+
+/* worker is the index of the thread running the task, in [0, pool->thread_count). Tasks use it to */
+/* pick their per-thread state so nothing needs locking.                                           */
+typedef void (*TaskFunc)(void *arg, u32 worker);
+
+typedef struct
+{
+    TaskFunc func;
+    void *arg;
+} Task;
+
+/* Each worker owns one of these. The owner pushes and pops at the tail, idle workers steal from the */
+/* head so they take the oldest (usually biggest) pieces of work.                                    */
+typedef struct
+{
+    pthread_mutex_t lock;
+    Task *tasks;
+    u32 head;
+    u32 tail;
+    u32 capacity;
+    /* Keeps the deques of different workers on different cache lines */
+    u8 padding[64];
+} TaskDeque;
+
+typedef struct
+{
+    u32 thread_count;
+    pthread_t *threads;
+    TaskDeque *deques;
+
+    /* Tasks sitting in a deque and tasks not finished yet */
+    atomic_uint queued;
+    atomic_uint pending;
+    atomic_ullong steals;
+    /* Round robin counter for tasks submitted from outside the pool */
+    atomic_uint next_deque;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    pthread_cond_t all_done;
+    b32 shutting_down;
+} Pool;
+
+/* 0 threads means one per online CPU */
+Pool *pool_create(u32 thread_count);
+void pool_destroy(Pool *pool);
+
+/* From a worker the task goes on that worker's own deque, otherwise the deques are filled round robin */
+void pool_submit(Pool *pool, TaskFunc func, void *arg);
+
+/* Blocks until every submitted task has finished. Must not be called from inside a task. */
+void pool_wait(Pool *pool);
+
+u32 cpu_count();
+
+#endif
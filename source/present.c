@@ -0,0 +1,191 @@
+#include <X11/Xutil.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <stdlib.h>
+#include <string.h>
+#include "present.h"
+
+/* XShmAttach fails asynchronously through the error handler, e.g. when the server is on another machine */
+static b32 attach_failed;
+
+static int attach_error_handler(Display *display, XErrorEvent *error)
+{
+    attach_failed = true;
+    return 0;
+}
+
+static b32 create_shm_image(Presenter *presenter, u32 index, Visual *visual)
+{
+    XShmSegmentInfo *segment = &presenter->segments[index];
+    XImage *image = XShmCreateImage(presenter->display, visual, 24, ZPixmap, NULL, segment,
+                                    presenter->width, presenter->height);
+    if(!image) return false;
+
+    // The renderer indexes pixels as x + width * y so rows can't be padded
+    if(image->bits_per_pixel != 32 || image->bytes_per_line != (i32) (presenter->width * sizeof(u32)))
+    {
+        XDestroyImage(image);
+        return false;
+    }
+
+    segment->shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    if(segment->shmid < 0)
+    {
+        XDestroyImage(image);
+        return false;
+    }
+
+    segment->shmaddr = image->data = (char *) shmat(segment->shmid, NULL, 0);
+    segment->readOnly = False;
+    if(segment->shmaddr == (char *) -1)
+    {
+        shmctl(segment->shmid, IPC_RMID, NULL);
+        XDestroyImage(image);
+        return false;
+    }
+
+    attach_failed = false;
+    XErrorHandler old_handler = XSetErrorHandler(attach_error_handler);
+    XShmAttach(presenter->display, segment);
+    XSync(presenter->display, False);
+    XSetErrorHandler(old_handler);
+
+    // Once both sides are attached the segment can be marked for removal. It then goes away when the
+    // last of them detaches, even if the game crashes.
+    shmctl(segment->shmid, IPC_RMID, NULL);
+
+    if(attach_failed)
+    {
+        shmdt(segment->shmaddr);
+        XDestroyImage(image);
+        return false;
+    }
+
+    memset(image->data, 0, image->bytes_per_line * image->height);
+    presenter->images[index] = image;
+    return true;
+}
+
+static void destroy_shm_image(Presenter *presenter, u32 index)
+{
+    XShmDetach(presenter->display, &presenter->segments[index]);
+    XDestroyImage(presenter->images[index]);
+    shmdt(presenter->segments[index].shmaddr);
+    presenter->images[index] = NULL;
+}
+
+void presenter_init(Presenter *presenter, Display *display, Window window, GC gc, Visual *visual,
+                    u32 width, u32 height, b32 use_shm)
+{
+    *presenter = (Presenter) {
+        .display = display,
+        .window = window,
+        .gc = gc,
+        .width = width,
+        .height = height,
+    };
+
+    if(use_shm && XShmQueryExtension(display))
+    {
+        presenter->completion_type = XShmGetEventBase(display) + ShmCompletion;
+        if(create_shm_image(presenter, 0, visual))
+        {
+            if(create_shm_image(presenter, 1, visual))
+            {
+                presenter->shm = true;
+                return;
+            }
+            destroy_shm_image(presenter, 0);
+        }
+    }
+
+    presenter->images[0] = XCreateImage(display, visual,
+                                        24, ZPixmap, 0,
+                                        (char *) calloc(width * height, sizeof(u32)),
+                                        width, height, 32, width * sizeof(u32));
+}
+
+b32 presenter_handle_event(Presenter *presenter, XEvent *event)
+{
+    if(!presenter->shm || event->type != presenter->completion_type) return false;
+
+    XShmCompletionEvent *completion = (XShmCompletionEvent *) event;
+    for(u32 i = 0; i < 2; ++i)
+    {
+        if(presenter->segments[i].shmseg == completion->shmseg) presenter->pending[i] = false;
+    }
+    return true;
+}
+
+static Bool is_completion(Display *display, XEvent *event, XPointer arg)
+{
+    return event->type == ((Presenter *) arg)->completion_type;
+}
+
+/* Blocks until the server has finished reading the given image */
+static void wait_for_image(Presenter *presenter, u32 index)
+{
+    XEvent event;
+    while(presenter->pending[index])
+    {
+        // Only takes completion events off the queue, input stays there for the main loop
+        XIfEvent(presenter->display, &event, is_completion, (XPointer) presenter);
+        presenter_handle_event(presenter, &event);
+    }
+}
+
+void presenter_present(Presenter *presenter, Rect *rects, u32 count)
+{
+    if(!count) return;
+
+    XImage *image = presenter->images[presenter->current];
+    if(!presenter->shm)
+    {
+        for(u32 i = 0; i < count; ++i)
+        {
+            Rect area = rects[i];
+            XPutImage(presenter->display, presenter->window, presenter->gc, image,
+                      area.x, area.y, area.x, area.y, area.width, area.height);
+        }
+        return;
+    }
+
+    // Only the last put asks for a completion event, the server handles requests in order
+    for(u32 i = 0; i < count; ++i)
+    {
+        Rect area = rects[i];
+        XShmPutImage(presenter->display, presenter->window, presenter->gc, image,
+                     area.x, area.y, area.x, area.y, area.width, area.height, i + 1 == count);
+    }
+    presenter->pending[presenter->current] = true;
+    XFlush(presenter->display);
+
+    u32 next = presenter->current ^ 1;
+    wait_for_image(presenter, next);
+
+    // The other buffer is a frame behind. Copying over what just changed makes it hold the frame on
+    // screen, which is what the renderer expects to draw on top of.
+    u32 *from = (u32 *) image->data;
+    u32 *to = (u32 *) presenter->images[next]->data;
+    for(u32 i = 0; i < count; ++i)
+    {
+        copy_rect_pixels(to, from, presenter->width, rects[i]);
+    }
+    presenter->current = next;
+}
+
+void presenter_free(Presenter *presenter)
+{
+    if(presenter->shm)
+    {
+        wait_for_image(presenter, 0);
+        wait_for_image(presenter, 1);
+        destroy_shm_image(presenter, 0);
+        destroy_shm_image(presenter, 1);
+    }
+    else
+    {
+        XDestroyImage(presenter->images[0]);
+    }
+    presenter->images[0] = NULL;
+}
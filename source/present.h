@@ -0,0 +1,50 @@
+#include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
+#include "raster.h"
+#include "types.h"
+
+#ifndef PRESENT
+#define PRESENT
+
+/* Gets finished frames onto the window. On a local display the frames live in two MIT-SHM segments the */
+/* server reads straight out of, so presenting doesn't push the pixels through the X socket. The game    */
+/* draws into one while the server is still reading the other. When the extension isn't there (remote   */
+/* display, no libXext support on the server) it falls back to a single XImage sent with XPutImage.     */
+typedef struct
+{
+    Display *display;
+    Window window;
+    GC gc;
+    u32 width;
+    u32 height;
+
+    b32 shm;
+    XImage *images[2];
+    XShmSegmentInfo segments[2];
+    /* The server hasn't sent the ShmCompletion event for the last put from this image yet */
+    b32 pending[2];
+    /* Index of the image the next frame gets drawn into */
+    u32 current;
+    i32 completion_type;
+} Presenter;
+
+/* Tries MIT-SHM first unless use_shm is false. Always succeeds, presenter->shm says which path it took. */
+void presenter_init(Presenter *presenter, Display *display, Window window, GC gc, Visual *visual,
+                    u32 width, u32 height, b32 use_shm);
+void presenter_free(Presenter *presenter);
+
+/* The image to draw the next frame into. Holds the previous frame, so only changed areas need redrawing. */
+static inline XImage *presenter_buffer(Presenter *presenter)
+{
+    return presenter->images[presenter->current];
+}
+
+/* Sends the given areas of the current buffer to the window. With SHM this then waits until the server */
+/* is done with the other buffer, which keeps the game at most one frame ahead of what's on screen.     */
+void presenter_present(Presenter *presenter, Rect *rects, u32 count);
+
+/* Call on events taken off the queue by the main loop. Returns true if it was a completion event for */
+/* the presenter, which the caller can then ignore.                                                   */
+b32 presenter_handle_event(Presenter *presenter, XEvent *event);
+
+#endif
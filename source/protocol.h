@@ -0,0 +1,67 @@
+#include "board.h"
+
+#ifndef PROTOCOL
+#define PROTOCOL
+
+/* Wire format between tf_server and its clients over a Unix stream socket. Every message is a fixed  */
+/* size struct sent as it is, in the machine's byte order since both ends are on the same machine.    */
+/* A client sends Requests and gets exactly one Response per Request back, in order. Requests can be */
+/* pipelined: nothing stops a client sending more before the earlier ones are answered.              */
+/*                                                                                                   */
+/* A connection is one session with one game. OP_NEW starts a game (again) from a seed, OP_MOVE       */
+/* plays a move on it and OP_BOARD and OP_SCORE just ask. Every Response carries the whole state of  */
+/* the game so a client never needs more than one round trip to know where it stands.               */
+
+#define SERVER_DEFAULT_PATH "/tmp/tf_server.sock"
+
+typedef enum
+{
+    OP_NEW,
+    OP_MOVE,
+    OP_BOARD,
+    OP_SCORE,
+    OP_COUNT,
+} Op;
+
+typedef enum
+{
+    STATUS_OK,
+    /* The move didn't change the board, nothing was played */
+    STATUS_NO_MOVE,
+    /* OP_MOVE, OP_BOARD or OP_SCORE before any OP_NEW */
+    STATUS_NO_GAME,
+    /* Unknown op or a direction past DOWN */
+    STATUS_BAD_REQUEST,
+} Status;
+
+typedef struct
+{
+    /* Op */
+    u8 op;
+    /* Dir, for OP_MOVE */
+    u8 dir;
+    u8 padding[2];
+    /* Anything the client likes, echoed back in the Response */
+    u32 tag;
+    /* For OP_NEW */
+    u64 seed;
+} Request;
+
+typedef struct
+{
+    u8 op;
+    /* Status */
+    u8 status;
+    /* No move changes the board any more */
+    u8 over;
+    u8 padding;
+    u32 tag;
+    Board board;
+    u32 score;
+    u32 moves;
+} Response;
+
+_Static_assert(sizeof(Request) == 16, "Request is part of the protocol");
+_Static_assert(sizeof(Response) == 24, "Response is part of the protocol");
+
+#endif
@@ -0,0 +1,201 @@
+#include <string.h>
+#include "raster.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86
+#endif
+
+Rect rect_intersect(Rect a, Rect b)
+{
+    Rect r;
+    r.x = a.x > b.x ? a.x : b.x;
+    r.y = a.y > b.y ? a.y : b.y;
+    i32 right  = (a.x + a.width  < b.x + b.width)  ? a.x + a.width  : b.x + b.width;
+    i32 bottom = (a.y + a.height < b.y + b.height) ? a.y + a.height : b.y + b.height;
+    r.width = right - r.x;
+    r.height = bottom - r.y;
+    return r;
+}
+
+Rect rect_union(Rect a, Rect b)
+{
+    Rect r;
+    r.x = a.x < b.x ? a.x : b.x;
+    r.y = a.y < b.y ? a.y : b.y;
+    i32 right  = (a.x + a.width  > b.x + b.width)  ? a.x + a.width  : b.x + b.width;
+    i32 bottom = (a.y + a.height > b.y + b.height) ? a.y + a.height : b.y + b.height;
+    r.width = right - r.x;
+    r.height = bottom - r.y;
+    return r;
+}
+
+static void fill_span_scalar(u32 *dst, u32 count, u32 color)
+{
+    for(u32 i = 0; i < count; ++i)
+    {
+        dst[i] = color;
+    }
+}
+
+static void pack_rgb_span_scalar(u8 *dst, const u32 *src, u32 count)
+{
+    for(u32 i = 0; i < count; ++i, dst += 3)
+    {
+        dst[0] = (u8) (src[i] >> 16);
+        dst[1] = (u8) (src[i] >> 8);
+        dst[2] = (u8) src[i];
+    }
+}
+
+#ifdef RASTER_X86
+/* The vector kernels do single stores up to the first aligned pixel, whole aligned vectors after that */
+/* and single stores again for whatever is left.                                                      */
+
+__attribute__((target("sse2")))
+static void fill_span_sse2(u32 *dst, u32 count, u32 color)
+{
+    while(count && ((uintptr_t) dst & 15))
+    {
+        *dst++ = color;
+        count--;
+    }
+
+    __m128i value = _mm_set1_epi32((i32) color);
+    for(; count >= 8; count -= 8, dst += 8)
+    {
+        _mm_store_si128((__m128i *) dst, value);
+        _mm_store_si128((__m128i *) (dst + 4), value);
+    }
+    for(; count >= 4; count -= 4, dst += 4)
+    {
+        _mm_store_si128((__m128i *) dst, value);
+    }
+
+    while(count--) *dst++ = color;
+}
+
+__attribute__((target("avx2")))
+static void fill_span_avx2(u32 *dst, u32 count, u32 color)
+{
+    while(count && ((uintptr_t) dst & 31))
+    {
+        *dst++ = color;
+        count--;
+    }
+
+    __m256i value = _mm256_set1_epi32((i32) color);
+    for(; count >= 16; count -= 16, dst += 16)
+    {
+        _mm256_store_si256((__m256i *) dst, value);
+        _mm256_store_si256((__m256i *) (dst + 8), value);
+    }
+    for(; count >= 8; count -= 8, dst += 8)
+    {
+        _mm256_store_si256((__m256i *) dst, value);
+    }
+
+    while(count--) *dst++ = color;
+}
+
+/* One shuffle turns 4 pixels into their 12 bytes. The store is 16 bytes wide and runs into the next two */
+/* pixels, so the loop stops while those are still in the span and the scalar loop does the rest.      */
+__attribute__((target("ssse3")))
+static void pack_rgb_span_ssse3(u8 *dst, const u32 *src, u32 count)
+{
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    for(; count >= 6; count -= 4, src += 4, dst += 12)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *) src);
+        _mm_storeu_si128((__m128i *) dst, _mm_shuffle_epi8(pixels, order));
+    }
+
+    pack_rgb_span_scalar(dst, src, count);
+}
+#endif
+
+static const char *kernel_name = "scalar";
+
+static SpanFill select_fill_span(void)
+{
+#ifdef RASTER_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        kernel_name = "avx2";
+        return fill_span_avx2;
+    }
+    if(__builtin_cpu_supports("sse2"))
+    {
+        kernel_name = "sse2";
+        return fill_span_sse2;
+    }
+#endif
+    kernel_name = "scalar";
+    return fill_span_scalar;
+}
+
+/* fill_span starts out here so nobody has to remember to call an init function */
+static void fill_span_resolve(u32 *dst, u32 count, u32 color)
+{
+    fill_span = select_fill_span();
+    fill_span(dst, count, color);
+}
+
+SpanFill fill_span = fill_span_resolve;
+
+const char *raster_kernel_name(void)
+{
+    if(fill_span == fill_span_resolve) fill_span = select_fill_span();
+    return kernel_name;
+}
+
+static SpanPack select_pack_rgb_span(void)
+{
+#ifdef RASTER_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("ssse3")) return pack_rgb_span_ssse3;
+#endif
+    return pack_rgb_span_scalar;
+}
+
+static void pack_rgb_span_resolve(u8 *dst, const u32 *src, u32 count)
+{
+    pack_rgb_span = select_pack_rgb_span();
+    pack_rgb_span(dst, src, count);
+}
+
+SpanPack pack_rgb_span = pack_rgb_span_resolve;
+
+void fill_rect_pixels(u32 *pixels, u32 stride, Rect area, u32 color)
+{
+    if(rect_empty(area)) return;
+
+    u32 *row = pixels + area.y * stride + area.x;
+    for(i32 y = 0; y < area.height; ++y, row += stride)
+    {
+        fill_span(row, area.width, color);
+    }
+}
+
+void copy_rect_pixels(u32 *dst, u32 *src, u32 stride, Rect area)
+{
+    if(rect_empty(area)) return;
+
+    u32 offset = area.y * stride + area.x;
+    for(i32 y = 0; y < area.height; ++y, offset += stride)
+    {
+        memcpy(dst + offset, src + offset, area.width * sizeof(u32));
+    }
+}
+
+void pack_rgb_rect(u8 *dst, u32 *src, u32 stride, Rect area)
+{
+    if(rect_empty(area)) return;
+
+    size_t offset = (size_t) area.y * stride + area.x;
+    for(i32 y = 0; y < area.height; ++y, offset += stride)
+    {
+        pack_rgb_span(dst + offset * 3, src + offset, area.width);
+    }
+}
@@ -0,0 +1,54 @@
+#include "types.h"
+
+#ifndef RASTER
+#define RASTER
+
+/* The pixel loops the renderer bottoms out in. Pixels are 32 bit and rows are stride pixels apart. */
+/* Everything here works on whole rows at a time, the fills pick an SSE2 or AVX2 kernel at runtime */
+/* when the CPU has one and plain stores otherwise.                                                */
+
+typedef struct
+{
+    i32 x;
+    i32 y;
+    i32 width;
+    i32 height;
+} Rect;
+
+/* A block of pixels that isn't necessarily the window: row y starts at pixels + y * stride */
+typedef struct
+{
+    u32 *pixels;
+    i32 width;
+    i32 height;
+    u32 stride;
+} Bitmap;
+
+/* Overlap of a and b, width/height are 0 or less if they don't overlap */
+Rect rect_intersect(Rect a, Rect b);
+/* Smallest rect containing both */
+Rect rect_union(Rect a, Rect b);
+static inline b32 rect_empty(Rect r)
+{
+    return r.width <= 0 || r.height <= 0;
+}
+
+/* Sets count pixels starting at dst to color. Points at the best kernel for this CPU after the first call. */
+typedef void (*SpanFill)(u32 *dst, u32 count, u32 color);
+extern SpanFill fill_span;
+
+/* Name of the kernel fill_span uses, for benchmarks and debug output */
+const char *raster_kernel_name(void);
+
+/* Writes count pixels out as 3 bytes each, red first, the layout of PPM files and rgb24 video. Points */
+/* at the best kernel for this CPU after the first call.                                              */
+typedef void (*SpanPack)(u8 *dst, const u32 *src, u32 count);
+extern SpanPack pack_rgb_span;
+
+/* area must already be clipped to the buffer */
+void fill_rect_pixels(u32 *pixels, u32 stride, Rect area, u32 color);
+void copy_rect_pixels(u32 *dst, u32 *src, u32 stride, Rect area);
+/* Packs area of pixels into the same area of an RGB buffer with rows stride * 3 bytes apart */
+void pack_rgb_rect(u8 *dst, u32 *src, u32 stride, Rect area);
+
+#endif
@@ -0,0 +1,260 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "record.h"
+
+#define WRITE_BUFFER_SIZE (1 << 16)
+#define FILE_HEADER_SIZE 8
+#define TRAILER_SIZE 24
+
+static const char file_magic[4] = { 'T', 'F', 'R', 'C' };
+static const char index_magic[4] = { 'T', 'F', 'I', 'X' };
+
+static u32 packed_size(u32 move_count)
+{
+    return (move_count + 3) / 4;
+}
+
+void game_record_begin(GameRecord *record, Game *game)
+{
+    record->header = (RecordHeader) {0};
+    record->header.seed = game->seed;
+    record->header.initial = game->board;
+}
+
+void game_record_move(GameRecord *record, Dir dir)
+{
+    u32 index = record->header.move_count++;
+    if(packed_size(index + 1) > record->capacity)
+    {
+        record->capacity = record->capacity ? record->capacity * 2 : 256;
+        record->moves = (u8 *) realloc(record->moves, record->capacity);
+    }
+
+    if((index & 3) == 0) record->moves[index >> 2] = 0;
+    record->moves[index >> 2] |= (u8) dir << ((index & 3) * 2);
+}
+
+void game_record_free(GameRecord *record)
+{
+    free(record->moves);
+    record->moves = NULL;
+    record->capacity = 0;
+}
+
+static void flush(RecordWriter *writer)
+{
+    u32 written = 0;
+    while(written < writer->buffered && !writer->failed)
+    {
+        ssize_t result = write(writer->fd, writer->buffer + written, writer->buffered - written);
+        if(result < 0 && errno == EINTR) continue;
+        // Nothing after a failed write is worth writing, it would land at the wrong offset
+        if(result <= 0) writer->failed = true;
+        else written += result;
+    }
+    writer->buffered = 0;
+}
+
+static void put(RecordWriter *writer, const void *data, u64 size)
+{
+    const u8 *bytes = (const u8 *) data;
+    writer->offset += size;
+    while(size > 0)
+    {
+        u64 space = WRITE_BUFFER_SIZE - writer->buffered;
+        u64 count = size < space ? size : space;
+        memcpy(writer->buffer + writer->buffered, bytes, count);
+        writer->buffered += count;
+        bytes += count;
+        size -= count;
+        if(writer->buffered == WRITE_BUFFER_SIZE) flush(writer);
+    }
+}
+
+RecordWriter *record_writer_open(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return NULL;
+
+    RecordWriter *writer = (RecordWriter *) calloc(1, sizeof(RecordWriter));
+    writer->fd = fd;
+    writer->buffer = (u8 *) malloc(WRITE_BUFFER_SIZE);
+    pthread_mutex_init(&writer->lock, NULL);
+
+    u32 version = RECORD_VERSION;
+    put(writer, file_magic, 4);
+    put(writer, &version, 4);
+    return writer;
+}
+
+void record_write(RecordWriter *writer, GameRecord *record, Game *game)
+{
+    record->header.final = game->board;
+    record->header.score = game->score;
+
+    pthread_mutex_lock(&writer->lock);
+    if(writer->game_count == writer->index_capacity)
+    {
+        writer->index_capacity = writer->index_capacity ? writer->index_capacity * 2 : 1024;
+        writer->index = (u64 *) realloc(writer->index, writer->index_capacity * sizeof(u64));
+    }
+    writer->index[writer->game_count++] = writer->offset;
+
+    put(writer, &record->header, sizeof(RecordHeader));
+    put(writer, record->moves, packed_size(record->header.move_count));
+    pthread_mutex_unlock(&writer->lock);
+}
+
+b32 record_writer_close(RecordWriter *writer)
+{
+    // The index is read as an array of u64 straight out of the mapping so it has to be aligned
+    static const u8 zeros[8] = {0};
+    put(writer, zeros, (8 - writer->offset % 8) % 8);
+
+    u64 index_offset = writer->offset;
+    put(writer, writer->index, writer->game_count * sizeof(u64));
+    put(writer, &index_offset, 8);
+    put(writer, &writer->game_count, 8);
+    put(writer, index_magic, 4);
+    put(writer, zeros, 4);
+    flush(writer);
+
+    b32 ok = close(writer->fd) == 0 && !writer->failed;
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->index);
+    free(writer->buffer);
+    free(writer);
+    return ok;
+}
+
+/* Whether header can be the start of a game: a fresh board holds two tiles, each a 2 or a 4, and a */
+/* game without moves ends where it started. The walk stops at the first one that can't, which keeps */
+/* it out of the padding and index of a file that only lost its trailer.                            */
+static b32 plausible_header(RecordHeader *header)
+{
+    if(board_empty_count(header->initial) != CELL_NUM - 2) return false;
+    for(u32 i = 0; i < CELL_NUM; ++i)
+    {
+        if(board_get(header->initial, i) > 2) return false;
+    }
+    if(header->move_count == 0) return header->final == header->initial && header->score == 0;
+    return header->final != 0;
+}
+
+/* Walks the games one after another for files that never got an index written */
+static void rebuild_index(RecordFile *file)
+{
+    u64 capacity = 1024;
+    u64 offset = FILE_HEADER_SIZE;
+    file->rebuilt_index = (u64 *) malloc(capacity * sizeof(u64));
+    file->game_count = 0;
+
+    while(offset + sizeof(RecordHeader) <= file->size)
+    {
+        RecordHeader header;
+        memcpy(&header, file->data + offset, sizeof(RecordHeader));
+        if(!plausible_header(&header)) break;
+        u64 end = offset + sizeof(RecordHeader) + packed_size(header.move_count);
+        if(end > file->size) break;
+
+        if(file->game_count == capacity)
+        {
+            capacity *= 2;
+            file->rebuilt_index = (u64 *) realloc(file->rebuilt_index, capacity * sizeof(u64));
+        }
+        file->rebuilt_index[file->game_count++] = offset;
+        offset = end;
+    }
+    file->index = file->rebuilt_index;
+}
+
+b32 record_open(RecordFile *file, const char *path)
+{
+    *file = (RecordFile) {0};
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < FILE_HEADER_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return false;
+
+    file->data = (const u8 *) data;
+    file->size = st.st_size;
+    u32 version;
+    memcpy(&version, file->data + 4, 4);
+    if(memcmp(file->data, file_magic, 4) != 0 || version != RECORD_VERSION)
+    {
+        record_close(file);
+        return false;
+    }
+    // Games are mostly read front to back
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    const u8 *trailer = file->data + file->size - TRAILER_SIZE;
+    u64 index_offset, game_count;
+    if(file->size >= FILE_HEADER_SIZE + TRAILER_SIZE && memcmp(trailer + 16, index_magic, 4) == 0)
+    {
+        memcpy(&index_offset, trailer, 8);
+        memcpy(&game_count, trailer + 8, 8);
+        // Checked without adding anything the file says, a corrupt trailer could make a sum wrap around
+        u64 index_space = file->size - FILE_HEADER_SIZE - TRAILER_SIZE;
+        if(game_count <= index_space / sizeof(u64) && index_offset >= FILE_HEADER_SIZE && index_offset % 8 == 0 &&
+           index_offset == file->size - TRAILER_SIZE - game_count * sizeof(u64))
+        {
+            file->index = (const u64 *) (file->data + index_offset);
+            file->game_count = game_count;
+            return true;
+        }
+    }
+
+    rebuild_index(file);
+    return true;
+}
+
+void record_close(RecordFile *file)
+{
+    if(file->data) munmap((void *) file->data, file->size);
+    free(file->rebuilt_index);
+    *file = (RecordFile) {0};
+}
+
+b32 record_game(RecordFile *file, u64 index, RecordedGame *game)
+{
+    if(index >= file->game_count) return false;
+
+    u64 offset = file->index[index];
+    if(offset > file->size || file->size - offset < sizeof(RecordHeader)) return false;
+
+    memcpy(&game->header, file->data + offset, sizeof(RecordHeader));
+    game->moves = file->data + offset + sizeof(RecordHeader);
+    return packed_size(game->header.move_count) <= file->size - offset - sizeof(RecordHeader);
+}
+
+i64 record_replay(RecordedGame *recorded, Game *game)
+{
+    game_new(game, recorded->header.seed);
+    if(game->board != recorded->header.initial) return REPLAY_BAD_START;
+
+    for(u32 i = 0; i < recorded->header.move_count; ++i)
+    {
+        if(!game_move(game, recorded_move(recorded, i))) return i;
+    }
+
+    if(game->board != recorded->header.final || game->score != recorded->header.score)
+    {
+        return recorded->header.move_count;
+    }
+    return REPLAY_OK;
+}
@@ -0,0 +1,102 @@
+#include <pthread.h>
+#include "game.h"
+
+#ifndef RECORD
+#define RECORD
+
+/* Game record files.                                                                            */
+/*                                                                                               */
+/* A game is fully determined by its seed and its moves, so that's most of what gets stored:     */
+/*                                                                                               */
+/*   file header   "TFRC", u32 version                                                           */
+/*   games         RecordHeader followed by the moves packed 4 to a byte (2 bits each, Dir       */
+/*                 values, first move in the lowest bits)                                        */
+/*   index         u64 file offset of every game                                                 */
+/*   trailer       u64 offset of the index, u64 game count, "TFIX" and 4 bytes of padding        */
+/*                                                                                               */
+/* Everything is in the machine's byte order (little endian on anything this runs on). A file    */
+/* whose writer never got to close it has no index; the reader rebuilds one by walking the games. */
+
+#define RECORD_VERSION 1
+
+typedef struct
+{
+    u64 seed;
+    Board initial;
+    Board final;
+    u32 score;
+    u32 move_count;
+} RecordHeader;
+
+/* Moves of one game in progress. Every thread that plays games keeps its own. */
+typedef struct
+{
+    RecordHeader header;
+    u8 *moves;
+    u32 capacity;
+} GameRecord;
+
+typedef struct
+{
+    int fd;
+    u8 *buffer;
+    u32 buffered;
+    u64 offset;
+    /* A write to the file failed, so offset no longer matches what is in it */
+    b32 failed;
+    u64 *index;
+    u64 game_count;
+    u64 index_capacity;
+    /* Games from different threads are written whole, one at a time */
+    pthread_mutex_t lock;
+} RecordWriter;
+
+/* Read only mapping of a record file. Games are read straight out of the mapping, nothing is copied. */
+typedef struct
+{
+    const u8 *data;
+    u64 size;
+    u64 game_count;
+    const u64 *index;
+    /* Set when the index had to be rebuilt because the file has no trailer */
+    u64 *rebuilt_index;
+} RecordFile;
+
+typedef struct
+{
+    RecordHeader header;
+    const u8 *moves;
+} RecordedGame;
+
+void game_record_begin(GameRecord *record, Game *game);
+void game_record_move(GameRecord *record, Dir dir);
+void game_record_free(GameRecord *record);
+
+/* Returns NULL if the file can't be created */
+RecordWriter *record_writer_open(const char *path);
+/* Stores a finished game. game is its final state. Safe to call from several threads at once. */
+void record_write(RecordWriter *writer, GameRecord *record, Game *game);
+/* Writes the index and trailer and closes the file. Returns false if any of the file failed to be */
+/* written, the games that did get there can still be read back as a file without an index.       */
+b32 record_writer_close(RecordWriter *writer);
+
+b32 record_open(RecordFile *file, const char *path);
+void record_close(RecordFile *file);
+b32 record_game(RecordFile *file, u64 index, RecordedGame *game);
+
+static inline Dir recorded_move(RecordedGame *game, u32 index)
+{
+    return (Dir) ((game->moves[index >> 2] >> ((index & 3) * 2)) & 3);
+}
+
+// record_replay's results that aren't a move
+#define REPLAY_OK -1
+#define REPLAY_BAD_START -2
+
+/* Plays the recorded moves again from the seed, checking the starting board, that every move        */
+/* changes the board, and the final board and score. Returns REPLAY_OK if the whole game checks out, */
+/* REPLAY_BAD_START if the seed doesn't give the recorded starting board, otherwise the move it went */
+/* wrong at (move_count for the final state). game ends up in the replayed state.                    */
+i64 record_replay(RecordedGame *recorded, Game *game);
+
+#endif
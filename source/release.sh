@@ -1,13 +1,55 @@
 #!/bin/sh
 
 pushd ../target/release
+[ -f "ai.o" ] && rm ai.o
+[ -f "animate.o" ] && rm animate.o
+[ -f "atlas.o" ] && rm atlas.o
+[ -f "batch.o" ] && rm batch.o
+[ -f "blit.o" ] && rm blit.o
+[ -f "board.o" ] && rm board.o
 [ -f "colors.o" ] && rm colors.o
 [ -f "draw.o" ] && rm draw.o
+[ -f "font.o" ] && rm font.o
+[ -f "game.o" ] && rm game.o
+[ -f "grid.o" ] && rm grid.o
+[ -f "heuristic.o" ] && rm heuristic.o
+[ -f "journal.o" ] && rm journal.o
+[ -f "io.o" ] && rm io.o
+[ -f "ntuple.o" ] && rm ntuple.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "present.o" ] && rm present.o
+[ -f "raster.o" ] && rm raster.o
+[ -f "record.o" ] && rm record.o
+[ -f "rollout.o" ] && rm rollout.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "scene.o" ] && rm scene.o
+[ -f "timing.o" ] && rm timing.o
 [ -f "twenty_fortyeight.o" ] && rm twenty_fortyeight.o
 [ -f "tf" ] && rm tf
 
+gcc -Wall -O3 -c ../../source/ai.c
+gcc -Wall -O3 -c ../../source/animate.c
+gcc -Wall -O3 -c ../../source/atlas.c
+gcc -Wall -O3 -c ../../source/batch.c
+gcc -Wall -O3 -c ../../source/blit.c
+gcc -Wall -O3 -c ../../source/board.c
 gcc -Wall -O3 -c ../../source/colors.c
 gcc -Wall -O3 -c ../../source/draw.c
+gcc -Wall -O3 -c ../../source/font.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/grid.c
+gcc -Wall -O3 -c ../../source/heuristic.c
+gcc -Wall -O3 -c ../../source/journal.c
+gcc -Wall -O3 -c ../../source/io.c
+gcc -Wall -O3 -c ../../source/ntuple.c
+gcc -Wall -O3 -c ../../source/pool.c
+gcc -Wall -O3 -c ../../source/present.c
+gcc -Wall -O3 -c ../../source/raster.c
+gcc -Wall -O3 -c ../../source/record.c
+gcc -Wall -O3 -c ../../source/rollout.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/scene.c
+gcc -Wall -O3 -c ../../source/timing.c
 gcc -Wall -O3 -c ../../source/twenty_fortyeight.c
-gcc -lX11 -O3 -o tf colors.o draw.o twenty_fortyeight.o
+gcc -lX11 -lXext -lpthread -O3 -o tf ai.o animate.o atlas.o batch.o blit.o board.o colors.o draw.o font.o game.o grid.o heuristic.o io.o journal.o ntuple.o pool.o present.o raster.o record.o rollout.o rng.o scene.o timing.o twenty_fortyeight.o
 popd
@@ -0,0 +1,549 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blit.h"
+#include "draw.h"
+#include "scene.h"
+#include "timing.h"
+
+/* Times the renderer one piece at a time and as whole frames, over every combination of resolution */
+/* and board size asked for. Each case is warmed up, then timed in several runs of enough iterations */
+/* to last a while each, and the runs' median, spread, ns per pixel and operations per second get    */
+/* printed. -o also writes them as CSV, or JSON if the name ends in .json, to compare between builds. */
+/*                                                                                                   */
+/* Pixels are the ones a case actually writes or blends: rects and circles are counted by drawing    */
+/* them once, tiles are their bounds inside the clip and frames are the dirty area they redraw.      */
+
+typedef enum
+{
+    /* Outline of a grid square, all four sides drawn */
+    CASE_RECT_INSIDE,
+    /* Hanging off each edge of the target in turn, the clipped branches of rect */
+    CASE_RECT_CLIPPED,
+    /* Entirely outside, only the early out */
+    CASE_RECT_OFFSCREEN,
+    /* Rounded tile corner sized circle inside the target */
+    CASE_CIRCLE_INSIDE,
+    /* Centred on an edge, half of it clipped */
+    CASE_CIRCLE_EDGE,
+    /* Centred on a corner, three quarters clipped */
+    CASE_CIRCLE_CORNER,
+    /* Building every tile of the atlas, which is most of what fill_circle is used for */
+    CASE_ATLAS_BUILD,
+    /* One tile at rest, a straight copy out of the atlas */
+    CASE_TILE_REST,
+    /* Popping, scaled with the bilinear filter */
+    CASE_TILE_SCALED,
+    /* Fading in over the grid */
+    CASE_TILE_FADED,
+    /* Half off the right edge, clipped */
+    CASE_TILE_CLIPPED,
+    /* Every pixel redrawn, board full of tiles */
+    CASE_FRAME_FULL,
+    /* Every tile sliding, a frame in the middle of a move */
+    CASE_FRAME_SLIDE,
+    /* Every tile popping */
+    CASE_FRAME_POP,
+    /* Whole board under the game over panel while it fades in */
+    CASE_FRAME_GAME_OVER,
+    CASE_COUNT,
+} BenchCase;
+
+static const char *case_names[CASE_COUNT] = {
+    "rect_inside", "rect_clipped", "rect_offscreen",
+    "circle_inside", "circle_edge", "circle_corner",
+    "atlas_build",
+    "tile_rest", "tile_scaled", "tile_faded", "tile_clipped",
+    "frame_full", "frame_slide", "frame_pop", "frame_game_over",
+};
+
+static b32 is_frame(BenchCase bench_case)
+{
+    return bench_case >= CASE_FRAME_FULL;
+}
+
+typedef struct
+{
+    u32 width;
+    u32 height;
+    u32 board_size;
+    Scene scene;
+    Bitmap target;
+    /* Two points of an animation so consecutive frames always differ */
+    Sprite rest[GRID_CELLS];
+    Sprite slide[2][GRID_CELLS];
+    Sprite pop[2][GRID_CELLS];
+    /* Built by CASE_ATLAS_BUILD and thrown away again */
+    TileAtlas atlas;
+} Bench;
+
+typedef struct
+{
+    u32 width;
+    u32 height;
+    u32 board_size;
+    BenchCase bench_case;
+    f64 pixels;
+    u64 iterations;
+    u32 runs;
+    /* Nanoseconds per operation over the runs */
+    f64 median;
+    f64 min;
+    f64 max;
+    f64 deviation;
+} BenchResult;
+
+typedef struct
+{
+    /* Timed runs per case and roughly how long each one lasts */
+    u32 runs;
+    f64 run_time;
+    /* Spent running a case before timing it */
+    f64 warmup_time;
+} BenchConfig;
+
+static void set_sprites(Sprite sprites[GRID_CELLS], u32 size, f32 offset, f32 scale)
+{
+    memset(sprites, 0, GRID_CELLS * sizeof(Sprite));
+    for(u32 i = 0; i < size * size; ++i)
+    {
+        // Tiles slide right, the last column stays put so nothing leaves the board
+        b32 moves = i % size != size - 1;
+        sprites[i] = (Sprite) {
+            .x = (f32) (i % size) + (moves ? offset : 0),
+            .y = (f32) (i / size),
+            .scale = scale,
+            .value = (u8) (i % 11 + 1),
+            .opacity = 1.0f,
+        };
+    }
+}
+
+static void bench_init(Bench *bench, u32 width, u32 height, u32 board_size)
+{
+    memset(bench, 0, sizeof(*bench));
+    bench->width = width;
+    bench->height = height;
+    bench->board_size = board_size;
+    scene_init(&bench->scene, width, height, board_size);
+    u32 *pixels = (u32 *) calloc((size_t) width * height, sizeof(u32));
+    bench->target = (Bitmap) { pixels, width, height, width };
+
+    set_sprites(bench->rest, board_size, 0, 1);
+    set_sprites(bench->slide[0], board_size, 0.25f, 1);
+    set_sprites(bench->slide[1], board_size, 0.5f, 1);
+    set_sprites(bench->pop[0], board_size, 0, 1.1f);
+    set_sprites(bench->pop[1], board_size, 0, 1.05f);
+    scene_show_game_over(&bench->scene, 123456);
+    scene_hide_game_over(&bench->scene);
+}
+
+static void bench_free(Bench *bench)
+{
+    scene_free(&bench->scene);
+    free(bench->target.pixels);
+}
+
+/* Back to a full board at rest with nothing left to redraw */
+static void reset_scene(Bench *bench)
+{
+    Scene *scene = &bench->scene;
+    scene_hide_game_over(scene);
+    scene_set_sprites(scene, bench->rest);
+    scene_mark_all_dirty(scene);
+    scene_render(scene, &bench->target);
+    scene->dirty.count = 0;
+}
+
+static void prepare(Bench *bench, BenchCase bench_case)
+{
+    reset_scene(bench);
+    if(bench_case == CASE_FRAME_GAME_OVER) scene_show_game_over(&bench->scene, 123456);
+}
+
+/* Does one operation of bench_case, iteration picks between its variants. Returns the pixels it */
+/* wrote for the cases that know that without counting.                                         */
+static f64 run_once(Bench *bench, BenchCase bench_case, u64 iteration)
+{
+    Scene *scene = &bench->scene;
+    Bitmap *target = &bench->target;
+    i32 width = bench->width;
+    i32 height = bench->height;
+    i32 pitch = scene->cell_pitch;
+    f32 length = scene->cell_length;
+    f32 radius = length / 10;
+    Rect all = { 0, 0, width, height };
+    u32 color = 0xff776e65;
+    f64 pixels = 0;
+
+    switch(bench_case)
+    {
+        case CASE_RECT_INSIDE:
+        {
+            u32 cell = iteration % (bench->board_size * bench->board_size);
+            rect((cell % bench->board_size) * pitch, (cell / bench->board_size) * pitch, pitch - 1, pitch - 1, color, target);
+        } break;
+        case CASE_RECT_CLIPPED:
+        {
+            i32 x = (width - pitch) / 2;
+            i32 y = (height - pitch) / 2;
+            switch(iteration % 4)
+            {
+                case 0: x = -pitch / 2; break;
+                case 1: x = width - pitch / 2; break;
+                case 2: y = -pitch / 2; break;
+                case 3: y = height - pitch / 2; break;
+            }
+            rect(x, y, pitch, pitch, color, target);
+        } break;
+        case CASE_RECT_OFFSCREEN:
+        {
+            rect(iteration & 1 ? width : -2 * pitch, pitch, pitch, pitch, color, target);
+        } break;
+        case CASE_CIRCLE_INSIDE:
+        {
+            fill_circle(width / 2.0f, height / 2.0f, radius, target, color);
+        } break;
+        case CASE_CIRCLE_EDGE:
+        {
+            f32 x = iteration & 1 ? 0 : width - 1;
+            fill_circle(x, height / 2.0f, radius, target, color);
+        } break;
+        case CASE_CIRCLE_CORNER:
+        {
+            fill_circle(iteration & 1 ? 0 : width - 1, iteration & 2 ? 0 : height - 1, radius, target, color);
+        } break;
+        case CASE_ATLAS_BUILD:
+        {
+            atlas_build(&bench->atlas, scene->cell_length);
+            atlas_free(&bench->atlas);
+            pixels = (f64) (ATLAS_TILES - 1) * scene->cell_length * scene->cell_length;
+        } break;
+        case CASE_TILE_REST:
+        case CASE_TILE_SCALED:
+        case CASE_TILE_FADED:
+        case CASE_TILE_CLIPPED:
+        {
+            u8 value = (u8) (iteration % 11 + 1);
+            f32 x = 1;
+            f32 y = 1;
+            f32 size = length;
+            u32 opacity = 255;
+            if(bench_case == CASE_TILE_SCALED)
+            {
+                size = length * (iteration & 1 ? 1.1f : 1.05f);
+                x -= (size - length) / 2;
+                y -= (size - length) / 2;
+            }
+            if(bench_case == CASE_TILE_FADED) opacity = iteration & 1 ? 128 : 96;
+            if(bench_case == CASE_TILE_CLIPPED) x = width - length / 2;
+            Rect bounds = rect_intersect(atlas_bounds(&scene->atlas, x, y, size), all);
+            atlas_draw(&scene->atlas, value, x, y, size, opacity, target, all);
+            pixels = rect_empty(bounds) ? 0 : (f64) bounds.width * bounds.height;
+        } break;
+        case CASE_FRAME_FULL:
+        case CASE_FRAME_SLIDE:
+        case CASE_FRAME_POP:
+        case CASE_FRAME_GAME_OVER:
+        {
+            if(bench_case == CASE_FRAME_FULL) scene_mark_all_dirty(scene);
+            if(bench_case == CASE_FRAME_SLIDE) scene_set_sprites(scene, bench->slide[iteration & 1]);
+            if(bench_case == CASE_FRAME_POP) scene_set_sprites(scene, bench->pop[iteration & 1]);
+            if(bench_case == CASE_FRAME_GAME_OVER) scene_set_game_over_opacity(scene, iteration & 1 ? 128 : 127);
+            scene_render(scene, target);
+            for(u32 i = 0; i < scene->dirty.count; ++i)
+            {
+                pixels += (f64) scene->dirty.rects[i].width * scene->dirty.rects[i].height;
+            }
+            scene->dirty.count = 0;
+        } break;
+        default: break;
+    }
+    return pixels;
+}
+
+/* Average pixels per operation over the first few variants */
+static f64 case_pixels(Bench *bench, BenchCase bench_case)
+{
+    const u32 variants = 4;
+    f64 total = 0;
+    prepare(bench, bench_case);
+    for(u32 v = 0; v < variants; ++v)
+    {
+        if(bench_case > CASE_CIRCLE_CORNER)
+        {
+            total += run_once(bench, bench_case, v);
+            continue;
+        }
+
+        // Rects and circles: draw onto a cleared target and count what changed
+        Bitmap *target = &bench->target;
+        fill_rect_pixels(target->pixels, target->stride, (Rect) { 0, 0, target->width, target->height }, 0);
+        run_once(bench, bench_case, v);
+        for(u64 i = 0; i < (u64) target->width * target->height; ++i) total += target->pixels[i] != 0;
+    }
+    return total / variants;
+}
+
+static int compare_f64(const void *a, const void *b)
+{
+    f64 x = *(const f64 *) a;
+    f64 y = *(const f64 *) b;
+    return (x > y) - (x < y);
+}
+
+static BenchResult run_case(Bench *bench, BenchCase bench_case, BenchConfig *config)
+{
+    BenchResult result = {
+        .width = bench->width,
+        .height = bench->height,
+        .board_size = bench->board_size,
+        .bench_case = bench_case,
+        .runs = config->runs,
+    };
+    result.pixels = case_pixels(bench, bench_case);
+    prepare(bench, bench_case);
+
+    // Warming up doubles as finding how many iterations make a run last run_time. Even without any
+    // warm-up it goes on until the clock has seen some time go by, or there is nothing to go on.
+    u64 iteration = 0;
+    u64 batch = 1;
+    f64 start = timer_now();
+    f64 elapsed = 0;
+    while(elapsed < config->warmup_time || elapsed <= 0)
+    {
+        for(u64 i = 0; i < batch; ++i) run_once(bench, bench_case, iteration++);
+        elapsed = timer_now() - start;
+        if(elapsed < config->warmup_time / 4 || elapsed <= 0) batch *= 2;
+    }
+    f64 per_iteration = elapsed / iteration;
+    u64 iterations = per_iteration > 0 ? (u64) (config->run_time / per_iteration) : 1;
+    if(iterations < 1) iterations = 1;
+    result.iterations = iterations;
+
+    f64 *times = (f64 *) malloc(config->runs * sizeof(f64));
+    for(u32 r = 0; r < config->runs; ++r)
+    {
+        f64 run_start = timer_now();
+        for(u64 i = 0; i < iterations; ++i) run_once(bench, bench_case, iteration++);
+        times[r] = (timer_now() - run_start) * 1e9 / iterations;
+    }
+
+    f64 sum = 0;
+    for(u32 r = 0; r < config->runs; ++r) sum += times[r];
+    f64 mean = sum / config->runs;
+    f64 squares = 0;
+    for(u32 r = 0; r < config->runs; ++r) squares += (times[r] - mean) * (times[r] - mean);
+    result.deviation = config->runs > 1 ? sqrt(squares / (config->runs - 1)) : 0;
+
+    qsort(times, config->runs, sizeof(f64), compare_f64);
+    result.min = times[0];
+    result.max = times[config->runs - 1];
+    result.median = config->runs % 2 ? times[config->runs / 2]
+                                     : (times[config->runs / 2 - 1] + times[config->runs / 2]) / 2;
+    free(times);
+    return result;
+}
+
+static f64 ns_per_pixel(BenchResult *result)
+{
+    return result->pixels > 0 ? result->median / result->pixels : 0;
+}
+
+static void print_result(BenchResult *result)
+{
+    char resolution[32];
+    snprintf(resolution, sizeof(resolution), "%ux%u", result->width, result->height);
+    printf("%-10s %3ux%-2u %-16s %12.1f %6.1f%% %10.3f %12.1f%s\n", resolution, result->board_size, result->board_size,
+           case_names[result->bench_case], result->median, 100.0 * result->deviation / result->median,
+           ns_per_pixel(result), 1e9 / result->median, is_frame(result->bench_case) ? " fps" : "");
+}
+
+static void write_csv(BenchResult *results, u32 count, FILE *file)
+{
+    fprintf(file, "width,height,board,case,pixels,runs,iterations,median_ns,min_ns,max_ns,stddev_ns,ns_per_pixel,per_sec\n");
+    for(u32 i = 0; i < count; ++i)
+    {
+        BenchResult *r = &results[i];
+        fprintf(file, "%u,%u,%u,%s,%.0f,%u,%llu,%.2f,%.2f,%.2f,%.2f,%.4f,%.1f\n", r->width, r->height, r->board_size,
+                case_names[r->bench_case], r->pixels, r->runs, (unsigned long long) r->iterations,
+                r->median, r->min, r->max, r->deviation, ns_per_pixel(r), 1e9 / r->median);
+    }
+}
+
+static void write_json(BenchResult *results, u32 count, FILE *file)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"fill_kernel\": \"%s\",\n", raster_kernel_name());
+    fprintf(file, "  \"blend_kernel\": \"%s\",\n", blit_kernel_name());
+    fprintf(file, "  \"results\": [");
+    for(u32 i = 0; i < count; ++i)
+    {
+        BenchResult *r = &results[i];
+        fprintf(file, "%s\n    {\"width\": %u, \"height\": %u, \"board\": %u, \"case\": \"%s\", \"pixels\": %.0f, "
+                "\"runs\": %u, \"iterations\": %llu, \"median_ns\": %.2f, \"min_ns\": %.2f, \"max_ns\": %.2f, "
+                "\"stddev_ns\": %.2f, \"ns_per_pixel\": %.4f, \"per_sec\": %.1f}",
+                i ? "," : "", r->width, r->height, r->board_size, case_names[r->bench_case], r->pixels, r->runs,
+                (unsigned long long) r->iterations, r->median, r->min, r->max, r->deviation, ns_per_pixel(r),
+                1e9 / r->median);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+// Most resolutions and board sizes one run takes
+#define MAX_LIST 16
+
+/* Comma separated WIDTHxHEIGHT list, returns how many there were or 0 if one didn't parse */
+static u32 parse_resolutions(char *text, u32 widths[MAX_LIST], u32 heights[MAX_LIST])
+{
+    u32 count = 0;
+    for(char *item = strtok(text, ","); item; item = strtok(NULL, ","))
+    {
+        char *end;
+        u32 width = strtoul(item, &end, 10);
+        if(*end != 'x' || count == MAX_LIST) return 0;
+        u32 height = strtoul(end + 1, &end, 10);
+        if(*end || width < 64 || height < 64) return 0;
+        widths[count] = width;
+        heights[count] = height;
+        count++;
+    }
+    return count;
+}
+
+static u32 parse_sizes(char *text, u32 sizes[MAX_LIST])
+{
+    u32 count = 0;
+    for(char *item = strtok(text, ","); item; item = strtok(NULL, ","))
+    {
+        char *end;
+        u32 size = strtoul(item, &end, 10);
+        if(*end || size < GRID_MIN || size > GRID_MAX || count == MAX_LIST) return 0;
+        sizes[count++] = size;
+    }
+    return count;
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-R resolutions] [-n board sizes] [-c case] [-r runs] [-t ms per run] [-w warmup ms] [-o results]\n", name);
+    fprintf(stderr, "  -R  comma separated WIDTHxHEIGHT (default 800x800,1280x720,1920x1080,2560x1440,3840x2160)\n");
+    fprintf(stderr, "  -n  comma separated board sizes from %u to %u (default 4,8)\n", GRID_MIN, GRID_MAX);
+    fprintf(stderr, "  -c  only runs the cases whose name contains this, e.g. rect, tile or frame\n");
+    fprintf(stderr, "  -r  timed runs per case, the median is reported (default 5)\n");
+    fprintf(stderr, "  -o  also writes every result as CSV, or JSON if the name ends in .json\n");
+    fprintf(stderr, "cases:");
+    for(u32 i = 0; i < CASE_COUNT; ++i) fprintf(stderr, " %s", case_names[i]);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    u32 widths[MAX_LIST] = { 800, 1280, 1920, 2560, 3840 };
+    u32 heights[MAX_LIST] = { 800, 720, 1080, 1440, 2160 };
+    u32 resolution_count = 5;
+    u32 sizes[MAX_LIST] = { 4, 8 };
+    u32 size_count = 2;
+    const char *filter = NULL;
+    const char *output_path = NULL;
+    BenchConfig config = { .runs = 5, .run_time = 0.02, .warmup_time = 0.02 };
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-R") == 0 && i + 1 < argc)
+        {
+            resolution_count = parse_resolutions(argv[++i], widths, heights);
+            if(!resolution_count)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            size_count = parse_sizes(argv[++i], sizes);
+            if(!size_count)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            config.runs = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            config.run_time = strtod(argv[++i], NULL) / 1000.0;
+        }
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            config.warmup_time = strtod(argv[++i], NULL) / 1000.0;
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(config.runs == 0 || config.run_time <= 0 || config.warmup_time < 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *output = NULL;
+    if(output_path)
+    {
+        output = fopen(output_path, "w");
+        if(!output)
+        {
+            fprintf(stderr, "%s: can't create %s\n", argv[0], output_path);
+            return 1;
+        }
+    }
+
+    u32 max_results = resolution_count * size_count * CASE_COUNT;
+    BenchResult *results = (BenchResult *) malloc(max_results * sizeof(BenchResult));
+    u32 result_count = 0;
+
+    printf("fill kernel: %s, blend kernel: %s, %u runs of ~%.0f ms per case\n",
+           raster_kernel_name(), blit_kernel_name(), config.runs, config.run_time * 1000.0);
+    printf("%-10s %-6s %-16s %12s %7s %10s %12s\n", "resolution", "board", "case", "ns/op", "stddev", "ns/pixel", "per sec");
+    for(u32 r = 0; r < resolution_count; ++r)
+    {
+        for(u32 s = 0; s < size_count; ++s)
+        {
+            Bench bench;
+            bench_init(&bench, widths[r], heights[r], sizes[s]);
+            for(u32 c = 0; c < CASE_COUNT; ++c)
+            {
+                if(filter && !strstr(case_names[c], filter)) continue;
+                BenchResult *result = &results[result_count++];
+                *result = run_case(&bench, (BenchCase) c, &config);
+                print_result(result);
+                fflush(stdout);
+            }
+            bench_free(&bench);
+        }
+    }
+
+    if(output)
+    {
+        size_t length = strlen(output_path);
+        if(length >= 5 && strcmp(output_path + length - 5, ".json") == 0) write_json(results, result_count, output);
+        else write_csv(results, result_count, output);
+        fclose(output);
+    }
+    free(results);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "atlas.o" ] && rm atlas.o
+[ -f "blit.o" ] && rm blit.o
+[ -f "colors.o" ] && rm colors.o
+[ -f "draw.o" ] && rm draw.o
+[ -f "font.o" ] && rm font.o
+[ -f "raster.o" ] && rm raster.o
+[ -f "scene.o" ] && rm scene.o
+[ -f "render_bench.o" ] && rm render_bench.o
+[ -f "tf_render_bench" ] && rm tf_render_bench
+
+gcc -Wall -O3 -c ../../source/atlas.c
+gcc -Wall -O3 -c ../../source/blit.c
+gcc -Wall -O3 -c ../../source/colors.c
+gcc -Wall -O3 -c ../../source/draw.c
+gcc -Wall -O3 -c ../../source/font.c
+gcc -Wall -O3 -c ../../source/raster.c
+gcc -Wall -O3 -c ../../source/scene.c
+gcc -Wall -O3 -c ../../source/render_bench.c
+gcc -O3 -o tf_render_bench atlas.o blit.o colors.o draw.o font.o raster.o scene.o render_bench.o -lm
+popd
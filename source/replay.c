@@ -0,0 +1,136 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "record.h"
+#include "timing.h"
+
+/* Reads game record files written by tf and tf_bench. By default every game is replayed through */
+/* the game rules and checked against what was recorded.                                         */
+
+static void print_board(Board board)
+{
+    for(int i = 0; i < CELL_NUM; ++i)
+    {
+        u8 val = board_get(board, i);
+        printf("%6u", val ? 1u << val : 0);
+        if(i % LENGTH == LENGTH - 1) printf("\n");
+    }
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s file [-g game] [-s]\n", name);
+    fprintf(stderr, "  -g game  replay one game and print its moves and boards\n");
+    fprintf(stderr, "  -s       only scan the moves without replaying them\n");
+}
+
+static const char *dir_names[4] = { "left", "right", "up", "down" };
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    i64 single = -1;
+    b32 scan = false;
+    for(int i = 2; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-g") == 0 && i + 1 < argc) single = strtoll(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "-s") == 0) scan = true;
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    RecordFile file;
+    if(!record_open(&file, argv[1]))
+    {
+        fprintf(stderr, "%s: can't read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    if(file.rebuilt_index) printf("no index in file, rebuilt it from %" PRIu64 " games\n", file.game_count);
+
+    board_init();
+    Game game;
+    RecordedGame recorded;
+
+    if(single >= 0)
+    {
+        if(!record_game(&file, single, &recorded))
+        {
+            fprintf(stderr, "%s: no game %" PRIi64 "\n", argv[0], single);
+            return 1;
+        }
+        printf("game %" PRIi64 ": seed %" PRIu64 ", %u moves, score %u\n", single,
+               recorded.header.seed, recorded.header.move_count, recorded.header.score);
+        game_new(&game, recorded.header.seed);
+        print_board(game.board);
+        for(u32 i = 0; i < recorded.header.move_count; ++i)
+        {
+            Dir dir = recorded_move(&recorded, i);
+            printf("\nmove %u: %s\n", i, dir_names[dir]);
+            if(!game_move(&game, dir)) printf("move does nothing!\n");
+            print_board(game.board);
+        }
+        b32 matches = game.board == recorded.header.final && game.score == recorded.header.score;
+        printf("\nfinal state %s the recording\n", matches ? "matches" : "does NOT match");
+        record_close(&file);
+        return matches ? 0 : 2;
+    }
+
+    u64 moves = 0;
+    u64 bad = 0;
+    u64 dir_counts[4] = {0};
+    f64 start = timer_now();
+    for(u64 i = 0; i < file.game_count; ++i)
+    {
+        if(!record_game(&file, i, &recorded))
+        {
+            printf("game %" PRIu64 ": truncated\n", i);
+            bad++;
+            continue;
+        }
+        moves += recorded.header.move_count;
+
+        if(scan)
+        {
+            for(u32 j = 0; j < recorded.header.move_count; ++j) dir_counts[recorded_move(&recorded, j)]++;
+            continue;
+        }
+
+        i64 mismatch = record_replay(&recorded, &game);
+        if(mismatch == REPLAY_BAD_START)
+        {
+            printf("game %" PRIu64 ": seed %" PRIu64 " doesn't give its starting board\n", i, recorded.header.seed);
+            bad++;
+        }
+        else if(mismatch != REPLAY_OK)
+        {
+            printf("game %" PRIu64 ": seed %" PRIu64 " diverges at move %" PRIi64 "\n", i, recorded.header.seed, mismatch);
+            bad++;
+        }
+    }
+    f64 elapsed = timer_now() - start;
+
+    printf("games:       %" PRIu64 "\n", file.game_count);
+    printf("moves:       %" PRIu64 "\n", moves);
+    printf("file size:   %" PRIu64 " bytes (%.2f bits per move)\n", file.size, moves ? file.size * 8.0 / moves : 0.0);
+    printf("%s %.3f s (%.0f moves/sec)\n", scan ? "scanned in: " : "replayed in:", elapsed, moves / elapsed);
+    if(scan)
+    {
+        for(int i = 0; i < 4; ++i) printf("%-6s %14" PRIu64 "\n", dir_names[i], dir_counts[i]);
+    }
+    else
+    {
+        printf("bad games:   %" PRIu64 "\n", bad);
+    }
+
+    record_close(&file);
+    return bad ? 2 : 0;
+}
@@ -0,0 +1,17 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "board.o" ] && rm board.o
+[ -f "game.o" ] && rm game.o
+[ -f "record.o" ] && rm record.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "replay.o" ] && rm replay.o
+[ -f "tf_replay" ] && rm tf_replay
+
+gcc -Wall -O3 -c ../../source/board.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/record.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/replay.c
+gcc -O3 -o tf_replay board.o game.o record.o rng.o replay.o -lpthread
+popd
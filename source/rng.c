@@ -0,0 +1,106 @@
+#include <time.h>
+#include <unistd.h>
+#include "rng.h"
+
+static inline u64 rotl(u64 x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static u64 splitmix64(u64 *state)
+{
+    u64 z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, u64 seed)
+{
+    for(int i = 0; i < 4; ++i)
+    {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+u64 rng_seed_from_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    u64 state = ((u64) ts.tv_sec * 1000000000ull + ts.tv_nsec) ^ ((u64) getpid() << 32);
+    return splitmix64(&state);
+}
+
+u64 seed_sequence(u64 seed, u64 index)
+{
+    u64 state = seed + index * 0x9e3779b97f4a7c15ull;
+    return splitmix64(&state);
+}
+
+u64 rng_next(Rng *rng)
+{
+    u64 *s = rng->s;
+    u64 result = rotl(s[1] * 5, 7) * 9;
+    u64 t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+/* Lemire's multiply and shift. The product's low half tells whether this draw landed in the few */
+/* values that would bias the result; that only happens with probability bound / 2^32, so the    */
+/* loop practically never runs and there is no division on the common path.                      */
+u32 rng_bounded(Rng *rng, u32 bound)
+{
+    u64 product = (rng_next(rng) >> 32) * (u64) bound;
+    u32 low = (u32) product;
+    if(low < bound)
+    {
+        u32 threshold = -bound % bound;
+        while(low < threshold)
+        {
+            product = (rng_next(rng) >> 32) * (u64) bound;
+            low = (u32) product;
+        }
+    }
+    return product >> 32;
+}
+
+void rng_jump(Rng *rng)
+{
+    static const u64 jump[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+    u64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+    for(int i = 0; i < 4; ++i)
+    {
+        for(int b = 0; b < 64; ++b)
+        {
+            if(jump[i] & ((u64) 1 << b))
+            {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
+
+Rng rng_split(Rng *rng)
+{
+    Rng stream = *rng;
+    rng_jump(rng);
+    return stream;
+}
@@ -0,0 +1,36 @@
+#include "types.h"
+
+#ifndef RNG
+#define RNG
+
+/* xoshiro256**. Small, fast and with a jump function, so one seed can be split into as many */
+/* non-overlapping streams as there are threads.                                             */
+typedef struct
+{
+    u64 s[4];
+} Rng;
+
+/* Any seed is fine, including 0. The state is filled in from splitmix64 so similar seeds still */
+/* give unrelated streams.                                                                      */
+void rng_seed(Rng *rng, u64 seed);
+
+/* Seed taken from the clock and the process id, for when nobody asked for a specific one */
+u64 rng_seed_from_time();
+
+/* The index'th output of a splitmix64 generator started at seed. Random access, so game i of a */
+/* batch can be given its own seed without generating the ones before it.                       */
+u64 seed_sequence(u64 seed, u64 index);
+
+u64 rng_next(Rng *rng);
+
+/* Uniform in [0, bound) with no modulo bias. bound must not be 0. */
+u32 rng_bounded(Rng *rng, u32 bound);
+
+/* Advances the generator by 2^128 steps */
+void rng_jump(Rng *rng);
+
+/* Returns a generator positioned where this one is and jumps this one past it. Calling it once */
+/* per worker gives every worker its own stream that won't overlap with any other.             */
+Rng rng_split(Rng *rng);
+
+#endif
@@ -0,0 +1,243 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include "rollout.h"
+#include "timing.h"
+
+/* Lanes a task keeps in flight. A new playout goes into a lane as soon as the one in it ends, so this */
+/* only has to be wide enough to keep batch_step busy.                                                 */
+#define PLAYOUT_LANES 64
+
+/* Playouts of one move per task */
+#define PLAYOUTS_PER_TASK 256
+
+RolloutConfig rollout_default_config()
+{
+    RolloutConfig config = {
+        .playouts = 1000,
+        .time_budget = 0,
+    };
+    return config;
+}
+
+void rollout_init(Rollout *rollout, RolloutConfig config, Pool *pool)
+{
+    rollout->config = config;
+    rollout->stats = (RolloutStats) {0};
+    rollout->pool = pool;
+    rollout->worker_count = pool ? pool->thread_count : 1;
+    rollout->workers = (RolloutWorker *) calloc(rollout->worker_count, sizeof(RolloutWorker));
+
+    u32 words = batch_mask_words(PLAYOUT_LANES);
+    for(u32 i = 0; i < rollout->worker_count; ++i)
+    {
+        RolloutWorker *worker = &rollout->workers[i];
+        batch_create(&worker->batch, PLAYOUT_LANES);
+        worker->policy_rngs = (Rng *) malloc(PLAYOUT_LANES * sizeof(Rng));
+        worker->dirs = (u8 *) malloc(PLAYOUT_LANES);
+        worker->changed = (u64 *) malloc(words * sizeof(u64));
+        worker->terminal = (u64 *) malloc(words * sizeof(u64));
+        worker->live = (u64 *) malloc(words * sizeof(u64));
+    }
+}
+
+void rollout_free(Rollout *rollout)
+{
+    for(u32 i = 0; i < rollout->worker_count; ++i)
+    {
+        RolloutWorker *worker = &rollout->workers[i];
+        batch_destroy(&worker->batch);
+        free(worker->policy_rngs);
+        free(worker->dirs);
+        free(worker->changed);
+        free(worker->terminal);
+        free(worker->live);
+    }
+    free(rollout->workers);
+    rollout->workers = NULL;
+    rollout->worker_count = 0;
+}
+
+typedef struct
+{
+    Rollout *rollout;
+    /* Board after the move, before anything spawns */
+    Board afterstate;
+    u64 seed;
+    /* Playouts [first, first + count) of the move */
+    u64 first;
+    u64 count;
+    /* 0 for no deadline */
+    f64 deadline;
+    /* Runs even after the deadline, so every move gets some playouts */
+    b32 required;
+
+    u64 played;
+    u64 moves;
+    u64 score;
+} PlayoutTask;
+
+/* Playout index of a move starts from afterstate with its own spawn and move generators. Every move */
+/* uses the same seeds so they get compared over the same luck.                                     */
+static void start_playout(RolloutWorker *worker, u32 lane, Board afterstate, u64 seed, u64 index)
+{
+    Game game = {0};
+    game.board = afterstate;
+    rng_seed(&game.rng, seed_sequence(seed, 2 * index));
+    rng_seed(&worker->policy_rngs[lane], seed_sequence(seed, 2 * index + 1));
+    matrix_update(&game.board, &game.rng);
+    batch_load(&worker->batch, lane, &game);
+}
+
+static void playout_task(void *arg, u32 worker_index)
+{
+    PlayoutTask *task = (PlayoutTask *) arg;
+    if(!task->required && task->deadline > 0 && timer_now() > task->deadline) return;
+
+    RolloutWorker *worker = &task->rollout->workers[worker_index];
+    BoardBatch *batch = &worker->batch;
+    batch->count = task->count < PLAYOUT_LANES ? (u32) task->count : PLAYOUT_LANES;
+    u32 words = batch_mask_words(batch->count);
+
+    u64 started = 0;
+    for(u32 word = 0; word < words; ++word) worker->live[word] = 0;
+    for(u32 lane = 0; lane < batch->count; ++lane)
+    {
+        start_playout(worker, lane, task->afterstate, task->seed, task->first + started++);
+        worker->live[lane / 64] |= (u64) 1 << (lane % 64);
+    }
+
+    // Random moves, any of the four. One that changes nothing just gets drawn again next step, which
+    // picks uniformly out of the moves that do something.
+    while(task->played < task->count)
+    {
+        for(u32 lane = 0; lane < batch->count; ++lane)
+        {
+            worker->dirs[lane] = (u8) (rng_next(&worker->policy_rngs[lane]) >> 62);
+        }
+        batch_step(batch, worker->dirs, worker->changed, worker->terminal);
+
+        for(u32 word = 0; word < words; ++word)
+        {
+            u64 over = worker->terminal[word] & worker->live[word];
+            while(over)
+            {
+                u32 lane = word * 64 + __builtin_ctzll(over);
+                over &= over - 1;
+                task->played += 1;
+                task->moves += batch->moves[lane];
+                task->score += batch->scores[lane];
+                if(started == task->count)
+                {
+                    worker->live[word] &= ~((u64) 1 << (lane % 64));
+                    continue;
+                }
+                start_playout(worker, lane, task->afterstate, task->seed, task->first + started++);
+            }
+        }
+    }
+}
+
+Dir rollout_choose(Rollout *rollout, Board board, u64 seed)
+{
+    f64 start = timer_now();
+    u64 per_move = rollout->config.playouts ? rollout->config.playouts : 1;
+    u64 task_rounds = (per_move + PLAYOUTS_PER_TASK - 1) / PLAYOUTS_PER_TASK;
+    f64 deadline = rollout->config.time_budget > 0 ? start + rollout->config.time_budget / 1000.0 : 0;
+
+    Dir dirs[4];
+    Board afterstates[4];
+    u32 move_scores[4];
+    u32 count = 0;
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Board next = board_move(board, dir);
+        if(next == board) continue;
+
+        dirs[count] = dir;
+        afterstates[count] = next;
+        move_scores[count] = board_move_score(board, dir);
+        count++;
+    }
+    if(count == 0) return LEFT;
+
+    // Round robin over the moves, so a deadline cuts them all short by about the same amount
+    u64 task_count = task_rounds * count;
+    PlayoutTask *tasks = (PlayoutTask *) calloc(task_count, sizeof(PlayoutTask));
+    for(u64 i = 0; i < task_count; ++i)
+    {
+        u64 round = i / count;
+        u32 move = i % count;
+        u64 first = round * PLAYOUTS_PER_TASK;
+        tasks[i] = (PlayoutTask) {
+            .rollout = rollout,
+            .afterstate = afterstates[move],
+            .seed = seed,
+            .first = first,
+            .count = per_move - first < PLAYOUTS_PER_TASK ? per_move - first : PLAYOUTS_PER_TASK,
+            .deadline = deadline,
+            .required = round == 0,
+        };
+    }
+
+    if(rollout->pool)
+    {
+        // Workers take their newest task first, so the first round goes in last
+        for(u64 i = task_count; i-- > 0;) pool_submit(rollout->pool, playout_task, &tasks[i]);
+        pool_wait(rollout->pool);
+    }
+    else
+    {
+        for(u64 i = 0; i < task_count; ++i) playout_task(&tasks[i], 0);
+    }
+
+    u64 played[4] = {0};
+    u64 scores[4] = {0};
+    for(u64 i = 0; i < task_count; ++i)
+    {
+        played[i % count] += tasks[i].played;
+        scores[i % count] += tasks[i].score;
+        rollout->stats.playouts += tasks[i].played;
+        rollout->stats.playout_moves += tasks[i].moves;
+    }
+    free(tasks);
+
+    Dir best = dirs[0];
+    f64 best_value = -1.0;
+    for(u32 i = 0; i < count; ++i)
+    {
+        f64 value = move_scores[i] + (f64) scores[i] / played[i];
+        if(value > best_value)
+        {
+            best_value = value;
+            best = dirs[i];
+        }
+    }
+
+    rollout->stats.moves += 1;
+    rollout->stats.time += timer_now() - start;
+    return best;
+}
+
+Dir rollout_policy(Game *game, void *data)
+{
+    return rollout_choose((Rollout *) data, game->board, rng_next(&game->policy_rng));
+}
+
+void rollout_merge_stats(RolloutStats *into, RolloutStats *from)
+{
+    into->moves += from->moves;
+    into->playouts += from->playouts;
+    into->playout_moves += from->playout_moves;
+    into->time += from->time;
+}
+
+void rollout_print_stats(RolloutStats *stats, FILE *file)
+{
+    if(!stats->moves) return;
+
+    fprintf(file, "mc moves:    %" PRIu64 " (%.1f playouts/move, %.3f ms/move)\n",
+            stats->moves, (f64) stats->playouts / stats->moves, stats->time * 1000.0 / stats->moves);
+    fprintf(file, "mc playouts: %" PRIu64 " (%.0f playouts/sec, %.1f moves per playout)\n",
+            stats->playouts, stats->playouts / stats->time,
+            stats->playouts ? (f64) stats->playout_moves / stats->playouts : 0.0);
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include "batch.h"
+#include "game.h"
+#include "pool.h"
+
+#ifndef ROLLOUT
+#define ROLLOUT
+
+/* Pure Monte-Carlo move choice: every move that changes the board is tried, the game is played out to */
+/* the end with random moves from there many times over, and the move whose playouts score the most on */
+/* average wins. No evaluation function and nothing to tune but the number of playouts, which makes it */
+/* the baseline the other strategies get compared against. Playouts run through batch_step.            */
+
+typedef struct
+{
+    /* Playouts per candidate move */
+    u32 playouts;
+    /* Milliseconds per move. When non zero playouts stop being started once it runs out, every move */
+    /* still gets at least one task's worth. 0 means always play all of them.                       */
+    f64 time_budget;
+} RolloutConfig;
+
+typedef struct
+{
+    u64 moves;
+    u64 playouts;
+    /* Moves played inside playouts */
+    u64 playout_moves;
+    f64 time;
+} RolloutStats;
+
+/* Scratch for one thread's playouts */
+typedef struct
+{
+    BoardBatch batch;
+    Rng *policy_rngs;
+    u8 *dirs;
+    u64 *changed;
+    u64 *terminal;
+    u64 *live;
+} RolloutWorker;
+
+typedef struct
+{
+    RolloutConfig config;
+    RolloutStats stats;
+    /* Playouts are split into tasks on this when it isn't NULL, otherwise they run on the caller */
+    Pool *pool;
+    /* One per pool thread, or just the one without a pool */
+    RolloutWorker *workers;
+    u32 worker_count;
+} Rollout;
+
+RolloutConfig rollout_default_config();
+/* batch_init must have been called before choosing moves. pool can be shared with other work but */
+/* rollout_choose waits for it to drain, so not with work that is still running.                  */
+void rollout_init(Rollout *rollout, RolloutConfig config, Pool *pool);
+void rollout_free(Rollout *rollout);
+
+/* Best move for a board that isn't game over. Playout i of every move is seeded from seed and i, so */
+/* the choice only depends on board and seed, not on the number of threads.                         */
+Dir rollout_choose(Rollout *rollout, Board board, u64 seed);
+
+/* Policy wrapper around rollout_choose, data is the Rollout. The seed comes from the game's policy_rng. */
+Dir rollout_policy(Game *game, void *data);
+
+void rollout_merge_stats(RolloutStats *into, RolloutStats *from);
+void rollout_print_stats(RolloutStats *stats, FILE *file);
+
+#endif
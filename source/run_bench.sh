@@ -0,0 +1,3 @@
+#!/bin/sh
+
+../target/release/tf_bench "$@"
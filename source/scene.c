@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blit.h"
+#include "draw.h"
+#include "font.h"
+#include "scene.h"
+
+/* Top left corner of a tile at rest in cell index */
+static f32 rest_x(Scene *scene, u32 index)
+{
+    return (index % scene->board_size) * scene->cell_pitch + 1;
+}
+
+static f32 rest_y(Scene *scene, u32 index)
+{
+    return (index / scene->board_size) * scene->cell_pitch + 1;
+}
+
+static void draw_grid(Scene *scene, Bitmap *target, u32 color)
+{
+    for(u32 i = 0; i < scene->board_size; ++i)
+    {
+        for(u32 j = 0; j < scene->board_size; ++j)
+        {
+            rect(i * scene->cell_pitch, j * scene->cell_pitch, scene->cell_pitch - 1, scene->cell_pitch - 1, color, target);
+        }
+    }
+}
+
+void scene_init(Scene *scene, u32 width, u32 height, u32 board_size)
+{
+    memset(scene, 0, sizeof(*scene));
+    scene->width = width;
+    scene->height = height;
+    scene->board_size = board_size;
+    scene->cell_pitch = (width < height ? width : height) / board_size;
+    scene->cell_length = scene->cell_pitch - 3;
+    atlas_build(&scene->atlas, scene->cell_length);
+
+    scene->background = (u32 *) malloc((size_t) width * height * sizeof(u32));
+    Bitmap background = { scene->background, width, height, width };
+    fill_rect_pixels(scene->background, width, (Rect) { 0, 0, width, height }, ~0u);
+    draw_grid(scene, &background, 0);
+
+    scene_mark_all_dirty(scene);
+}
+
+void scene_free(Scene *scene)
+{
+    atlas_free(&scene->atlas);
+    free(scene->background);
+    free(scene->game_over_panel.pixels);
+    memset(scene, 0, sizeof(*scene));
+}
+
+static void fill_cell(Scene *scene, Tile *tile, u32 index, Rect clip, Bitmap *target)
+{
+    if(tile->under)
+    {
+        atlas_draw(&scene->atlas, tile->under, rest_x(scene, index), rest_y(scene, index), scene->cell_length, 255, target, clip);
+    }
+    atlas_draw(&scene->atlas, tile->value, tile->x, tile->y, tile->length, tile->opacity, target, clip);
+}
+
+/* Every pixel fill_cell can touch */
+static Rect tile_bounds(Scene *scene, Tile *tile, u32 index)
+{
+    Rect bounds = atlas_bounds(&scene->atlas, tile->x, tile->y, tile->length);
+    if(tile->under)
+    {
+        bounds = rect_union(bounds, atlas_bounds(&scene->atlas, rest_x(scene, index), rest_y(scene, index), scene->cell_length));
+    }
+    return bounds;
+}
+
+static b32 same_tile(Tile *a, Tile *b)
+{
+    return a->x == b->x && a->y == b->y && a->length == b->length &&
+           a->value == b->value && a->opacity == b->opacity && a->under == b->under;
+}
+
+void scene_mark_dirty(Scene *scene, Rect area)
+{
+    DirtyRects *dirty = &scene->dirty;
+    area = rect_intersect(area, (Rect) { 0, 0, scene->width, scene->height });
+    if(rect_empty(area)) return;
+
+    // Overlapping areas get merged so nothing is uploaded twice
+    for(u32 i = 0; i < dirty->count; ++i)
+    {
+        if(!rect_empty(rect_intersect(dirty->rects[i], area)))
+        {
+            dirty->rects[i] = rect_union(dirty->rects[i], area);
+            return;
+        }
+    }
+
+    if(dirty->count == MAX_DIRTY_RECTS)
+    {
+        // Too many separate areas, just redraw the box around all of them
+        for(u32 i = 1; i < dirty->count; ++i) area = rect_union(area, dirty->rects[i]);
+        dirty->rects[0] = rect_union(area, dirty->rects[0]);
+        dirty->count = 1;
+        return;
+    }
+    dirty->rects[dirty->count++] = area;
+}
+
+void scene_mark_all_dirty(Scene *scene)
+{
+    scene->dirty.rects[0] = (Rect) { 0, 0, scene->width, scene->height };
+    scene->dirty.count = 1;
+}
+
+void scene_set_sprites(Scene *scene, Sprite sprites[GRID_CELLS])
+{
+    for(u32 i = 0; i < scene->board_size * scene->board_size; ++i)
+    {
+        Sprite sprite = sprites[i];
+        if(!sprite.value || sprite.scale <= 0)
+        {
+            scene->cells[i].active = false;
+            continue;
+        }
+
+        // Scaled around the centre of where the tile would be at rest
+        f32 length = scene->cell_length * sprite.scale;
+        f32 inset = ((f32) scene->cell_length - length) * 0.5f;
+        Tile tile = {
+            .x = sprite.x * scene->cell_pitch + 1 + inset,
+            .y = sprite.y * scene->cell_pitch + 1 + inset,
+            .length = length,
+            .value = sprite.value,
+            .opacity = (u8) (sprite.opacity * 255.0f + 0.5f),
+            .under = sprite.under,
+        };
+        scene->cells[i].active = true;
+        scene->cells[i].tile = tile;
+    }
+}
+
+void scene_show_game_over(Scene *scene, u32 score)
+{
+    u32 width = scene->width;
+    u32 height = scene->height;
+    u32 *pixels = (u32 *) malloc((size_t) width * height * sizeof(u32));
+    free(scene->game_over_panel.pixels);
+    scene->game_over_panel = (Bitmap) { pixels, width, height, width };
+    scene->game_over_opacity = 0;
+    Rect all = { 0, 0, width, height };
+    u32 white = opaque((255 << 16) | (255 << 8) | (255 << 0));
+
+    fill_rect_pixels(pixels, width, all, premultiply((24 << 16) | (24 << 8) | (24 << 0), 160));
+
+    // Never below 1 so the text still shows on tiny exports, centred as signed since it can be wider than them
+    const char *title = "GAME OVER";
+    u32 scale = width >= 64 ? width / 64 : 1;
+    i32 title_y = height / 2 - text_height(scale) - scale;
+    draw_text(title, ((i32) width - (i32) text_width(title, scale)) / 2, title_y, scale, white, pixels, width, all);
+
+    char text[32];
+    snprintf(text, sizeof(text), "SCORE %u", score);
+    scale = scale >= 2 ? scale / 2 : 1;
+    draw_text(text, ((i32) width - (i32) text_width(text, scale)) / 2, height / 2 + scale * 2, scale, white, pixels, width, all);
+}
+
+void scene_hide_game_over(Scene *scene)
+{
+    if(scene->game_over_opacity) scene_mark_all_dirty(scene);
+    free(scene->game_over_panel.pixels);
+    scene->game_over_panel = (Bitmap) {0};
+    scene->game_over_opacity = 0;
+}
+
+void scene_set_game_over_opacity(Scene *scene, u32 opacity)
+{
+    if(!scene->game_over_panel.pixels || opacity == scene->game_over_opacity) return;
+    scene->game_over_opacity = opacity;
+    scene_mark_all_dirty(scene);
+}
+
+void scene_render(Scene *scene, Bitmap *target)
+{
+    // Work out what moved, appeared, disappeared, faded or changed colour since the last frame
+    for(u32 i = 0; i < scene->board_size * scene->board_size; ++i)
+    {
+        Cell *cell = &scene->cells[i];
+        if(cell->drawn && cell->active && same_tile(&cell->drawn_tile, &cell->tile)) continue;
+
+        if(cell->drawn) scene_mark_dirty(scene, cell->drawn_rect);
+        if(cell->active)
+        {
+            cell->drawn_rect = tile_bounds(scene, &cell->tile, i);
+            scene_mark_dirty(scene, cell->drawn_rect);
+        }
+
+        cell->drawn = cell->active;
+        cell->drawn_tile = cell->tile;
+    }
+
+    for(u32 r = 0; r < scene->dirty.count; ++r)
+    {
+        Rect area = scene->dirty.rects[r];
+        copy_rect_pixels(target->pixels, scene->background, scene->width, area);
+
+        for(u32 i = 0; i < scene->board_size * scene->board_size; ++i)
+        {
+            if(scene->cells[i].active) fill_cell(scene, &scene->cells[i].tile, i, area, target);
+        }
+
+        if(scene->game_over_opacity)
+        {
+            blit(target, area, &scene->game_over_panel, 0, 0, scene->width, scene->height, BLIT_NEAREST, scene->game_over_opacity);
+        }
+    }
+}
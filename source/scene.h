@@ -0,0 +1,96 @@
+#include "animate.h"
+#include "atlas.h"
+#include "raster.h"
+#include "types.h"
+
+#ifndef SCENE
+#define SCENE
+
+/* Draws the board into a plain Bitmap: the grid, the tiles at whatever point of their animation they */
+/* are, and the game over panel. Nothing in here knows about X11, the window client presents what it */
+/* draws and tf_export writes it out as video frames.                                                 */
+/*                                                                                                    */
+/* Frames are drawn incrementally. The scene remembers what it drew last, so the target has to hold  */
+/* the previous frame and only the parts that changed (the dirty rects) get drawn again.              */
+
+// Seconds the game over panel takes to fade in
+#define GAME_OVER_FADE 0.4
+
+/* How a cell's tile looks in one frame */
+typedef struct
+{
+    f32 x;
+    f32 y;
+    /* Width and height, tiles shrink and grow when they pop */
+    f32 length;
+    /* Exponent of the tile */
+    u8 value;
+    /* 0 to 255 */
+    u8 opacity;
+    /* Exponent of a tile drawn at rest in this cell underneath this one, 0 if there is none */
+    u8 under;
+} Tile;
+
+typedef struct
+{
+    b32 active;
+    Tile tile;
+    /* What the cell looked like in the last frame that got rendered, so scene_render knows what has changed */
+    b32 drawn;
+    Tile drawn_tile;
+    Rect drawn_rect;
+} Cell;
+
+/* Parts of the target that changed since the last frame. Only these get redrawn and presented. */
+#define MAX_DIRTY_RECTS 32
+typedef struct
+{
+    Rect rects[MAX_DIRTY_RECTS];
+    u32 count;
+} DirtyRects;
+
+typedef struct
+{
+    u32 width;
+    u32 height;
+    /* The target stays the same size whatever the board size, the grid squares shrink to fit */
+    u32 board_size;
+    u32 cell_pitch;
+    // Size of a tile inside its grid square
+    u32 cell_length;
+
+    Cell cells[GRID_CELLS];
+    /* Every tile pre-drawn at cell_length */
+    TileAtlas atlas;
+    DirtyRects dirty;
+    /* The cleared target with the grid drawn on it. Dirty areas get restored from it. */
+    u32 *background;
+
+    /* The board dimmed with the final score written over it. Only allocated once the game is over. */
+    Bitmap game_over_panel;
+    // Opacity the panel is drawn with, 0 to 255
+    u32 game_over_opacity;
+} Scene;
+
+/* A width x height scene for boards of board_size. Everything starts out dirty. */
+void scene_init(Scene *scene, u32 width, u32 height, u32 board_size);
+void scene_free(Scene *scene);
+
+void scene_mark_dirty(Scene *scene, Rect area);
+/* Makes the next frame redraw the whole target, e.g. when it is new or its contents were lost */
+void scene_mark_all_dirty(Scene *scene);
+
+/* Turns the sprites of the current point of an animation into the tiles of the next frame */
+void scene_set_sprites(Scene *scene, Sprite sprites[GRID_CELLS]);
+
+/* Builds the game over panel, not showing yet. scene_set_game_over_opacity fades it in. */
+void scene_show_game_over(Scene *scene, u32 score);
+/* Takes the panel away again */
+void scene_hide_game_over(Scene *scene);
+void scene_set_game_over_opacity(Scene *scene, u32 opacity);
+
+/* Redraws the dirty areas of target, which must be width x height with rows width pixels apart and */
+/* hold the last frame rendered into it. scene->dirty is left for the caller to present and clear.   */
+void scene_render(Scene *scene, Bitmap *target);
+
+#endif
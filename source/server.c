@@ -0,0 +1,323 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "latency.h"
+#include "session.h"
+
+/* Serves games to any number of clients over a Unix domain socket, see protocol.h. One thread, one  */
+/* epoll set, level triggered: every time a client's socket is readable one read's worth of requests */
+/* (up to SESSION_BATCH) is handled and answered with a single write, so a client that pipelines    */
+/* gets many moves per system call and nobody can starve the others. A client that stops reading is  */
+/* not read from either until it has taken the responses it is owed.                                */
+
+// epoll data of the listening socket, sessions are their slab index
+#define LISTENER (~0ull)
+#define MAX_EVENTS 256
+
+typedef struct
+{
+    SessionSlab slab;
+    int epoll_fd;
+    int listen_fd;
+    /* Out of file descriptors: the listener isn't watched until a session closes and frees one */
+    b32 accept_paused;
+
+    u64 accepted;
+    u64 requests;
+    /* Time from a read returning to its responses being written, for every request */
+    LatencyHistogram service;
+    /* Since the last report */
+    u64 interval_requests;
+    LatencyHistogram interval_service;
+} Server;
+
+static volatile sig_atomic_t stopping;
+
+static void handle_stop(int signal_number)
+{
+    (void) signal_number;
+    stopping = 1;
+}
+
+/* Stops or starts waking up for clients waiting to connect */
+static void watch_listener(Server *server, b32 accepting)
+{
+    struct epoll_event event = { .events = accepting ? EPOLLIN : 0, .data.u64 = LISTENER };
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->listen_fd, &event);
+    server->accept_paused = !accepting;
+}
+
+static void close_session(Server *server, u32 index)
+{
+    Session *session = slab_get(&server->slab, index);
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    session->fd = -1;
+    slab_release(&server->slab, index);
+    if(server->accept_paused) watch_listener(server, true);
+}
+
+static void watch(Server *server, u32 index, u32 events)
+{
+    Session *session = slab_get(&server->slab, index);
+    struct epoll_event event = { .events = events, .data.u64 = index };
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, session->fd, &event);
+}
+
+static void accept_clients(Server *server)
+{
+    for(;;)
+    {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0)
+        {
+            if(errno == EINTR) continue;
+            if(errno == EMFILE || errno == ENFILE)
+            {
+                // The client stays queued, and a level triggered listener would wake every wait for it
+                fprintf(stderr, "out of file descriptors at %u sessions, raise ulimit -n\n", server->slab.live);
+                watch_listener(server, false);
+            }
+            return;
+        }
+
+        u32 index = slab_alloc(&server->slab);
+        slab_get(&server->slab, index)->fd = fd;
+        struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP, .data.u64 = index };
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        server->accepted++;
+    }
+}
+
+/* Sends what the socket wouldn't take last time. Returns false if it still won't take all of it. */
+static b32 flush_pending(Session *session)
+{
+    while(session->pending_sent < session->pending_length)
+    {
+        ssize_t sent = write(session->fd, session->pending + session->pending_sent,
+                             session->pending_length - session->pending_sent);
+        if(sent < 0)
+        {
+            if(errno == EINTR) continue;
+            // Anything but a full socket shows up as an error or hangup on the next wait
+            return false;
+        }
+        session->pending_sent += sent;
+    }
+    session->pending_length = 0;
+    session->pending_sent = 0;
+    return true;
+}
+
+/* One read's worth of requests. Returns false if the session should be closed. */
+static b32 serve(Server *server, u32 index)
+{
+    Session *session = slab_get(&server->slab, index);
+    u8 input[SESSION_BATCH * sizeof(Request)];
+    Response responses[SESSION_BATCH];
+
+    memcpy(input, session->partial, session->partial_length);
+    ssize_t bytes = read(session->fd, input + session->partial_length, sizeof(input) - session->partial_length);
+    if(bytes == 0) return false;
+    if(bytes < 0) return errno == EAGAIN || errno == EINTR;
+    u64 start = latency_now();
+
+    u32 total = session->partial_length + (u32) bytes;
+    u32 count = total / sizeof(Request);
+    for(u32 i = 0; i < count; ++i)
+    {
+        Request request;
+        memcpy(&request, input + i * sizeof(Request), sizeof(Request));
+        session_handle(session, &request, &responses[i]);
+    }
+    session->partial_length = total - count * sizeof(Request);
+    memcpy(session->partial, input + count * sizeof(Request), session->partial_length);
+    if(!count) return true;
+
+    u32 length = count * sizeof(Response);
+    ssize_t sent = write(session->fd, responses, length);
+    if(sent < 0 && errno != EAGAIN && errno != EINTR) return false;
+    if(sent < 0) sent = 0;
+    if((u32) sent < length)
+    {
+        // Stop reading from it until it has caught up
+        if(!session->pending) session->pending = (u8 *) malloc(SESSION_BATCH * sizeof(Response));
+        memcpy(session->pending, (u8 *) responses + sent, length - sent);
+        session->pending_length = length - sent;
+        session->pending_sent = 0;
+        watch(server, index, EPOLLOUT);
+    }
+
+    u64 elapsed = latency_now() - start;
+    latency_record_many(&server->interval_service, elapsed, count);
+    server->interval_requests += count;
+    return true;
+}
+
+static void report(Server *server, f64 seconds, b32 final)
+{
+    if(final)
+    {
+        printf("sessions: %" PRIu64 " served, %u still open\n", server->accepted, server->slab.live);
+        printf("requests: %" PRIu64 " (%.0f/sec)\n", server->requests, server->requests / seconds);
+        latency_print(&server->service, "service", stdout);
+        return;
+    }
+
+    printf("%u sessions, %.0f requests/sec, ", server->slab.live, server->interval_requests / seconds);
+    latency_print(&server->interval_service, "service", stdout);
+    fflush(stdout);
+}
+
+/* Adds the interval's numbers to the totals and starts a new one */
+static void end_interval(Server *server)
+{
+    server->requests += server->interval_requests;
+    latency_merge(&server->service, &server->interval_service);
+    server->interval_requests = 0;
+    latency_clear(&server->interval_service);
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-S socket path] [-i report seconds]\n", name);
+    fprintf(stderr, "  -S path     socket to listen on (default %s)\n", SERVER_DEFAULT_PATH);
+    fprintf(stderr, "  -i seconds  prints requests/sec and service time percentiles this often, 0 for never (default 5)\n");
+    fprintf(stderr, "  runs until interrupted, then prints the totals\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = SERVER_DEFAULT_PATH;
+    f64 interval = 5;
+    for(int i = 1; i < argc; i += 2)
+    {
+        if(i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(strcmp(argv[i], "-S") == 0) path = argv[i + 1];
+        else if(strcmp(argv[i], "-i") == 0) interval = strtod(argv[i + 1], NULL);
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long\n", argv[0]);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    Server server = {0};
+    slab_init(&server.slab);
+    server.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    // A socket left behind by a server that didn't get to clean up, anything else is left alone
+    struct stat existing;
+    if(stat(path, &existing) == 0 && S_ISSOCK(existing.st_mode)) unlink(path);
+    if(server.listen_fd < 0 || bind(server.listen_fd, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+       listen(server.listen_fd, SOMAXCONN) < 0)
+    {
+        fprintf(stderr, "%s: can't listen on %s: %s\n", argv[0], path, strerror(errno));
+        return 1;
+    }
+
+    server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.u64 = LISTENER };
+    epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &listen_event);
+
+    struct sigaction action = { .sa_handler = handle_stop };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    board_init();
+    printf("listening on %s\n", path);
+    fflush(stdout);
+
+    struct epoll_event events[MAX_EVENTS];
+    u64 start = latency_now();
+    u64 last_report = start;
+    u64 report_every = (u64) (interval * 1e9);
+    while(!stopping)
+    {
+        int timeout = -1;
+        if(report_every)
+        {
+            u64 due = last_report + report_every;
+            u64 now = latency_now();
+            timeout = due > now ? (int) ((due - now) / 1000000) + 1 : 0;
+        }
+
+        int count = epoll_wait(server.epoll_fd, events, MAX_EVENTS, timeout);
+        if(count < 0 && errno != EINTR) break;
+
+        for(int i = 0; i < count; ++i)
+        {
+            if(events[i].data.u64 == LISTENER)
+            {
+                accept_clients(&server);
+                continue;
+            }
+
+            u32 index = (u32) events[i].data.u64;
+            Session *session = slab_get(&server.slab, index);
+            b32 open = !(events[i].events & EPOLLERR);
+            if(open && session->pending_length)
+            {
+                // Nothing more is read until the client has taken every response it is owed, or newer ones
+                // would go out ahead of them. A client that hung up both ways can't take them any more.
+                if((events[i].events & EPOLLOUT) && flush_pending(session))
+                {
+                    watch(&server, index, EPOLLIN | EPOLLRDHUP);
+                }
+                else if(events[i].events & EPOLLHUP)
+                {
+                    open = false;
+                }
+            }
+            // Whatever a client sent before hanging up still gets read, the read returns 0 after it
+            else if(open && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)))
+            {
+                open = serve(&server, index);
+            }
+            if(!open) close_session(&server, index);
+        }
+
+        u64 now = latency_now();
+        if(report_every && now - last_report >= report_every)
+        {
+            report(&server, (now - last_report) / 1e9, false);
+            end_interval(&server);
+            last_report = now;
+        }
+    }
+
+    end_interval(&server);
+    report(&server, (latency_now() - start) / 1e9, true);
+
+    for(u32 i = 0; i < server.slab.chunk_count * SESSION_CHUNK; ++i)
+    {
+        Session *session = slab_get(&server.slab, i);
+        if(session->fd >= 0) close(session->fd);
+    }
+    close(server.epoll_fd);
+    close(server.listen_fd);
+    unlink(path);
+    slab_free(&server.slab);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "board.o" ] && rm board.o
+[ -f "game.o" ] && rm game.o
+[ -f "latency.o" ] && rm latency.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "session.o" ] && rm session.o
+[ -f "server.o" ] && rm server.o
+[ -f "load.o" ] && rm load.o
+[ -f "tf_server" ] && rm tf_server
+[ -f "tf_load" ] && rm tf_load
+
+gcc -Wall -O3 -c ../../source/board.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/latency.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/session.c
+gcc -Wall -O3 -c ../../source/server.c
+gcc -Wall -O3 -c ../../source/load.c
+gcc -O3 -o tf_server board.o game.o latency.o rng.o session.o server.o
+gcc -O3 -o tf_load board.o game.o latency.o rng.o load.o
+popd
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+#include "session.h"
+
+void slab_init(SessionSlab *slab)
+{
+    memset(slab, 0, sizeof(*slab));
+}
+
+void slab_free(SessionSlab *slab)
+{
+    for(u32 i = 0; i < slab->chunk_count; ++i)
+    {
+        for(u32 j = 0; j < SESSION_CHUNK; ++j) free(slab->chunks[i][j].pending);
+        free(slab->chunks[i]);
+    }
+    free(slab->chunks);
+    free(slab->free);
+    memset(slab, 0, sizeof(*slab));
+}
+
+u32 slab_alloc(SessionSlab *slab)
+{
+    if(slab->free_count == 0)
+    {
+        u32 chunk = slab->chunk_count++;
+        slab->chunks = (Session **) realloc(slab->chunks, slab->chunk_count * sizeof(Session *));
+        slab->chunks[chunk] = (Session *) aligned_alloc(64, SESSION_CHUNK * sizeof(Session));
+        slab->free = (u32 *) realloc(slab->free, slab->chunk_count * SESSION_CHUNK * sizeof(u32));
+
+        // Pushed backwards so the lowest index comes off first
+        for(u32 i = SESSION_CHUNK; i-- > 0;)
+        {
+            slab->chunks[chunk][i].pending = NULL;
+            slab->chunks[chunk][i].fd = -1;
+            slab->free[slab->free_count++] = chunk * SESSION_CHUNK + i;
+        }
+    }
+
+    u32 index = slab->free[--slab->free_count];
+    Session *session = slab_get(slab, index);
+    u8 *pending = session->pending;
+    memset(session, 0, sizeof(*session));
+    // A buffer a client once needed is kept for whoever gets the slot next
+    session->pending = pending;
+    session->fd = -1;
+    slab->live++;
+    return index;
+}
+
+void slab_release(SessionSlab *slab, u32 index)
+{
+    slab->free[slab->free_count++] = index;
+    slab->live--;
+}
+
+void session_handle(Session *session, const Request *request, Response *response)
+{
+    Game *game = &session->game;
+    response->op = request->op;
+    response->status = STATUS_OK;
+    response->padding = 0;
+    response->tag = request->tag;
+
+    if(request->op >= OP_COUNT || (request->op == OP_MOVE && request->dir > DOWN))
+    {
+        response->status = STATUS_BAD_REQUEST;
+    }
+    else if(request->op == OP_NEW)
+    {
+        game_new(game, request->seed);
+        session->has_game = true;
+    }
+    else if(!session->has_game)
+    {
+        response->status = STATUS_NO_GAME;
+    }
+    else if(request->op == OP_MOVE)
+    {
+        if(!game_move(game, (Dir) request->dir)) response->status = STATUS_NO_MOVE;
+    }
+
+    if(session->has_game)
+    {
+        response->board = game->board;
+        response->score = game->score;
+        response->moves = game->moves;
+        response->over = game_over(game->board);
+    }
+    else
+    {
+        response->board = 0;
+        response->score = 0;
+        response->moves = 0;
+        response->over = false;
+    }
+}
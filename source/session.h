@@ -0,0 +1,61 @@
+#include "game.h"
+#include "protocol.h"
+
+#ifndef SESSION
+#define SESSION
+
+/* One client of tf_server: its game and whatever is left over between reads and writes. Sessions live */
+/* in a slab of fixed size chunks rather than one heap allocation each, so the hot part of thousands   */
+/* of them sits in a few contiguous blocks, a freed slot is reused while it is still in cache, and     */
+/* epoll can hand back a slot index instead of a pointer.                                            */
+
+// Sessions per slab chunk. Chunks are never moved or freed before the slab, so pointers stay good.
+#define SESSION_CHUNK 1024
+
+// Requests handled per read. A client that isn't reading never has more responses than this waiting.
+#define SESSION_BATCH 128
+
+typedef struct
+{
+    Game game;
+    int fd;
+    u8 has_game;
+    u8 partial_length;
+    /* Bytes of a request that came in without the rest of it yet */
+    u8 partial[sizeof(Request)];
+    /* Responses the socket wouldn't take yet, room for SESSION_BATCH of them. Only allocated once a */
+    /* client falls behind reading.                                                                 */
+    u8 *pending;
+    u16 pending_length;
+    u16 pending_sent;
+} Session;
+
+/* Every session on two cache lines of its own */
+_Static_assert(sizeof(Session) == 128, "Session should stay two cache lines");
+
+typedef struct
+{
+    Session **chunks;
+    u32 chunk_count;
+    /* Free slots, the most recently freed last */
+    u32 *free;
+    u32 free_count;
+    u32 live;
+} SessionSlab;
+
+void slab_init(SessionSlab *slab);
+void slab_free(SessionSlab *slab);
+
+/* Index of a cleared session, the slab grows a chunk at a time when it is full */
+u32 slab_alloc(SessionSlab *slab);
+void slab_release(SessionSlab *slab, u32 index);
+
+static inline Session *slab_get(SessionSlab *slab, u32 index)
+{
+    return &slab->chunks[index / SESSION_CHUNK][index % SESSION_CHUNK];
+}
+
+/* Carries out one request on the session's game. board_init must have been called. */
+void session_handle(Session *session, const Request *request, Response *response);
+
+#endif
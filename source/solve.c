@@ -0,0 +1,169 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tablebase.h"
+#include "timing.h"
+
+/* Builds perfect play tables for small games and checks them by playing games with their moves. */
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s file [-n board size] [-w goal tile] [-t threads]\n", name);
+    fprintf(stderr, "       %s file -p [-g games] [-s seed|time]\n", name);
+    fprintf(stderr, "  builds the table of the chance of making the goal tile (default 3x3 to 256) into file\n");
+    fprintf(stderr, "  -p plays games with the table's moves and compares how many make the goal with the table\n");
+    fprintf(stderr, "  boards from %ux%u to %ux%u, goal tiles up to 32768\n",
+            GRID_MIN, GRID_MIN, TABLEBASE_MAX_SIZE, TABLEBASE_MAX_SIZE);
+}
+
+/* Chance of making the goal from a fresh game: every starting pair of 2s is equally likely. The table  */
+/* only keeps one of each set of symmetric pairs, so every pair is looked up rather than read off the   */
+/* first layer.                                                                                         */
+static f64 start_value(Tablebase *table)
+{
+    u32 cells = table->grid_size * table->grid_size;
+    f64 total = 0;
+    u32 count = 0;
+    for(u32 i = 0; i < cells; ++i)
+    {
+        for(u32 j = i + 1; j < cells; ++j)
+        {
+            Grid grid;
+            grid_clear(&grid, table->grid_size);
+            grid.cells[i] = 1;
+            grid.cells[j] = 1;
+            total += tablebase_value(table, &grid);
+            count++;
+        }
+    }
+    return total / count;
+}
+
+static int play(Tablebase *table, u64 games, u64 seed)
+{
+    u64 wins = 0, moves = 0, probes = 0;
+    f64 start = timer_now();
+    for(u64 i = 0; i < games; ++i)
+    {
+        GridGame game;
+        grid_game_new(&game, table->grid_size, seed_sequence(seed, i));
+
+        Dir dir;
+        f32 value;
+        while(grid_max_tile(&game.grid) < table->goal && tablebase_best_move(table, &game.grid, &dir, &value))
+        {
+            grid_game_move(&game, dir);
+            probes++;
+        }
+        moves += game.moves;
+        if(grid_max_tile(&game.grid) >= table->goal) wins++;
+    }
+    f64 elapsed = timer_now() - start;
+
+    f64 expected = start_value(table);
+    f64 rate = (f64) wins / games;
+    // Standard error of the win rate if the table is right
+    f64 error = expected * (1.0 - expected) / games;
+    printf("games:       %" PRIu64 " (%.1f moves per game)\n", games, (f64) moves / games);
+    printf("made goal:   %.4f (table says %.4f, %+.1f standard errors)\n", rate, expected,
+           error > 0 ? (rate - expected) / sqrt(error) : 0.0);
+    printf("moves/sec:   %.0f\n", probes / elapsed);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    TablebaseConfig config = { .size = 3, .goal = 8, .threads = 0 };
+    b32 playing = false;
+    u64 games = 10000;
+    u64 seed = DEFAULT_SEED;
+    for(int i = 2; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            config.size = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            u64 tile = strtoull(argv[++i], NULL, 10);
+            config.goal = tile > 1 && (tile & (tile - 1)) == 0 ? __builtin_ctzll(tile) : 0;
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            config.threads = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-p") == 0)
+        {
+            playing = true;
+        }
+        else if(strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            games = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            ++i;
+            seed = strcmp(argv[i], "time") == 0 ? rng_seed_from_time() : strtoull(argv[i], NULL, 10);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    board_init();
+
+    if(!playing)
+    {
+        if(config.size < GRID_MIN || config.size > TABLEBASE_MAX_SIZE || config.goal < 2 || config.goal > 15)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        printf("board:       %ux%u\n", config.size, config.size);
+        printf("goal:        %u\n", 1u << config.goal);
+        f64 start = timer_now();
+        if(!tablebase_generate(argv[1], &config, stdout))
+        {
+            fprintf(stderr, "%s: can't write %s\n", argv[0], argv[1]);
+            return 1;
+        }
+        f64 elapsed = timer_now() - start;
+
+        Tablebase table;
+        if(!tablebase_open(&table, argv[1]))
+        {
+            fprintf(stderr, "%s: can't read back %s\n", argv[0], argv[1]);
+            return 1;
+        }
+        printf("positions:   %" PRIu64 " in %" PRIu64 " layers\n", table.state_count, table.layer_count);
+        printf("file size:   %.1f MB\n", table.size / (1024.0 * 1024.0));
+        printf("time:        %.3f s (%.0f positions/sec)\n", elapsed, table.state_count / elapsed);
+        printf("made goal:   %.6f from a fresh game with perfect play\n", start_value(&table));
+        tablebase_close(&table);
+        return 0;
+    }
+
+    Tablebase table;
+    if(!tablebase_open(&table, argv[1]))
+    {
+        fprintf(stderr, "%s: can't read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    printf("board:       %ux%u, goal %u, %" PRIu64 " positions\n", table.grid_size, table.grid_size,
+           1u << table.goal, table.state_count);
+    if(games == 0) games = 1;
+    int result = play(&table, games, seed);
+    tablebase_close(&table);
+    return result;
+}
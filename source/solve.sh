@@ -0,0 +1,23 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "board.o" ] && rm board.o
+[ -f "game.o" ] && rm game.o
+[ -f "grid.o" ] && rm grid.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "io.o" ] && rm io.o
+[ -f "tablebase.o" ] && rm tablebase.o
+[ -f "solve.o" ] && rm solve.o
+[ -f "tf_solve" ] && rm tf_solve
+
+gcc -Wall -O3 -c ../../source/board.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/grid.c
+gcc -Wall -O3 -c ../../source/pool.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/io.c
+gcc -Wall -O3 -c ../../source/tablebase.c
+gcc -Wall -O3 -c ../../source/solve.c
+gcc -O3 -o tf_solve board.o game.o grid.o io.o pool.o rng.o tablebase.o solve.o -lpthread -lm
+popd
@@ -0,0 +1,556 @@
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io.h"
+#include "pool.h"
+#include "tablebase.h"
+#include "timing.h"
+
+static const char file_magic[4] = { 'T', 'F', 'T', 'B' };
+
+/* Positions handed to a task at a time. Small enough that a layer of a few hundred thousand positions */
+/* still keeps every thread busy.                                                                     */
+#define STATES_PER_TASK 4096
+
+u64 tablebase_key(Grid *grid)
+{
+    u64 key = 0;
+    for(u32 i = 0; i < grid->size * grid->size; ++i)
+    {
+        key |= (u64) (grid->cells[i] & 0xf) << (i * 4);
+    }
+    return key;
+}
+
+void tablebase_unpack(u64 key, u32 size, Grid *grid)
+{
+    grid_clear(grid, size);
+    for(u32 i = 0; i < size * size; ++i)
+    {
+        grid->cells[i] = (key >> (i * 4)) & 0xf;
+    }
+}
+
+/* 3x3 versions of board_symmetry's steps: a key has 12 bits per row and 3 rows */
+static inline u64 mirror3(u64 key)
+{
+    return ((key & 0x00f00f00full) << 8) | (key & 0x0f00f00f0ull) | ((key >> 8) & 0x00f00f00full);
+}
+
+static inline u64 flip3(u64 key)
+{
+    return ((key & 0xfffull) << 24) | (key & 0xfff000ull) | ((key >> 24) & 0xfffull);
+}
+
+static inline u64 transpose3(u64 key)
+{
+    return (key & 0xf000f000full) | ((key & 0x000f000f0ull) << 8) | ((key & 0x000000f00ull) << 16) |
+           ((key >> 8) & 0x000f000f0ull) | ((key >> 16) & 0x000000f00ull);
+}
+
+/* Smallest key of the 8 rotations and reflections of the position. Symmetric positions have the same */
+/* chance of making the goal, so only this one is stored.                                             */
+static u64 canonical_key(u64 key, u32 size)
+{
+    if(size == LENGTH) return board_canonical(key, NULL);
+
+    u64 transposed = transpose3(key);
+    u64 keys[SYMMETRY_COUNT] = {
+        key, mirror3(key), flip3(key), flip3(mirror3(key)),
+        transposed, mirror3(transposed), flip3(transposed), flip3(mirror3(transposed)),
+    };
+    u64 best = keys[0];
+    for(u32 s = 1; s < SYMMETRY_COUNT; ++s) best = keys[s] < best ? keys[s] : best;
+    return best;
+}
+
+static u64 key_sum(u64 key)
+{
+    u64 sum = 0;
+    for(; key; key >>= 4)
+    {
+        if(key & 0xf) sum += (u64) 1 << (key & 0xf);
+    }
+    return sum;
+}
+
+static const TablebaseLayer *find_layer(Tablebase *table, u64 sum)
+{
+    u64 low = 0, high = table->layer_count;
+    while(low < high)
+    {
+        u64 middle = (low + high) / 2;
+        if(table->layers[middle].sum < sum) low = middle + 1;
+        else high = middle;
+    }
+    return low < table->layer_count && table->layers[low].sum == sum ? &table->layers[low] : NULL;
+}
+
+/* Index of key in the table, -1 if it isn't there */
+static i64 find_state(Tablebase *table, u64 key)
+{
+    const TablebaseLayer *layer = find_layer(table, key_sum(key));
+    if(!layer) return -1;
+
+    const u64 *keys = table->keys + layer->first;
+    u64 low = 0, high = layer->count;
+    while(low < high)
+    {
+        u64 middle = (low + high) / 2;
+        if(keys[middle] < key) low = middle + 1;
+        else high = middle;
+    }
+    return low < layer->count && keys[low] == key ? (i64) (layer->first + low) : -1;
+}
+
+static inline f32 state_value(Tablebase *table, u64 key, u64 *missing)
+{
+    i64 index = find_state(table, canonical_key(key, table->grid_size));
+    if(index >= 0) return table->values[index];
+    *missing += 1;
+    return 0;
+}
+
+/* Chance of making the goal tile from the position after a move, before its tiles spawn. Every pair of */
+/* empty cells is equally likely to get the two 2s, or the only empty cell gets a single one. Positions */
+/* that should be in the table and aren't count as lost and get added to missing.                     */
+static f32 afterstate_value(Tablebase *table, Grid *after, u64 *missing)
+{
+    if(grid_max_tile(after) >= table->goal) return 1.0f;
+
+    u8 empty[TABLEBASE_MAX_SIZE * TABLEBASE_MAX_SIZE];
+    u32 empty_count = 0;
+    for(u32 i = 0; i < after->size * after->size; ++i)
+    {
+        if(!after->cells[i]) empty[empty_count++] = i;
+    }
+
+    u64 key = tablebase_key(after);
+    if(empty_count == 1) return state_value(table, key | (u64) 1 << (empty[0] * 4), missing);
+
+    f64 total = 0;
+    for(u32 i = 0; i < empty_count; ++i)
+    {
+        for(u32 j = i + 1; j < empty_count; ++j)
+        {
+            total += state_value(table, key | (u64) 1 << (empty[i] * 4) | (u64) 1 << (empty[j] * 4), missing);
+        }
+    }
+    return (f32) (total * 2.0 / (empty_count * (empty_count - 1)));
+}
+
+/* Best chance over every move, left at 0 if no move changes the grid. Returns false in that case. */
+static b32 best_move(Tablebase *table, Grid *grid, Dir *best, f32 *best_value, u64 *missing)
+{
+    b32 found = false;
+    *best_value = 0;
+    for(Dir dir = LEFT; dir <= DOWN; ++dir)
+    {
+        Grid after = *grid;
+        u32 score = 0;
+        if(!grid_move(&after, dir, &score)) continue;
+
+        f32 value = afterstate_value(table, &after, missing);
+        if(!found || value > *best_value)
+        {
+            *best_value = value;
+            if(best) *best = dir;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/* ------------------------------------ Generation ------------------------------------ */
+
+typedef struct
+{
+    u64 *keys;
+    u64 count;
+    u64 capacity;
+} KeyList;
+
+static void key_list_push(KeyList *list, u64 key)
+{
+    if(list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->keys = (u64 *) realloc(list->keys, list->capacity * sizeof(u64));
+    }
+    list->keys[list->count++] = key;
+}
+
+static void key_list_append(KeyList *list, KeyList *from)
+{
+    if(list->count + from->count > list->capacity)
+    {
+        list->capacity = list->count + from->count;
+        list->keys = (u64 *) realloc(list->keys, list->capacity * sizeof(u64));
+    }
+    memcpy(list->keys + list->count, from->keys, from->count * sizeof(u64));
+    list->count += from->count;
+}
+
+static void key_list_free(KeyList *list)
+{
+    free(list->keys);
+    *list = (KeyList) {0};
+}
+
+/* Least significant digit first radix sort on the bits keys use, then drops the duplicates. Digits */
+/* that are the same for every key are skipped, which is most of them for the early layers.         */
+static void sort_unique(KeyList *list, u32 bits)
+{
+    if(list->count > 1)
+    {
+        u64 *from = list->keys;
+        u64 *to = (u64 *) malloc(list->count * sizeof(u64));
+        for(u32 shift = 0; shift < bits; shift += 8)
+        {
+            u64 counts[256] = {0};
+            for(u64 i = 0; i < list->count; ++i) counts[(from[i] >> shift) & 0xff]++;
+            if(counts[(from[0] >> shift) & 0xff] == list->count) continue;
+
+            u64 offset = 0;
+            for(u32 digit = 0; digit < 256; ++digit)
+            {
+                u64 count = counts[digit];
+                counts[digit] = offset;
+                offset += count;
+            }
+            for(u64 i = 0; i < list->count; ++i) to[counts[(from[i] >> shift) & 0xff]++] = from[i];
+
+            u64 *swap = from;
+            from = to;
+            to = swap;
+        }
+        if(from != list->keys)
+        {
+            memcpy(list->keys, from, list->count * sizeof(u64));
+            to = from;
+        }
+        free(to);
+    }
+
+    u64 unique = 0;
+    for(u64 i = 0; i < list->count; ++i)
+    {
+        if(unique == 0 || list->keys[i] != list->keys[unique - 1]) list->keys[unique++] = list->keys[i];
+    }
+    list->count = unique;
+}
+
+typedef struct
+{
+    TablebaseConfig *config;
+    const u64 *keys;
+    u64 count;
+    /* Positions one 2 later and two 2s later, sorted and without duplicates */
+    KeyList next[2];
+} ExpandTask;
+
+static void expand_task(void *arg, u32 worker)
+{
+    ExpandTask *task = (ExpandTask *) arg;
+    u32 size = task->config->size;
+
+    for(u64 k = 0; k < task->count; ++k)
+    {
+        Grid grid;
+        tablebase_unpack(task->keys[k], size, &grid);
+        for(Dir dir = LEFT; dir <= DOWN; ++dir)
+        {
+            Grid after = grid;
+            u32 score = 0;
+            if(!grid_move(&after, dir, &score)) continue;
+            // Games end at the goal tile, nothing after it is needed
+            if(grid_max_tile(&after) >= task->config->goal) continue;
+
+            u8 empty[TABLEBASE_MAX_SIZE * TABLEBASE_MAX_SIZE];
+            u32 empty_count = 0;
+            for(u32 i = 0; i < size * size; ++i)
+            {
+                if(!after.cells[i]) empty[empty_count++] = i;
+            }
+
+            u64 key = tablebase_key(&after);
+            if(empty_count == 1)
+            {
+                key_list_push(&task->next[0], canonical_key(key | (u64) 1 << (empty[0] * 4), size));
+                continue;
+            }
+            for(u32 i = 0; i < empty_count; ++i)
+            {
+                for(u32 j = i + 1; j < empty_count; ++j)
+                {
+                    u64 next = key | (u64) 1 << (empty[i] * 4) | (u64) 1 << (empty[j] * 4);
+                    key_list_push(&task->next[1], canonical_key(next, size));
+                }
+            }
+        }
+    }
+
+    sort_unique(&task->next[0], size * size * 4);
+    sort_unique(&task->next[1], size * size * 4);
+}
+
+typedef struct
+{
+    Tablebase *table;
+    f32 *values;
+    u64 first;
+    u64 count;
+    u64 missing;
+} SolveTask;
+
+static void solve_task(void *arg, u32 worker)
+{
+    SolveTask *task = (SolveTask *) arg;
+    Tablebase *table = task->table;
+
+    for(u64 i = task->first; i < task->first + task->count; ++i)
+    {
+        Grid grid;
+        tablebase_unpack(table->keys[i], table->grid_size, &grid);
+        best_move(table, &grid, NULL, &task->values[i], &task->missing);
+    }
+}
+
+/* Finds every layer in order of tile sum and appends its keys to fd. Returns false if a write fails. */
+static b32 enumerate_layers(int fd, TablebaseConfig *config, Pool *pool, TablebaseLayer **layers_out,
+                            u64 *layer_count_out, u64 *state_count_out, FILE *log)
+{
+    u32 cells = config->size * config->size;
+    u32 bits = cells * 4;
+
+    // Layers still being added to, indexed by (sum / 2) % 3: the one being expanded and the two after it
+    KeyList pending[3] = {{0}};
+    u64 sum = 4;
+    for(u32 i = 0; i < cells; ++i)
+    {
+        for(u32 j = i + 1; j < cells; ++j)
+        {
+            key_list_push(&pending[(sum / 2) % 3], canonical_key((u64) 1 << (i * 4) | (u64) 1 << (j * 4), config->size));
+        }
+    }
+
+    TablebaseLayer *layers = NULL;
+    u64 layer_count = 0, layer_capacity = 0, state_count = 0;
+    b32 ok = true;
+    for(;; sum += 2)
+    {
+        KeyList *current = &pending[(sum / 2) % 3];
+        if(!current->count)
+        {
+            if(!pending[(sum / 2 + 1) % 3].count && !pending[(sum / 2 + 2) % 3].count) break;
+            continue;
+        }
+
+        f64 start = timer_now();
+        sort_unique(current, bits);
+        if(!write_all(fd, current->keys, current->count * sizeof(u64)))
+        {
+            ok = false;
+            break;
+        }
+
+        if(layer_count == layer_capacity)
+        {
+            layer_capacity = layer_capacity ? layer_capacity * 2 : 256;
+            layers = (TablebaseLayer *) realloc(layers, layer_capacity * sizeof(TablebaseLayer));
+        }
+        layers[layer_count++] = (TablebaseLayer) { sum, state_count, current->count };
+        state_count += current->count;
+
+        u64 task_count = (current->count + STATES_PER_TASK - 1) / STATES_PER_TASK;
+        ExpandTask *tasks = (ExpandTask *) calloc(task_count, sizeof(ExpandTask));
+        for(u64 t = 0; t < task_count; ++t)
+        {
+            tasks[t].config = config;
+            tasks[t].keys = current->keys + t * STATES_PER_TASK;
+            tasks[t].count = t + 1 < task_count ? STATES_PER_TASK : current->count - t * STATES_PER_TASK;
+            pool_submit(pool, expand_task, &tasks[t]);
+        }
+        pool_wait(pool);
+
+        for(u64 t = 0; t < task_count; ++t)
+        {
+            key_list_append(&pending[(sum / 2 + 1) % 3], &tasks[t].next[0]);
+            key_list_append(&pending[(sum / 2 + 2) % 3], &tasks[t].next[1]);
+            key_list_free(&tasks[t].next[0]);
+            key_list_free(&tasks[t].next[1]);
+        }
+        free(tasks);
+
+        if(log) fprintf(log, "layer %6" PRIu64 ": %12" PRIu64 " positions  %8.3f s\n", sum, current->count, timer_now() - start);
+        key_list_free(current);
+    }
+
+    for(u32 i = 0; i < 3; ++i) key_list_free(&pending[i]);
+    *layers_out = layers;
+    *layer_count_out = layer_count;
+    *state_count_out = state_count;
+    return ok;
+}
+
+b32 tablebase_generate(const char *path, TablebaseConfig *config, FILE *log)
+{
+    if(config->size < GRID_MIN || config->size > TABLEBASE_MAX_SIZE || config->goal < 2 || config->goal > 15)
+    {
+        return false;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+
+    // Zeros until the table is finished
+    TablebaseHeader header = {0};
+    Pool *pool = pool_create(config->threads);
+    f64 start = timer_now();
+
+    if(log) fprintf(log, "enumerating positions\n");
+    TablebaseLayer *layers = NULL;
+    u64 layer_count = 0, state_count = 0;
+    b32 ok = write_all(fd, &header, sizeof(header)) &&
+             enumerate_layers(fd, config, pool, &layers, &layer_count, &state_count, log);
+
+    u64 values_offset = sizeof(TablebaseHeader) + state_count * sizeof(u64);
+    u64 directory_offset = (values_offset + state_count * sizeof(f32) + 7) & ~(u64) 7;
+    u64 file_size = directory_offset + layer_count * sizeof(TablebaseLayer);
+    u8 *data = NULL;
+    if(ok && ftruncate(fd, file_size) == 0)
+    {
+        data = (u8 *) mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(data == MAP_FAILED) data = NULL;
+    }
+
+    if(data)
+    {
+        memcpy(data + directory_offset, layers, layer_count * sizeof(TablebaseLayer));
+        Tablebase table = {
+            .data = data,
+            .size = file_size,
+            .grid_size = config->size,
+            .goal = config->goal,
+            .state_count = state_count,
+            .layer_count = layer_count,
+            .layers = (const TablebaseLayer *) (data + directory_offset),
+            .keys = (const u64 *) (data + sizeof(TablebaseHeader)),
+            .values = (const f32 *) (data + values_offset),
+        };
+        f32 *values = (f32 *) (data + values_offset);
+
+        // Each layer only looks at the two after it, which are already done
+        if(log) fprintf(log, "solving %" PRIu64 " positions in %" PRIu64 " layers\n", state_count, layer_count);
+        u64 missing = 0;
+        for(u64 l = layer_count; l-- > 0;)
+        {
+            const TablebaseLayer *layer = &layers[l];
+            u64 task_count = (layer->count + STATES_PER_TASK - 1) / STATES_PER_TASK;
+            SolveTask *tasks = (SolveTask *) calloc(task_count, sizeof(SolveTask));
+            for(u64 t = 0; t < task_count; ++t)
+            {
+                tasks[t].table = &table;
+                tasks[t].values = values;
+                tasks[t].first = layer->first + t * STATES_PER_TASK;
+                tasks[t].count = t + 1 < task_count ? STATES_PER_TASK : layer->count - t * STATES_PER_TASK;
+                pool_submit(pool, solve_task, &tasks[t]);
+            }
+            pool_wait(pool);
+            for(u64 t = 0; t < task_count; ++t) missing += tasks[t].missing;
+            free(tasks);
+        }
+        if(missing && log) fprintf(log, "warning: %" PRIu64 " successors were not in the table\n", missing);
+
+        memcpy(header.magic, file_magic, 4);
+        header.version = TABLEBASE_VERSION;
+        header.size = config->size;
+        header.goal = config->goal;
+        header.state_count = state_count;
+        header.layer_count = layer_count;
+        memcpy(data, &header, sizeof(header));
+        msync(data, file_size, MS_SYNC);
+        munmap(data, file_size);
+        if(log) fprintf(log, "done in %.3f s\n", timer_now() - start);
+    }
+    else
+    {
+        ok = false;
+    }
+
+    free(layers);
+    pool_destroy(pool);
+    close(fd);
+    return ok;
+}
+
+/* ------------------------------------ Probing ------------------------------------ */
+
+b32 tablebase_open(Tablebase *table, const char *path)
+{
+    *table = (Tablebase) {0};
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (u64) st.st_size < sizeof(TablebaseHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return false;
+
+    table->data = (const u8 *) data;
+    table->size = st.st_size;
+
+    TablebaseHeader header;
+    memcpy(&header, data, sizeof(header));
+    u64 values_offset = sizeof(TablebaseHeader) + header.state_count * sizeof(u64);
+    u64 directory_offset = (values_offset + header.state_count * sizeof(f32) + 7) & ~(u64) 7;
+    if(memcmp(header.magic, file_magic, 4) != 0 || header.version != TABLEBASE_VERSION ||
+       directory_offset + header.layer_count * sizeof(TablebaseLayer) != table->size)
+    {
+        tablebase_close(table);
+        return false;
+    }
+
+    table->grid_size = header.size;
+    table->goal = header.goal;
+    table->state_count = header.state_count;
+    table->layer_count = header.layer_count;
+    table->layers = (const TablebaseLayer *) (table->data + directory_offset);
+    table->keys = (const u64 *) (table->data + sizeof(TablebaseHeader));
+    table->values = (const f32 *) (table->data + values_offset);
+    // Probes land all over the place
+    madvise(data, st.st_size, MADV_RANDOM);
+    return true;
+}
+
+void tablebase_close(Tablebase *table)
+{
+    if(table->data) munmap((void *) table->data, table->size);
+    *table = (Tablebase) {0};
+}
+
+f32 tablebase_value(Tablebase *table, Grid *grid)
+{
+    if(grid->size != table->grid_size) return -1.0f;
+    i64 index = find_state(table, canonical_key(tablebase_key(grid), grid->size));
+    return index >= 0 ? table->values[index] : -1.0f;
+}
+
+b32 tablebase_best_move(Tablebase *table, Grid *grid, Dir *dir, f32 *value)
+{
+    if(grid->size != table->grid_size) return false;
+
+    u64 missing = 0;
+    *dir = LEFT;
+    return best_move(table, grid, dir, value, &missing);
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include "grid.h"
+#include "types.h"
+
+#ifndef TABLEBASE
+#define TABLEBASE
+
+/* Perfect play tables for small games. Every position reachable from a fresh game without making the */
+/* goal tile is enumerated and given the probability of making the goal tile with the best possible   */
+/* play from it, worked out backwards from the end of the game with the real move and spawn rules.    */
+/*                                                                                                      */
+/* Spawns only ever add 2s, so the sum of the tiles goes up by 2 or 4 every move and never down. That  */
+/* splits the positions into layers by tile sum where a layer only leads to the two after it: the     */
+/* positions are found a layer at a time going forwards and valued a layer at a time going backwards, */
+/* and only the layers being worked on need to be in memory.                                          */
+/*                                                                                                      */
+/* A position and its rotations and reflections are worth the same, so only the one of them with the  */
+/* smallest key is kept, which makes the tables close to 8 times smaller and quicker to build.        */
+/*                                                                                                      */
+/* File layout, everything in the machine's byte order:                                               */
+/*                                                                                                      */
+/*   header     TablebaseHeader                                                                       */
+/*   keys       u64 per position kept, layer by layer in increasing tile sum, sorted within a layer   */
+/*   values     f32 per position, in the same order as the keys                                       */
+/*   directory  TablebaseLayer per layer, 8 byte aligned                                              */
+/*                                                                                                      */
+/* The header is written last, a file without one was never finished.                                 */
+
+#define TABLEBASE_VERSION 2
+
+// Keys hold 4 bits per cell so only boards up to 4x4 fit
+#define TABLEBASE_MAX_SIZE 4
+
+typedef struct
+{
+    char magic[4];
+    u32 version;
+    u32 size;
+    /* Exponent of the goal tile */
+    u32 goal;
+    u64 state_count;
+    u64 layer_count;
+} TablebaseHeader;
+
+typedef struct
+{
+    /* Sum of the values of the tiles of every position in the layer */
+    u64 sum;
+    /* Index of the layer's first key and value */
+    u64 first;
+    u64 count;
+} TablebaseLayer;
+
+/* A finished table, mapped read only */
+typedef struct
+{
+    const u8 *data;
+    u64 size;
+    u32 grid_size;
+    u32 goal;
+    u64 state_count;
+    u64 layer_count;
+    const TablebaseLayer *layers;
+    const u64 *keys;
+    const f32 *values;
+} Tablebase;
+
+typedef struct
+{
+    /* Board size, GRID_MIN to TABLEBASE_MAX_SIZE */
+    u32 size;
+    /* Exponent of the goal tile, at most 15 */
+    u32 goal;
+    /* 0 means one per online CPU */
+    u32 threads;
+} TablebaseConfig;
+
+/* Cells of grid 4 bits each, cell i in bits [4i, 4i + 4), so a 4x4 key is the same as its Board */
+u64 tablebase_key(Grid *grid);
+void tablebase_unpack(u64 key, u32 size, Grid *grid);
+
+/* Builds the table for config into path, writing progress to log if it isn't NULL. board_init must */
+/* have been called. Returns false if the file can't be written.                                    */
+b32 tablebase_generate(const char *path, TablebaseConfig *config, FILE *log);
+
+b32 tablebase_open(Tablebase *table, const char *path);
+void tablebase_close(Tablebase *table);
+
+/* Chance of making the goal tile from grid with the player to move. -1 if grid isn't in the table: */
+/* the wrong size, already holding the goal tile or not reachable from a fresh game.               */
+f32 tablebase_value(Tablebase *table, Grid *grid);
+
+/* Move with the best chance of making the goal tile from grid, and that chance. Returns false if no  */
+/* move changes the grid or grid isn't the table's size.                                             */
+b32 tablebase_best_move(Tablebase *table, Grid *grid, Dir *dir, f32 *value);
+
+#endif
@@ -0,0 +1,194 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "timing.h"
+
+void frame_timer_init(FrameTimer *timer, f64 fps)
+{
+    memset(timer, 0, sizeof(*timer));
+    timer->budget = 1.0 / fps;
+}
+
+void frame_begin(FrameTimer *timer)
+{
+    timer->frame_start = timer->mark = timer_now();
+    timer->current = (FrameSample) { .start = timer->frame_start * 1000.0 };
+}
+
+void frame_rendered(FrameTimer *timer)
+{
+    f64 time = timer_now();
+    timer->current.render = (time - timer->mark) * 1000.0;
+    timer->mark = time;
+}
+
+void frame_uploaded(FrameTimer *timer)
+{
+    f64 time = timer_now();
+    timer->current.upload = (time - timer->mark) * 1000.0;
+    timer->mark = time;
+}
+
+void frame_end(FrameTimer *timer, b32 pace)
+{
+    f64 deadline = timer->frame_start + timer->budget;
+    f64 time = timer_now();
+    if(time > deadline) timer->missed += 1;
+
+    if(pace && time < deadline)
+    {
+        // Sleeping to an absolute time means the time spent getting here doesn't add up frame after frame
+        struct timespec until = {
+            .tv_sec = (time_t) deadline,
+            .tv_nsec = (long) ((deadline - (f64) (time_t) deadline) * 1000000000.0),
+        };
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) != 0);
+
+        f64 woke = timer_now();
+        timer->current.sleep = (woke - time) * 1000.0;
+        time = woke;
+    }
+
+    timer->current.total = (time - timer->frame_start) * 1000.0;
+    timer->samples[timer->count % FRAME_HISTORY] = timer->current;
+    timer->count += 1;
+}
+
+void frame_timer_skipped(FrameTimer *timer, u64 frames)
+{
+    timer->missed += frames;
+}
+
+static int compare_f32(const void *a, const void *b)
+{
+    f32 x = *(const f32 *) a;
+    f32 y = *(const f32 *) b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest rank percentiles of count values, sorts them in place */
+static Percentiles percentiles(f32 *values, u32 count)
+{
+    Percentiles result = {0};
+    if(!count) return result;
+
+    qsort(values, count, sizeof(f32), compare_f32);
+    result.p50 = values[(count - 1) * 50 / 100];
+    result.p95 = values[(count - 1) * 95 / 100];
+    result.p99 = values[(count - 1) * 99 / 100];
+    result.max = values[count - 1];
+    return result;
+}
+
+void frame_summary(FrameTimer *timer, FrameSummary *summary)
+{
+    u32 count = timer->count < FRAME_HISTORY ? timer->count : FRAME_HISTORY;
+    f32 values[FRAME_HISTORY];
+
+    summary->frames = timer->count;
+    summary->missed = timer->missed;
+
+    for(u32 i = 0; i < count; ++i) values[i] = timer->samples[i].render;
+    summary->render = percentiles(values, count);
+    for(u32 i = 0; i < count; ++i) values[i] = timer->samples[i].upload;
+    summary->upload = percentiles(values, count);
+    for(u32 i = 0; i < count; ++i) values[i] = timer->samples[i].total;
+    summary->total = percentiles(values, count);
+}
+
+void frame_summary_print(FrameSummary *summary, FILE *file)
+{
+    if(!summary->frames) return;
+
+    fprintf(file, "frames:      %" PRIu64 " (%" PRIu64 " missed, %.2f%%)\n",
+            summary->frames, summary->missed, 100.0 * summary->missed / summary->frames);
+    fprintf(file, "render ms:   p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+            summary->render.p50, summary->render.p95, summary->render.p99, summary->render.max);
+    fprintf(file, "upload ms:   p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+            summary->upload.p50, summary->upload.p95, summary->upload.p99, summary->upload.max);
+    fprintf(file, "frame ms:    p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+            summary->total.p50, summary->total.p95, summary->total.p99, summary->total.max);
+}
+
+/* Index into samples of the oldest frame still in the ring */
+static u64 oldest_frame(FrameTimer *timer)
+{
+    return timer->count > FRAME_HISTORY ? timer->count - FRAME_HISTORY : 0;
+}
+
+void frame_timer_write_csv(FrameTimer *timer, FILE *file)
+{
+    fprintf(file, "frame,start_ms,render_ms,upload_ms,sleep_ms,total_ms\n");
+    for(u64 i = oldest_frame(timer); i < timer->count; ++i)
+    {
+        FrameSample *sample = &timer->samples[i % FRAME_HISTORY];
+        fprintf(file, "%" PRIu64 ",%.3f,%.4f,%.4f,%.4f,%.4f\n",
+                i, sample->start, sample->render, sample->upload, sample->sleep, sample->total);
+    }
+}
+
+static void write_percentiles_json(const char *name, Percentiles *p, FILE *file)
+{
+    fprintf(file, "  \"%s\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+            name, p->p50, p->p95, p->p99, p->max);
+}
+
+void frame_timer_write_json(FrameTimer *timer, FILE *file)
+{
+    FrameSummary summary;
+    frame_summary(timer, &summary);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"budget_ms\": %.4f,\n", timer->budget * 1000.0);
+    fprintf(file, "  \"frames\": %" PRIu64 ",\n", summary.frames);
+    fprintf(file, "  \"missed\": %" PRIu64 ",\n", summary.missed);
+    write_percentiles_json("render_ms", &summary.render, file);
+    write_percentiles_json("upload_ms", &summary.upload, file);
+    write_percentiles_json("total_ms", &summary.total, file);
+    fprintf(file, "  \"samples\": [");
+    for(u64 i = oldest_frame(timer); i < timer->count; ++i)
+    {
+        FrameSample *sample = &timer->samples[i % FRAME_HISTORY];
+        fprintf(file, "%s\n    {\"frame\": %" PRIu64 ", \"start_ms\": %.3f, \"render_ms\": %.4f, "
+                "\"upload_ms\": %.4f, \"sleep_ms\": %.4f, \"total_ms\": %.4f}",
+                i == oldest_frame(timer) ? "" : ",", i,
+                sample->start, sample->render, sample->upload, sample->sleep, sample->total);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+void frame_timer_draw(FrameTimer *timer, u32 *pixels, u32 stride, Rect area)
+{
+    u32 background = (32 << 16) | (32 << 8) | (32 << 0);
+    u32 good = (55 << 16) | (206 << 8) | (68 << 0);
+    u32 bad = (255 << 16) | (0 << 8) | (0 << 0);
+    u32 line = (160 << 16) | (160 << 8) | (160 << 0);
+
+    fill_rect_pixels(pixels, stride, area, background);
+    if(area.height < 2) return;
+
+    // Two budgets tall, so the budget line sits in the middle and anything past 2x is clipped
+    f64 scale = (area.height - 1) / (2.0 * timer->budget * 1000.0);
+    i32 bottom = area.y + area.height - 1;
+    i32 budget_y = bottom - (i32) (timer->budget * 1000.0 * scale + 0.5);
+
+    u32 bars = (u32) area.width < timer->count ? (u32) area.width : (u32) timer->count;
+    if(bars > FRAME_HISTORY) bars = FRAME_HISTORY;
+    for(u32 i = 0; i < bars; ++i)
+    {
+        FrameSample *sample = &timer->samples[(timer->count - bars + i) % FRAME_HISTORY];
+        i32 height = (i32) (sample->total * scale + 0.5);
+        if(height > area.height) height = area.height;
+        if(height < 1) height = 1;
+
+        u32 color = sample->total > timer->budget * 1000.0 ? bad : good;
+        i32 x = area.x + area.width - bars + i;
+        for(i32 y = bottom - height + 1; y <= bottom; ++y)
+        {
+            pixels[y * stride + x] = color;
+        }
+    }
+
+    fill_span(pixels + budget_y * stride + area.x, area.width, line);
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <time.h>
+#include "raster.h"
+#include "types.h"
+
+#ifndef TIMING
+#define TIMING
+
+/* Frame pacing and timing for the animation loop. Everything is measured on CLOCK_MONOTONIC and the */
+/* last FRAME_HISTORY frames are kept in a ring so percentiles can be taken at any point.           */
+
+#define FRAME_HISTORY 1024
+
+/* All durations in milliseconds */
+typedef struct
+{
+    f64 start;
+    f32 render;
+    f32 upload;
+    f32 sleep;
+    f32 total;
+} FrameSample;
+
+typedef struct
+{
+    FrameSample samples[FRAME_HISTORY];
+    /* Frames recorded so far, the newest one is samples[(count - 1) % FRAME_HISTORY] */
+    u64 count;
+    /* Frames whose render and upload didn't fit in the budget */
+    u64 missed;
+    /* Seconds per frame */
+    f64 budget;
+
+    /* When the current frame started and when its last phase ended */
+    f64 frame_start;
+    f64 mark;
+    FrameSample current;
+} FrameTimer;
+
+typedef struct
+{
+    f32 p50;
+    f32 p95;
+    f32 p99;
+    f32 max;
+} Percentiles;
+
+typedef struct
+{
+    u64 frames;
+    u64 missed;
+    Percentiles render;
+    Percentiles upload;
+    Percentiles total;
+} FrameSummary;
+
+/* Seconds on the monotonic clock. Everything that times itself uses this, it is inline so tools that */
+/* only want the clock don't need to link the rest.                                                   */
+static inline f64 timer_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64) ts.tv_sec + (f64) ts.tv_nsec / 1000000000.0;
+}
+
+void frame_timer_init(FrameTimer *timer, f64 fps);
+
+/* Call in this order once per frame */
+void frame_begin(FrameTimer *timer);
+void frame_rendered(FrameTimer *timer);
+void frame_uploaded(FrameTimer *timer);
+/* Records the frame. With pace set it first sleeps until the frame's budget is used up; a frame that */
+/* is already over budget doesn't sleep at all, so a slow frame never makes the next one late too.   */
+void frame_end(FrameTimer *timer, b32 pace);
+
+/* For callers that pace frames with their own timer: counts frames the timer fired for that never got */
+/* drawn because the loop was busy, as missed.                                                      */
+void frame_timer_skipped(FrameTimer *timer, u64 frames);
+
+/* Percentiles over the frames still in the ring, missed/frames over the whole run */
+void frame_summary(FrameTimer *timer, FrameSummary *summary);
+void frame_summary_print(FrameSummary *summary, FILE *file);
+
+/* Every frame still in the ring, oldest first. The JSON version includes the summary. */
+void frame_timer_write_csv(FrameTimer *timer, FILE *file);
+void frame_timer_write_json(FrameTimer *timer, FILE *file);
+
+/* Bar graph of the last frames' total time, one pixel column per frame. Green bars fit the budget, */
+/* red ones missed it, the grey line is the budget. area must already be clipped to the buffer.     */
+void frame_timer_draw(FrameTimer *timer, u32 *pixels, u32 stride, Rect area);
+
+#endif
@@ -0,0 +1,289 @@
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ntuple.h"
+#include "pool.h"
+#include "timing.h"
+
+/* Trains an n-tuple network by temporal difference learning from its own games (TD(0) on afterstates, */
+/* Szubert and Jaskowski 2014). Every move is the one ntuple_choose likes best. Once the next move is  */
+/* known, the value of the board the last move left behind (before its spawn) is pulled towards that   */
+/* next move's score plus the value of the board it leaves. At the end of a game it is pulled to 0.    */
+/*                                                                                                    */
+/* Every pool thread plays its own games and all of them update the same weights without any locking */
+/* (Hogwild). The tables are big and a move only touches a few dozen weights, so threads almost never */
+/* collide, and when they do, losing an update costs next to nothing.                                 */
+
+typedef struct
+{
+    u64 games;
+    u64 moves;
+    u64 score_sum;
+    u32 max_score;
+    /* Games whose biggest tile had each exponent */
+    u64 max_tiles[16];
+} TrainStats;
+
+typedef struct
+{
+    NTupleNetwork *network;
+    f32 learning_rate;
+    atomic_ullong *next_game;
+    u64 round_end;
+    TrainStats stats;
+} TrainTask;
+
+static volatile sig_atomic_t stopping;
+
+static void handle_stop(int signal_number)
+{
+    (void) signal_number;
+    stopping = 1;
+}
+
+static void play_and_learn(NTupleNetwork *network, u64 seed, f32 learning_rate, TrainStats *stats)
+{
+    Game game;
+    game_new(&game, seed);
+    Board board = game.board;
+    u32 score = 0;
+    u32 moves = 0;
+
+    Board last = 0;
+    b32 has_last = false;
+    while(!game_over(board))
+    {
+        f32 value;
+        Dir dir = ntuple_choose(network, board, &value);
+        Board after = board_move(board, dir);
+        if(has_last) ntuple_update(network, last, learning_rate * (value - ntuple_evaluate(network, last)));
+
+        score += board_move_score(board, dir);
+        moves++;
+        last = after;
+        has_last = true;
+        board = after;
+        matrix_update(&board, &game.rng);
+    }
+    // Nothing more to come after the last move
+    if(has_last) ntuple_update(network, last, -learning_rate * ntuple_evaluate(network, last));
+
+    stats->games++;
+    stats->moves += moves;
+    stats->score_sum += score;
+    if(score > stats->max_score) stats->max_score = score;
+    stats->max_tiles[board_max_tile(board)]++;
+}
+
+static void train_task(void *arg, u32 worker)
+{
+    (void) worker;
+    TrainTask *task = (TrainTask *) arg;
+    NTupleNetwork *network = task->network;
+    for(;;)
+    {
+        u64 game = atomic_fetch_add(task->next_game, 1);
+        if(game >= task->round_end) break;
+        play_and_learn(network, seed_sequence(network->seed, game), task->learning_rate, &task->stats);
+    }
+}
+
+static void merge_stats(TrainStats *into, TrainStats *from)
+{
+    into->games += from->games;
+    into->moves += from->moves;
+    into->score_sum += from->score_sum;
+    if(from->max_score > into->max_score) into->max_score = from->max_score;
+    for(u32 i = 0; i < 16; ++i) into->max_tiles[i] += from->max_tiles[i];
+}
+
+/* Share of the games that made a tile of at least exponent */
+static f64 reached(TrainStats *stats, u32 exponent)
+{
+    u64 count = 0;
+    for(u32 i = exponent; i < 16; ++i) count += stats->max_tiles[i];
+    return stats->games ? (f64) count / stats->games : 0;
+}
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s file [-g games] [-t threads] [-a learning rate] [-l small|large] [-i report every]\n"
+                    "       [-c checkpoint every] [-s seed] [-L curve.csv]\n", name);
+    fprintf(stderr, "  trains the network in file, carrying on from it if it already holds one (default large)\n");
+    fprintf(stderr, "  -g  games to play this run (default 100000), Ctrl-C stops early and saves\n");
+    fprintf(stderr, "  -a  step size, split over the weights each board picks (default 0.1)\n");
+    fprintf(stderr, "  -i  prints a point of the learning curve every this many games (default 1000)\n");
+    fprintf(stderr, "  -c  saves the network every this many games, 0 only at the end (default 10000)\n");
+    fprintf(stderr, "  -L  also writes the learning curve as CSV\n");
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2 || argv[1][0] == '-')
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+    u64 games = 100000;
+    u32 threads = 0;
+    f64 alpha = 0.1;
+    NTupleLayout layout = NTUPLE_LAYOUT_LARGE;
+    b32 layout_given = false;
+    u64 report_every = 1000;
+    u64 checkpoint_every = 10000;
+    u64 seed = DEFAULT_SEED;
+    b32 seed_given = false;
+    const char *curve_path = NULL;
+    for(int i = 2; i < argc; i += 2)
+    {
+        if(i + 1 >= argc)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(strcmp(argv[i], "-g") == 0) games = strtoull(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-t") == 0) threads = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-a") == 0) alpha = strtod(argv[i + 1], NULL);
+        else if(strcmp(argv[i], "-i") == 0) report_every = strtoull(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-c") == 0) checkpoint_every = strtoull(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-L") == 0) curve_path = argv[i + 1];
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            seed = strcmp(argv[i + 1], "time") == 0 ? rng_seed_from_time() : strtoull(argv[i + 1], NULL, 10);
+            seed_given = true;
+        }
+        else if(strcmp(argv[i], "-l") == 0 && strcmp(argv[i + 1], "small") == 0)
+        {
+            layout = NTUPLE_LAYOUT_SMALL;
+            layout_given = true;
+        }
+        else if(strcmp(argv[i], "-l") == 0 && strcmp(argv[i + 1], "large") == 0)
+        {
+            layout = NTUPLE_LAYOUT_LARGE;
+            layout_given = true;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(report_every == 0 || alpha <= 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    board_init();
+    NTupleNetwork network;
+    if(ntuple_load(&network, path))
+    {
+        printf("carrying on from %s: %" PRIu64 " games, %" PRIu64 " moves\n", path, network.games, network.moves);
+        // Game i of the whole training is always seeded the same, so a run that carries on doesn't replay
+        // the games it already learned from
+        if(seed_given && seed != network.seed) printf("-s ignored, the network was trained with seed %" PRIu64 "\n", network.seed);
+        if(layout_given) printf("-l ignored, the network keeps the %u tuples it was made with\n", network.tuple_count);
+    }
+    else if(access(path, F_OK) == 0)
+    {
+        fprintf(stderr, "%s: %s isn't a network, not overwriting it\n", argv[0], path);
+        return 1;
+    }
+    else
+    {
+        ntuple_create(&network, layout);
+        network.seed = seed;
+        if(!ntuple_save(&network, path))
+        {
+            fprintf(stderr, "%s: can't write %s\n", argv[0], path);
+            return 1;
+        }
+    }
+
+    FILE *curve = NULL;
+    if(curve_path)
+    {
+        curve = fopen(curve_path, "a");
+        if(!curve)
+        {
+            fprintf(stderr, "%s: can't write %s\n", argv[0], curve_path);
+            return 1;
+        }
+        fseek(curve, 0, SEEK_END);
+        if(ftell(curve) == 0) fprintf(curve, "games,seconds,games_per_sec,moves_per_sec,mean_score,max_score,reach_2048,reach_4096,reach_8192,reach_16384\n");
+    }
+
+    struct sigaction action = { .sa_handler = handle_stop };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    Pool *pool = pool_create(threads);
+    TrainTask *tasks = (TrainTask *) calloc(pool->thread_count, sizeof(TrainTask));
+    f32 learning_rate = (f32) (alpha / ntuple_feature_count(&network));
+    printf("%u tuples, %" PRIu64 " weights (%.0f MB), %u threads, step size %g\n", network.tuple_count,
+           network.weight_count, network.weight_count * sizeof(f32) / 1048576.0, pool->thread_count, alpha);
+    printf("%10s %9s %10s %10s %9s %7s %7s %7s\n", "games", "games/s", "moves/s", "mean", "max", "2048", "4096", "8192");
+
+    atomic_ullong next_game;
+    u64 first = network.games;
+    u64 last = first + games;
+    u64 last_checkpoint = first;
+    f64 start = timer_now();
+    while(network.games < last && !stopping)
+    {
+        u64 round_end = network.games + report_every < last ? network.games + report_every : last;
+        atomic_init(&next_game, network.games);
+        for(u32 i = 0; i < pool->thread_count; ++i)
+        {
+            tasks[i] = (TrainTask) {
+                .network = &network,
+                .learning_rate = learning_rate,
+                .next_game = &next_game,
+                .round_end = round_end,
+            };
+            pool_submit(pool, train_task, &tasks[i]);
+        }
+        f64 round_start = timer_now();
+        pool_wait(pool);
+        f64 round_time = timer_now() - round_start;
+
+        TrainStats stats = {0};
+        for(u32 i = 0; i < pool->thread_count; ++i) merge_stats(&stats, &tasks[i].stats);
+        network.games += stats.games;
+        network.moves += stats.moves;
+
+        f64 mean = (f64) stats.score_sum / stats.games;
+        printf("%10" PRIu64 " %9.0f %10.0f %10.0f %9u %6.1f%% %6.1f%% %6.1f%%\n", network.games, stats.games / round_time,
+               stats.moves / round_time, mean, stats.max_score, 100 * reached(&stats, 11), 100 * reached(&stats, 12),
+               100 * reached(&stats, 13));
+        fflush(stdout);
+        if(curve)
+        {
+            fprintf(curve, "%" PRIu64 ",%.3f,%.1f,%.0f,%.1f,%u,%.4f,%.4f,%.4f,%.4f\n", network.games, timer_now() - start,
+                    stats.games / round_time, stats.moves / round_time, mean, stats.max_score, reached(&stats, 11),
+                    reached(&stats, 12), reached(&stats, 13), reached(&stats, 14));
+            fflush(curve);
+        }
+
+        if(checkpoint_every && network.games - last_checkpoint >= checkpoint_every && network.games < last && !stopping)
+        {
+            if(!ntuple_save(&network, path)) fprintf(stderr, "%s: checkpoint to %s failed\n", argv[0], path);
+            last_checkpoint = network.games;
+        }
+    }
+
+    f64 elapsed = timer_now() - start;
+    b32 saved = ntuple_save(&network, path);
+    printf("%" PRIu64 " games in %.1f s (%.1f games/sec), %s %s\n", network.games - first, elapsed,
+           (network.games - first) / elapsed, saved ? "saved to" : "couldn't save", path);
+
+    if(curve) fclose(curve);
+    free(tasks);
+    pool_destroy(pool);
+    ntuple_free(&network);
+    return saved ? 0 : 1;
+}
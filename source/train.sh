@@ -0,0 +1,21 @@
+#!/bin/sh
+
+pushd ../target/release
+[ -f "board.o" ] && rm board.o
+[ -f "game.o" ] && rm game.o
+[ -f "io.o" ] && rm io.o
+[ -f "ntuple.o" ] && rm ntuple.o
+[ -f "pool.o" ] && rm pool.o
+[ -f "rng.o" ] && rm rng.o
+[ -f "train.o" ] && rm train.o
+[ -f "tf_train" ] && rm tf_train
+
+gcc -Wall -O3 -c ../../source/board.c
+gcc -Wall -O3 -c ../../source/game.c
+gcc -Wall -O3 -c ../../source/io.c
+gcc -Wall -O3 -c ../../source/ntuple.c
+gcc -Wall -O3 -c ../../source/pool.c
+gcc -Wall -O3 -c ../../source/rng.c
+gcc -Wall -O3 -c ../../source/train.c
+gcc -O3 -o tf_train board.o game.o io.o ntuple.o pool.o rng.o train.o -lpthread
+popd
@@ -2,460 +2,451 @@
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
 #include <stdio.h>
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/timerfd.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
-#include "draw.h"
+#include "ai.h"
+#include "animate.h"
+#include "game.h"
+#include "heuristic.h"
+#include "grid.h"
+#include "journal.h"
+#include "ntuple.h"
+#include "record.h"
+#include "rollout.h"
+#include "present.h"
+#include "scene.h"
+#include "timing.h"
 #include "types.h"
 
 
 /* --------------------------------- 2048 logic ---------------------------------  */
 
-// Number of cells in the grid. I might change this to be dynamic at some point
-#define CELL_NUM 16
-
-// Width/height of the grid i.e. LENGTH * LENGTH == CELL_NUM
-#define LENGTH 4
-
-static u32 colors[11] = {
-      /* R             G            B */
-    (105 << 16) | (105 << 8) | (105 << 0),         // Grey
-    (255 << 16) | (255 << 8) | (0   << 0),         // Yellow
-    (200 << 16) | (100 << 8) | (0   << 0),         // Orange
-    (255 << 16) | (0   << 8) | (0   << 0),         // Red
-    (130 << 16) | (18  << 8) | (75  << 0),         // Magenta
-    (255 << 16) | (100 << 8) | (255 << 0),         // Purple
-    (0   << 16) | (0   << 8) | (255 << 0),         // Blue
-    (0   << 16) | (255 << 8) | (255 << 0),         // Cyan
-    (55  << 16) | (206 << 8) | (68  << 0),         // Green
-    (20  << 16) | (14  << 8) | (15  << 0),         // Brown
-    (0   << 16) | (0   << 8) | (0   << 0),         // Black
-};
-
 /* File pointer used for writing debug info to a log file */
 FILE *debug;
 
-typedef struct 
-{
-    u8 data[CELL_NUM];
-    u8 empty_count;
-} Matrix;
+/* Moves waiting to be shown, and the time the animations were last moved on to */
+static Animator animator;
+static f64 animation_time;
 
-typedef enum
-{
-    LEFT,
-    RIGHT,
-    UP,
-    DOWN,
-} Dir;
+void render(XImage *window_buffer);
+void present(Presenter *presenter);
+void hide_game_over();
+void mark_all_dirty();
 
-#define NUM_FRAMES 10
-typedef struct
+/* Every move goes into journal, which is what undo, redo and recording work from */
+void shift(GridGame *game, Journal *journal, Dir dir)
 {
-    /* Minimum required info */
-    Dir dir;
-    f32 distance;
-    /* Index of the cells array that the animation applies to */
-    u32 index;
-    /* Index of the destination of the cell after the animation has played. This is used to update animations */
-    /* because calculating the next board state is done in multiple steps requiring some animations to be updated */
-    u32 destination;
-} AnimationData;
+    u8 destinations[GRID_CELLS];
+    Grid before = game->grid;
+    Grid next = before;
+    u32 score = 0;
 
-typedef struct
-{
-    AnimationData queue[CELL_NUM];
-    size_t count;
-} AnimationQueue;
+    // Shift is called even if nothing would happen to the grid. Thus
+    // matrix_update is only called if the board has been changed.
+    if(grid_move_traced(&next, dir, &score, destinations))
+    {
+        journal_move(journal, game, dir);
 
-void fill_cell(f32 x, f32 y, u32 length, u32 color, XImage *window_buffer);
-void push_animation(Dir dir, u32 index, u32 destination);
-void update_destination(u32 current, u32 new);
-void render(XImage *window_buffer);
+        // The game is already ahead, the animation catches up with it frame by frame
+        if(!animator_busy(&animator)) animation_time = timer_now();
+        animator_push(&animator, &before, destinations, &game->grid);
+    }
+}
 
-// Simple random number generator.
-// TODO: Initialize x with time()
-u32 rand_int()
+/* Moves the game delta moves back (negative) or forward through the journal and shows where it ends */
+/* up straight away, without animating                                                              */
+void jump(GridGame *game, Journal *journal, i32 delta)
 {
-    static u32 x = 723498734;
-
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
+    u32 moved = delta < 0 ? journal_undo(journal, game, (u32) -delta) : journal_redo(journal, game, (u32) delta);
+    if(!moved) return;
 
-    return x;
+    animator_init(&animator, &game->grid);
+    hide_game_over();
+    mark_all_dirty();
 }
 
-b32 matrix_equals(Matrix *a, Matrix *b)
+void matrix_print(Board board)
 {
     for(int i = 0; i < CELL_NUM; ++i)
     {
-        if(a->data[i] != b->data[i]) return false;
+        if(i % LENGTH == 0) printf("\n");
+        printf("%d ", board_get(board, i));
     }
-    return true;
+    printf("\n");
 }
 
-void shift_line(Matrix *matrix, int start, int step, Dir dir, int iter)
-{
-    int idx = start;
-    for(int i = 0; i < LENGTH; ++i)
-    {
-        u8 val = matrix->data[start];
-        if(val)
-        {
-            matrix->data[start] = 0;
-            matrix->data[idx] = val;
+/* ----------------------- End of 2048 logic ----------------------- */
 
-            if(iter == 1)
-            {
-                push_animation(dir, start, idx);
-            }
-            else
-            {
-                update_destination(start, idx);
-            }
 
-            idx += step;
-        }
-        start += step;
-    }
-}
 
-void combine_line(Matrix *matrix, u8 start, i8 step)
-{
-    for(int i = 0; i < LENGTH - 1; ++i)
-    {
-        u8 val = matrix->data[start];
-        if(val && val == matrix->data[start + step])
-        {
-            matrix->data[start] += 1;
-            matrix->data[start + step] = 0;
-            update_destination(start + step, start);
-            matrix->empty_count += 1;
-        }
-        start += step;
-    }
-}
 
-void matrix_update(Matrix *m)
-{
-    size_t one, two;
-    u8 empty_idx, empty_count;
 
-    empty_count = m->empty_count;
-    empty_idx = 0;
-    
-    one = rand_int() % empty_count;
-    two = rand_int() % empty_count;
+/* ------------------------- Rendering ------------------------- */
 
-    while(empty_count > 1 && one == (two = rand_int() % empty_count));
+#define WINDOW_WIDTH  800
+#define WINDOW_HEIGHT 800
 
-    for(int i = 0; i < CELL_NUM; ++i)
-    {
-        if(m->data[i] == 0)
-        {
-            if(empty_idx == one || empty_idx == two)
-            {
-                m->data[i] = 1;
-                m->empty_count -= 1;
-            }
-            empty_idx++;
-        }
-    }
-}
+// TODO: I'm assuming 1440p change this to be based on screen width/height
+#define WINDOW_X 880 
+#define WINDOW_Y 320 
 
-b32 game_over(Matrix *matrix)
-{
-    if(matrix->empty_count > 0) return false;
+/* Everything drawn into the window goes through here, the window client only presents it */
+static Scene scene;
 
-    // Check rows for matching adjacent cells
-    for(int i = 0; i < LENGTH - 1; ++i)
-    {
-        for(int j = 0; j < LENGTH; ++j)
-        {
-            int idx = i + j * LENGTH;
-            if(matrix->data[idx] == matrix->data[idx + 1]) return false;
-        }
-    }
+/* Timing of every frame drawn. Pressing f shows the last few hundred of them in the top left corner. */
+static FrameTimer frame_timer;
+static b32 show_overlay;
+static const Rect overlay_area = { 8, 8, 320, 80 };
+// Top part of the overlay holds the text, the graph goes underneath
+#define OVERLAY_TEXT_HEIGHT 20
 
-    // Check columns for matching adjacent cells
-    for(int i = 0; i < LENGTH; ++i)
-    {
-        for(int j = 0; j < LENGTH - 1; ++j)
-        {
-            int idx = i + j * LENGTH;
-            if(matrix->data[idx] == matrix->data[idx + LENGTH]) return false;
-        }
-    }
+/* When the game over panel started fading in */
+static f64 game_over_start;
 
-    return true;
+Bitmap window_bitmap(XImage *window_buffer)
+{
+    return (Bitmap) { (u32 *) window_buffer->data, window_buffer->width, window_buffer->height, window_buffer->width };
 }
 
-void shift(Matrix *matrix, Dir dir)
+void mark_dirty(Rect area)
 {
-    u8 start;
-    i8 step;
-    Matrix old;
-
-    memcpy((void *) &old, (void *) matrix, sizeof(Matrix));
+    scene_mark_dirty(&scene, area);
+}
 
-    switch(dir)
-    {
-    case LEFT:
-        start = 0;
-        step = LENGTH;
-        for(int i = 0; i < LENGTH; ++i)
-        {
-            shift_line(matrix, start, 1, LEFT, 1);
-            combine_line(matrix, start, 1);
-            shift_line(matrix, start, 1, LEFT, 2);
-            start += step;
-        }
-        break;
+/* Makes the next frame redraw and upload the whole window, e.g. when it first gets mapped */
+void mark_all_dirty()
+{
+    scene_mark_all_dirty(&scene);
+}
 
-    case UP:
-        start = 0;
-        step = 1;
-        for(int i = 0; i < LENGTH; ++i)
-        {
-            shift_line(matrix, start, LENGTH, UP, 1);
-            combine_line(matrix, start, LENGTH);
-            shift_line(matrix, start, LENGTH, UP, 2);
-            start += step;
-        }
-        break;
+void render(XImage *window_buffer)
+{
+    // The overlay changes every frame
+    if(show_overlay) mark_dirty(overlay_area);
 
-    case RIGHT:
-        start = LENGTH - 1;
-        step = LENGTH;
-        for(int i = 0; i < LENGTH; ++i)
-        {
-            shift_line(matrix, start, -1, RIGHT, 1);
-            combine_line(matrix, start, -1);
-            shift_line(matrix, start, -1, RIGHT, 2);
-            start += step;
-        }
-        break;
+    Bitmap window = window_bitmap(window_buffer);
+    scene_render(&scene, &window);
 
-    case DOWN:
-        start = (LENGTH - 1) * LENGTH;
-        step = 1;
-        for(int i = 0; i < LENGTH; ++i)
-        {
-            shift_line(matrix, start, -LENGTH, DOWN, 1);
-            combine_line(matrix, start, -LENGTH);
-            shift_line(matrix, start, -LENGTH, DOWN, 2);
-            start += step;
-        }
-        break;
+    if(show_overlay)
+    {
+        Rect text = overlay_area;
+        text.height = OVERLAY_TEXT_HEIGHT;
+        Rect graph = overlay_area;
+        graph.y += OVERLAY_TEXT_HEIGHT;
+        graph.height -= OVERLAY_TEXT_HEIGHT;
+
+        fill_rect_pixels(window.pixels, WINDOW_WIDTH, text, (32 << 16) | (32 << 8) | (32 << 0));
+        frame_timer_draw(&frame_timer, window.pixels, WINDOW_WIDTH, graph);
     }
-    // Shift is called even if nothing would happen to the grid. Thus
-    // matrix_update is only called if the matrix has been changed.
-    if(!matrix_equals(matrix, &old)) matrix_update(matrix);
 }
 
-void matrix_print(Matrix *m)
+/* Frame time percentiles written over the overlay once it is on screen */
+void draw_overlay_text(Presenter *presenter)
 {
-    for(int i = 0; i < CELL_NUM; ++i)
+    static char text[128];
+    static u64 updated = ~0ull;
+
+    // Sorting the whole history every frame would show up in the numbers being measured
+    if(updated == ~0ull || frame_timer.count - updated >= 30)
     {
-        if(i % LENGTH == 0) printf("\n");
-        printf("%d ", m->data[i]);
+        FrameSummary summary;
+        frame_summary(&frame_timer, &summary);
+        snprintf(text, sizeof(text), "ms p50 %.2f p95 %.2f p99 %.2f  missed %" PRIu64 "/%" PRIu64,
+                 summary.total.p50, summary.total.p95, summary.total.p99, summary.missed, summary.frames);
+        updated = frame_timer.count;
     }
-    printf("\n");
+
+    XDrawString(presenter->display, presenter->window, presenter->gc,
+                overlay_area.x + 4, overlay_area.y + OVERLAY_TEXT_HEIGHT - 6, text, strlen(text));
 }
 
-/* ----------------------- End of 2048 logic ----------------------- */
+/* Sends the areas render redrew to the X server */
+void present(Presenter *presenter)
+{
+    presenter_present(presenter, scene.dirty.rects, scene.dirty.count);
+    scene.dirty.count = 0;
+    if(show_overlay) draw_overlay_text(presenter);
+}
 
+/* Builds the game over panel and starts it fading in */
+void show_game_over(u32 score)
+{
+    scene_show_game_over(&scene, score);
+    game_over_start = timer_now();
+}
 
+/* Takes the game over panel away again after an undo */
+void hide_game_over()
+{
+    scene_hide_game_over(&scene);
+}
 
+/* True while there is something that changes from frame to frame */
+b32 animating()
+{
+    return animator_busy(&animator) || (scene.game_over_panel.pixels && scene.game_over_opacity < 255);
+}
 
+/* Moves the animations on to the current time and shows the result */
+void draw_frame(Presenter *presenter)
+{
+    Sprite sprites[GRID_CELLS];
 
-/* ------------------------- Rendering ------------------------- */
+    frame_begin(&frame_timer);
+    animator_advance(&animator, frame_timer.frame_start - animation_time);
+    animation_time = frame_timer.frame_start;
+    animator_sprites(&animator, sprites);
+    scene_set_sprites(&scene, sprites);
 
-#define WINDOW_WIDTH  800
-#define WINDOW_HEIGHT 800
+    if(scene.game_over_panel.pixels)
+    {
+        f64 fade = (frame_timer.frame_start - game_over_start) / GAME_OVER_FADE;
+        scene_set_game_over_opacity(&scene, fade < 1.0 ? (u32) (fade * 255.0) : 255);
+    }
 
-// TODO: I'm assuming 1440p change this to be based on screen width/height
-#define WINDOW_X 880 
-#define WINDOW_Y 320 
+    render(presenter_buffer(presenter));
+    frame_rendered(&frame_timer);
+    present(presenter);
+    frame_uploaded(&frame_timer);
+    // The run loop's frame timer does the pacing
+    frame_end(&frame_timer, false);
+}
 
-typedef struct
+void print_ai_stats(Ai *ais, u32 count, Rollout *rollout)
 {
-    b32 active;
-    f32 x;
-    f32 y;
-    u32 color;
-} Cell;
-
-
-static Cell cells[CELL_NUM];
-static AnimationQueue animations;
+    AiStats stats = {0};
+    for(u32 i = 0; i < count; ++i) ai_merge_stats(&stats, &ais[i].stats);
+    ai_print_stats(&stats, stdout);
+    if(rollout) rollout_print_stats(&rollout->stats, stdout);
+}
 
-void push_animation(Dir dir, u32 index, u32 destination)
+/* Prints the frame timing summary and, with -F, writes every frame still in the history to a CSV file */
+/* or, if the name ends in .json, a JSON file.                                                         */
+void finish_frame_log(const char *path)
 {
-    int start_x = index % LENGTH;
-    int start_y = index / LENGTH;
-    int idx_x = destination % LENGTH;
-    int idx_y = destination / LENGTH;
-
-    f32 distance;
-    if(dir == LEFT || dir == RIGHT) distance = (idx_x - start_x) * 200;
-    else distance = (idx_y - start_y) * 200;
-
-    if(distance < 0) distance = -distance;
-
-    AnimationData new = {
-        .dir = dir,
-        .distance = distance,
-        .index = index,
-        .destination = destination,
-    };
+    FrameSummary summary;
+    frame_summary(&frame_timer, &summary);
+    frame_summary_print(&summary, stdout);
+    if(!path) return;
 
-    animations.queue[animations.count++] = new;
+    FILE *file = fopen(path, "w");
+    if(!file)
+    {
+        fprintf(stderr, "can't create %s\n", path);
+        return;
+    }
+    size_t length = strlen(path);
+    if(length >= 5 && strcmp(path + length - 5, ".json") == 0) frame_timer_write_json(&frame_timer, file);
+    else frame_timer_write_csv(&frame_timer, file);
+    fclose(file);
 }
 
-/* This function is predicated on the fact that there should never be more than one animation with the same destination */
-/* when it is called. */
-void update_destination(u32 current, u32 new)
+/* Writes out the game being recorded, if there is one, and closes the file. What gets recorded is the */
+/* game as it ended up, moves that were undone and not played again are left out.                     */
+void finish_recording(RecordWriter *writer, GameRecord *record, Journal *journal, GridGame *grid_game, const char *path)
 {
-    for(int i = 0; i < animations.count; ++i)
-    {
-        if(animations.queue[i].destination == current)
-        {
-            animations.queue[i].destination = new;
-            int start_x = animations.queue[i].index % LENGTH;
-            int start_y = animations.queue[i].index / LENGTH;
-            int idx_x = animations.queue[i].destination % LENGTH;
-            int idx_y = animations.queue[i].destination / LENGTH;
-
-            f32 distance;
-            if(animations.queue[i].dir == LEFT || animations.queue[i].dir == RIGHT) distance = (idx_x - start_x) * 200;
-            else distance = (idx_y - start_y) * 200;
+    if(!writer) return;
+    for(u32 i = 0; i < journal->position; ++i) game_record_move(record, journal_move_at(journal, i));
+    Game game = grid_game_as_game(grid_game);
+    record_write(writer, record, &game);
+    if(!record_writer_close(writer)) fprintf(stderr, "writing %s failed, the game wasn't recorded\n", path);
+    game_record_free(record);
+}
 
-            if(distance < 0) distance = -distance;
+/* ------------------------- Input ------------------------- */
 
-            animations.queue[i].distance = distance;
-            return;
-        }
+/* Key presses and lines from the control fd both turn into these, so the run loop handles them the same way */
+typedef enum
+{
+    ACTION_NONE,
+    ACTION_LEFT,
+    ACTION_RIGHT,
+    ACTION_UP,
+    ACTION_DOWN,
+    ACTION_UNDO,
+    ACTION_REDO,
+    ACTION_BACK,
+    ACTION_FORWARD,
+    ACTION_AUTOPLAY,
+    ACTION_OVERLAY,
+    ACTION_QUIT,
+} Action;
+
+// Most actions taken from one batch of events
+#define MAX_ACTIONS 64
+
+// Moves ACTION_BACK and ACTION_FORWARD skip, for scrubbing through long games
+#define SCRUB_MOVES 100
+
+Action key_action(KeySym symbol)
+{
+    switch(symbol)
+    {
+        case XK_Return: case XK_Escape: return ACTION_QUIT;
+        case XK_a: return ACTION_AUTOPLAY;
+        case XK_f: return ACTION_OVERLAY;
+        case XK_h: return ACTION_LEFT;
+        case XK_j: return ACTION_DOWN;
+        case XK_k: return ACTION_UP;
+        case XK_l: return ACTION_RIGHT;
+        case XK_u: return ACTION_UNDO;
+        case XK_r: return ACTION_REDO;
+        case XK_Prior: return ACTION_BACK;
+        case XK_Next: return ACTION_FORWARD;
     }
+    return ACTION_NONE;
 }
 
-void play_animations(Display *display, GC gc, Window window, XImage *window_buffer)
+Action command_action(const char *command)
 {
-    // TODO: Ungrab keyboard is here for debugging because I had to turn off my computer when the program froze and still had
-    // control of the keyboard. Should remove this at some point.
-    XUngrabKeyboard(display, CurrentTime);
-
-    f64 render_start, render_time;
-    struct timespec req = {0};
-
-    for(int frame_counter = 0; frame_counter < NUM_FRAMES; ++frame_counter)
+    static const struct { const char *name; Action action; } commands[] = {
+        { "left", ACTION_LEFT },  { "h", ACTION_LEFT },
+        { "down", ACTION_DOWN },  { "j", ACTION_DOWN },
+        { "up", ACTION_UP },      { "k", ACTION_UP },
+        { "right", ACTION_RIGHT }, { "l", ACTION_RIGHT },
+        { "undo", ACTION_UNDO },  { "redo", ACTION_REDO },
+        { "back", ACTION_BACK },  { "forward", ACTION_FORWARD },
+        { "autoplay", ACTION_AUTOPLAY },
+        { "overlay", ACTION_OVERLAY },
+        { "quit", ACTION_QUIT },
+    };
+    for(u32 i = 0; i < sizeof(commands) / sizeof(commands[0]); ++i)
     {
-        render_start = clock();
-        for(int i = 0; i < animations.count; ++i)
-        {
-            AnimationData animation = animations.queue[i];
-            if(animation.distance == 0) continue;
-            f32 step = animation.distance / (f32) NUM_FRAMES;
-            switch(animation.dir)
-            {
-                case LEFT:
-                {
-                    cells[animation.index].x -= step;
-                } break;
-
-                case RIGHT:
-                {
-                    cells[animation.index].x += step;
-                } break;
-
-                case UP:
-                {
-                    cells[animation.index].y -= step;
-                } break;
-
-                case DOWN:
-                {
-                    cells[animation.index].y += step;
-                } break;
-            }
-        }
-        render(window_buffer);
-        XPutImage(display, window, gc, window_buffer, 0, 0, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-
-        /* NOTE: This whole things feels convoluted like I'm casting a bunch for no reason. Maybe it's fine but keep thinking about this */
-        render_time = ((f64) clock() - render_start) / (f64) CLOCKS_PER_SEC;
-        req.tv_nsec = 16666666l - (i64) (render_time * 1000000000 + 0.5); /* 60 fps, might change this to be variable at some point */
-        nanosleep(&req, NULL);
+        if(strcmp(commands[i].name, command) == 0) return commands[i].action;
     }
-    animations.count = 0;
+    if(command[0]) fprintf(stderr, "unknown command: %s\n", command);
+    return ACTION_NONE;
 }
 
-void push_cell(f32 x, f32 y, u32 color, u32 index)
+/* With -c the game also takes one command per line (left, up, autoplay, quit ...) from a file, FIFO or */
+/* stdin, for driving it from scripts.                                                                 */
+typedef struct
+{
+    int fd;
+    char line[256];
+    u32 length;
+} ControlInput;
+
+/* -1 if there is no control input. A FIFO is opened for writing too, so it never reads as closed */
+/* when whoever is writing to it goes away.                                                       */
+int open_control(const char *path)
 {
-    cells[index].active = true;
-    cells[index].x = x;
-    cells[index].y = y;
-    cells[index].color = color;
+    if(!path) return -1;
+    if(strcmp(path, "-") == 0) return STDIN_FILENO;
+
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0) fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0) fprintf(stderr, "can't open %s: %s\n", path, strerror(errno));
+    return fd;
 }
 
-void draw_grid(XImage *window_buffer, u32 color)
+/* Closes what open_control opened, stdin is left alone */
+void close_control(ControlInput *control)
 {
-    for(int i = 0; i < 4; ++i)
-    {
-        for(int j = 0; j < 4; ++j)
-        {
-            rect(i * 200, j * 200, 199, 199, color, window_buffer);
-        }
-    }
+    if(control->fd >= 0 && control->fd != STDIN_FILENO) close(control->fd);
+    control->fd = -1;
 }
 
-void fill_cell(f32 x, f32 y, u32 length, u32 color, XImage *window_buffer)
+/* Reads whatever is waiting and turns every complete line into an action. Returns the number of */
+/* actions written, and closes the control input at end of file.                                 */
+u32 read_control(ControlInput *control, Action *actions, u32 capacity)
 {
-    u32 int_x = (u32) (x + 0.5);
-    u32 int_y = (u32) (y + 0.5);
-    /* fprintf(debug, "fill_cell called:\nx: %d, y: %d, length: %d\n", int_x, int_y, length); */
+    char buffer[1024];
+    ssize_t bytes = read(control->fd, buffer, sizeof(buffer));
+    if(bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        close_control(control);
+        return 0;
+    }
 
-    u32 *data = (u32 *) window_buffer->data;
-    for(int i = int_x; i < int_x + length; ++i)
+    u32 count = 0;
+    for(ssize_t i = 0; i < bytes; ++i)
     {
-        for(int j = int_y; j < int_y + length; ++j)
+        char c = buffer[i];
+        if(c != '\n')
         {
-            data[i + window_buffer->width * j] = color;
+            // Overlong lines are cut short rather than split into two commands
+            if(c != '\r' && control->length + 1 < sizeof(control->line)) control->line[control->length++] = c;
+            continue;
         }
+
+        control->line[control->length] = 0;
+        control->length = 0;
+        Action action = command_action(control->line);
+        if(action != ACTION_NONE && count < capacity) actions[count++] = action;
     }
+    return count;
 }
 
-void render(XImage *window_buffer)
+/* Fires every frame while something is animating, and is stopped otherwise */
+void set_frame_timer(int fd, b32 running)
 {
-    memset((void *) window_buffer->data, ~0, WINDOW_WIDTH * WINDOW_HEIGHT * sizeof(u32));
-    draw_grid(window_buffer, 0);
-
-    for(int i = 0; i < CELL_NUM; ++i)
+    struct itimerspec spec = {0};
+    if(running)
     {
-        if(cells[i].active)
-        {
-            fill_cell(cells[i].x, cells[i].y, 197, cells[i].color, window_buffer);
-        }
+        spec.it_interval.tv_nsec = (long) (frame_timer.budget * 1000000000.0);
+        spec.it_value = spec.it_interval;
     }
+    timerfd_settime(fd, 0, &spec, NULL);
 }
 
-int main()
+int main(int argc, char **argv)
 {
     /* debug = fopen("debug.log", "w"); */
+    AiConfig ai_config = ai_default_config();
+    u32 ai_threads = 1;
+    u32 playouts = 0;
+    u64 seed = rng_seed_from_time();
+    const char *record_path = NULL;
+    const char *frame_log_path = NULL;
+    const char *control_path = NULL;
+    const char *weights_path = NULL;
+    const char *network_path = NULL;
+    b32 use_shm = true;
+    u32 size = LENGTH;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        if(strcmp(argv[i], "-r") == 0) record_path = argv[i + 1];
+        else if(strcmp(argv[i], "-s") == 0) seed = strtoull(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-d") == 0) ai_config.depth = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-T") == 0) ai_config.time_budget = strtod(argv[i + 1], NULL);
+        else if(strcmp(argv[i], "-j") == 0) ai_threads = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-k") == 0) playouts = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-m") == 0) use_shm = strcmp(argv[i + 1], "put") != 0;
+        else if(strcmp(argv[i], "-F") == 0) frame_log_path = argv[i + 1];
+        else if(strcmp(argv[i], "-n") == 0) size = strtoul(argv[i + 1], NULL, 10);
+        else if(strcmp(argv[i], "-c") == 0) control_path = argv[i + 1];
+        else if(strcmp(argv[i], "-w") == 0) weights_path = argv[i + 1];
+        else if(strcmp(argv[i], "-N") == 0) network_path = argv[i + 1];
+    }
+    /* -w gives the AI a weights file to evaluate boards with instead of the built in weights */
+    HeuristicWeights weights = heuristic_default_weights();
+    if(weights_path && !heuristic_load_weights(weights_path, &weights)) return 1;
+    if(size < GRID_MIN || size > GRID_MAX)
+    {
+        fprintf(stderr, "board size must be between %u and %u\n", GRID_MIN, GRID_MAX);
+        return 1;
+    }
+    scene_init(&scene, WINDOW_WIDTH, WINDOW_HEIGHT, size);
+
     /* Setup window */
     Display *display = XOpenDisplay(NULL);
     u32 screen = DefaultScreen(display);
     Window window;
     GC gc;
-    XImage *window_buffer;
+    Presenter presenter;
     XSetWindowAttributes window_attributes = {
         .override_redirect = 1,
         .background_pixel = WhitePixel(display, screen),
         .border_pixel = (255 << 8) | (255 << 0), // Cyan
-        .event_mask = StructureNotifyMask | KeyPressMask | EnterWindowMask | LeaveWindowMask,
+        .event_mask = StructureNotifyMask | ExposureMask | KeyPressMask | EnterWindowMask | LeaveWindowMask,
     };
 
     window = XCreateWindow(display, RootWindow(display, screen),
@@ -468,93 +459,271 @@ int main()
 
     gc = XCreateGC(display, window, 0, NULL);
 
-    window_buffer = XCreateImage(display, DefaultVisual(display, screen),
-                                 24, ZPixmap, 0,
-                                 (char *) calloc(WINDOW_WIDTH * WINDOW_HEIGHT, sizeof(u32)),
-                                 WINDOW_WIDTH, WINDOW_HEIGHT, 32, WINDOW_WIDTH * sizeof(u32));
-    memset((void *) window_buffer->data, ~0, WINDOW_WIDTH * WINDOW_HEIGHT * sizeof(u32));
+    /* -m put skips MIT-SHM and always sends frames with XPutImage */
+    presenter_init(&presenter, display, window, gc, DefaultVisual(display, screen),
+                   WINDOW_WIDTH, WINDOW_HEIGHT, use_shm);
+    printf("presenting with %s\n", presenter.shm ? "MIT-SHM" : "XPutImage");
+    frame_timer_init(&frame_timer, 60.0);
+    // Overlay text goes straight onto the window, XPutImage doesn't care about the foreground
+    XSetForeground(display, gc, WhitePixel(display, screen));
     XMapWindow(display, window);
 
-    /* Setup matrix */
-    Matrix game_state = {0};
-    game_state.empty_count = CELL_NUM;
-    matrix_update(&game_state);
+    /* Setup board */
+    board_init();
+    batch_init();
+    heuristic_init(&weights);
+    GridGame game;
+    grid_game_new(&game, size, seed);
+    animator_init(&animator, &game.grid);
+    Journal journal;
+    journal_begin(&journal, &game);
+    printf("seed: %" PRIu64 "\n", seed);
+
+    /* With -r the game goes into a record file that tf_replay can read back */
+    RecordWriter *writer = NULL;
+    GameRecord record_storage = {0};
+    GameRecord *record = NULL;
+    if(record_path && size != LENGTH)
+    {
+        fprintf(stderr, "records only hold %ux%u games, not recording\n", LENGTH, LENGTH);
+    }
+    else if(record_path)
+    {
+        writer = record_writer_open(record_path);
+        if(writer)
+        {
+            record = &record_storage;
+            Game start = grid_game_as_game(&game);
+            game_record_begin(record, &start);
+        }
+        else
+        {
+            fprintf(stderr, "can't create %s, not recording\n", record_path);
+        }
+    }
+
+    /* Pressing a toggles the AI playing by itself. With -j the root moves are searched in parallel, */
+    /* one Ai per pool thread. The AI only knows the 4x4 board.                                      */
+    Pool *pool = NULL;
+    if(ai_threads != 1) pool = pool_create(ai_threads);
+    u32 ai_count = pool ? pool->thread_count : 1;
+    Ai *ais = (Ai *) calloc(ai_count, sizeof(Ai));
+    for(u32 i = 0; i < ai_count; ++i) ai_init(&ais[i], ai_config);
+    b32 autoplay = false;
+
+    /* -k plays by Monte-Carlo rollouts instead of searching, that many random playouts per candidate */
+    /* move spread over the same pool. Their seeds come from the game's.                              */
+    Rollout rollout_storage;
+    Rollout *rollout = NULL;
+    Rng rollout_rng;
+    if(playouts)
+    {
+        RolloutConfig rollout_config = { .playouts = playouts, .time_budget = ai_config.time_budget };
+        rollout = &rollout_storage;
+        rollout_init(rollout, rollout_config, pool);
+        rng_seed(&rollout_rng, seed_sequence(seed, 1));
+    }
+
+    /* -N plays with a network trained by tf_train instead, the move whose score plus the value of the */
+    /* board it leaves is highest. The file is mapped, not read, so even the big networks load at once. */
+    NTupleNetwork network_storage;
+    NTupleNetwork *network = NULL;
+    if(network_path)
+    {
+        if(!ntuple_load(&network_storage, network_path))
+        {
+            fprintf(stderr, "%s isn't a network written by tf_train\n", network_path);
+            return 1;
+        }
+        network = &network_storage;
+        printf("network: %" PRIu64 " training games\n", network->games);
+    }
+
+    /* The run loop sleeps in poll until the X connection, the frame timer or the control input has */
+    /* something for it. The timer only runs while something is animating, so an idle game takes  */
+    /* no CPU at all.                                                                               */
+    enum { POLL_X, POLL_TIMER, POLL_CONTROL, POLL_COUNT };
+    ControlInput control = { .fd = open_control(control_path) };
+    int frame_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct pollfd fds[POLL_COUNT] = {
+        [POLL_X]       = { .fd = ConnectionNumber(display), .events = POLLIN },
+        [POLL_TIMER]   = { .fd = frame_timer_fd,            .events = POLLIN },
+        [POLL_CONTROL] = { .fd = control.fd,                .events = POLLIN },
+    };
+    b32 pacing = false;
+    b32 running = true;
 
     XEvent event;
-    for(;;)
+    Action actions[MAX_ACTIONS];
+    while(running)
     {
-        XNextEvent(display, &event);
-        switch(event.type)
+        // Xlib may already have read events off the socket, and the first frame of an animation
+        // doesn't wait for the timer
+        b32 work_waiting = XPending(display) ||
+                           (!pacing && (scene.dirty.count || animating())) ||
+                           (autoplay && !animator_busy(&animator));
+        fds[POLL_CONTROL].fd = control.fd;
+        if(poll(fds, POLL_COUNT, work_waiting ? 0 : -1) < 0 && errno != EINTR) break;
+
+        b32 frame_due = !pacing;
+        if(fds[POLL_TIMER].revents & POLLIN)
         {
-            case MapNotify:
+            u64 ticks;
+            if(read(frame_timer_fd, &ticks, sizeof(ticks)) == sizeof(ticks))
             {
-                for(int i = 0; i < CELL_NUM; ++i)
-                {
-                    u32 color_index;
-                    if((color_index = game_state.data[i]) > 0)
-                    {
-                        int x = i % LENGTH;
-                        int y = i / LENGTH;
-                        push_cell(x * 200 + 1, y * 200 + 1, colors[color_index - 1], i);
-                    }
-                }
-                render(window_buffer);
-                XPutImage(display, window, gc, window_buffer, 0, 0, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-            } break;
+                frame_due = true;
+                if(ticks > 1) frame_timer_skipped(&frame_timer, ticks - 1);
+            }
+        }
 
-            case EnterNotify:
+        // Everything that arrived since the last pass is handled in one go, so a burst of events
+        // costs at most one frame
+        u32 action_count = 0;
+        while(XPending(display))
+        {
+            XNextEvent(display, &event);
+            if(presenter_handle_event(&presenter, &event)) continue;
+            switch(event.type)
             {
-                XGrabKeyboard(display, window, 1, GrabModeAsync, GrabModeAsync, CurrentTime);
-            } break;
+                case MapNotify:
+                {
+                    mark_all_dirty();
+                } break;
 
-            case LeaveNotify:
-            {
-                XUngrabKeyboard(display, CurrentTime);
-            } break;
-            
-            case KeyPress:
+                case Expose:
+                {
+                    XExposeEvent *expose = &event.xexpose;
+                    mark_dirty((Rect) { expose->x, expose->y, expose->width, expose->height });
+                } break;
+
+                case EnterNotify:
+                {
+                    XGrabKeyboard(display, window, 1, GrabModeAsync, GrabModeAsync, CurrentTime);
+                } break;
+
+                case LeaveNotify:
+                {
+                    XUngrabKeyboard(display, CurrentTime);
+                } break;
+
+                case KeyPress:
+                {
+                    // I have no idea what the 0 does. It's an index?? for something??
+                    Action action = key_action(XLookupKeysym(&event.xkey, 0));
+                    // Once the game is over any key but the ones going back quits
+                    b32 going_back = action == ACTION_UNDO || action == ACTION_BACK;
+                    if(grid_over(&game.grid) && !going_back) action = ACTION_QUIT;
+                    if(action != ACTION_NONE && action_count < MAX_ACTIONS) actions[action_count++] = action;
+                } break;
+            }
+        }
+
+        if(control.fd >= 0 && fds[POLL_CONTROL].revents)
+        {
+            action_count += read_control(&control, actions + action_count, MAX_ACTIONS - action_count);
+        }
+
+        for(u32 i = 0; i < action_count && running; ++i)
+        {
+            switch(actions[i])
             {
-                if(game_over(&game_state)) return 0;
-                // I have no idea what the 0 does. It's an index?? for something??
-                KeySym symbol = XLookupKeysym(&event.xkey, 0);
-                switch(symbol)
+                case ACTION_QUIT:
                 {
-                    case XK_Return: case XK_Escape:
-                    {
-                        XDestroyImage(window_buffer);
-                        XCloseDisplay(display);
-                        return 0;
-                    } break;
-
-                    case XK_h: shift(&game_state, LEFT);  break;
-                    case XK_j: shift(&game_state, DOWN);  break;
-                    case XK_k: shift(&game_state, UP);    break;
-                    case XK_l: shift(&game_state, RIGHT); break;
-                }
-                play_animations(display, gc, window, window_buffer);
-
-                // Reset rendering state after playing animations
-                for(int i = 0; i < CELL_NUM; ++i)
+                    running = false;
+                } break;
+
+                case ACTION_AUTOPLAY:
                 {
-                    cells[i].active = false;
-                }
+                    if(size != LENGTH)
+                    {
+                        printf("the AI only plays %ux%u boards\n", LENGTH, LENGTH);
+                        break;
+                    }
+                    autoplay = !autoplay;
+                    if(!autoplay) print_ai_stats(ais, ai_count, rollout);
+                } break;
 
-                // TODO: This is here for debugging, remove at some point.
-                XGrabKeyboard(display, window, 1, GrabModeAsync, GrabModeAsync, CurrentTime);
+                case ACTION_OVERLAY:
+                {
+                    // Turning it off needs the area under it redrawn once more
+                    show_overlay = !show_overlay;
+                    mark_dirty(overlay_area);
+                } break;
 
-                for(int i = 0; i < CELL_NUM; ++i)
+                case ACTION_UNDO:
+                case ACTION_REDO:
+                case ACTION_BACK:
+                case ACTION_FORWARD:
                 {
-                    u32 color_index;
-                    if((color_index = game_state.data[i]) > 0)
+                    // Going back takes over from the AI, it would only play the same moves again
+                    if(autoplay)
                     {
-                        int x = i % LENGTH;
-                        int y = i / LENGTH;
-                        push_cell(x * 200 + 1, y * 200 + 1, colors[color_index - 1], i);
+                        autoplay = false;
+                        print_ai_stats(ais, ai_count, rollout);
                     }
-                }
-                render(window_buffer);
-                XPutImage(display, window, gc, window_buffer, 0, 0, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-            } break;
+                    i32 delta = actions[i] == ACTION_BACK || actions[i] == ACTION_FORWARD ? SCRUB_MOVES : 1;
+                    if(actions[i] == ACTION_UNDO || actions[i] == ACTION_BACK) delta = -delta;
+                    jump(&game, &journal, delta);
+                } break;
+
+                case ACTION_LEFT:  shift(&game, &journal, LEFT);  break;
+                case ACTION_DOWN:  shift(&game, &journal, DOWN);  break;
+                case ACTION_UP:    shift(&game, &journal, UP);    break;
+                case ACTION_RIGHT: shift(&game, &journal, RIGHT); break;
+                case ACTION_NONE: break;
+            }
+        }
+        if(!running) break;
+
+        // The AI waits until its last move has been shown
+        if(autoplay && !animator_busy(&animator))
+        {
+            if(grid_over(&game.grid))
+            {
+                autoplay = false;
+                print_ai_stats(ais, ai_count, rollout);
+            }
+            else
+            {
+                Board board = grid_to_board(&game.grid);
+                Dir dir;
+                if(network) dir = ntuple_choose(network, board, NULL);
+                else if(rollout) dir = rollout_choose(rollout, board, rng_next(&rollout_rng));
+                else dir = pool ? ai_choose_parallel(ais, pool, board) : ai_choose(&ais[0], board);
+                shift(&game, &journal, dir);
+            }
+        }
+
+        // The last move has to finish sliding before the board gets covered up
+        if(!scene.game_over_panel.pixels && !animator_busy(&animator) && grid_over(&game.grid))
+        {
+            show_game_over(game.score);
+        }
+
+        if(frame_due && (animating() || scene.dirty.count))
+        {
+            draw_frame(&presenter);
+        }
+
+        if(animating() != pacing)
+        {
+            pacing = !pacing;
+            set_frame_timer(frame_timer_fd, pacing);
         }
     }
+
+    finish_recording(writer, record, &journal, &game, record_path);
+    journal_free(&journal);
+    finish_frame_log(frame_log_path);
+    for(u32 i = 0; i < ai_count; ++i) ai_free(&ais[i]);
+    free(ais);
+    if(rollout) rollout_free(rollout);
+    if(network) ntuple_free(network);
+    if(pool) pool_destroy(pool);
+    close(frame_timer_fd);
+    close_control(&control);
+    scene_free(&scene);
+    presenter_free(&presenter);
+    XCloseDisplay(display);
+    return 0;
 }